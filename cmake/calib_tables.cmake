@@ -0,0 +1,55 @@
+#
+# Generates calib_tables.h from the calibration CSVs, one default table per
+# file: speed.csv, direction.csv, temperature.csv and battery.csv. Lines are
+# "in,out" integer pairs with strictly ascending inputs, lines starting with
+# # and the header line are skipped. Editing a CSV reruns the generator.
+#
+#   calib_tables(<csv dir> <output header>)
+#
+
+set(CALIB_MAX_POINTS 16) # src/calib.h
+
+function(calib_tables csv_dir out)
+  set(body "// Generated from ${csv_dir} by cmake/calib_tables.cmake, do not edit.\n\n")
+  string(APPEND body "#ifndef _CALIB_TABLES_H_\n#define _CALIB_TABLES_H_\n\n#include \"calib.h\"\n\n")
+
+  foreach(name speed direction temperature battery)
+    set(csv ${csv_dir}/${name}.csv)
+    if(NOT EXISTS ${csv})
+      message(FATAL_ERROR "Calibration table ${csv} is missing")
+    endif()
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS ${csv})
+
+    file(STRINGS ${csv} lines)
+    set(points "")
+    set(count 0)
+    set(last "")
+    foreach(line ${lines})
+      string(STRIP "${line}" line)
+      if(line STREQUAL "" OR line MATCHES "^#" OR line MATCHES "^[A-Za-z]")
+        continue()
+      endif()
+      if(NOT line MATCHES "^(-?[0-9]+)[ \t]*,[ \t]*(-?[0-9]+)$")
+        message(FATAL_ERROR "${csv}: \"${line}\" is not an integer in,out pair")
+      endif()
+      set(in ${CMAKE_MATCH_1})
+      set(out_value ${CMAKE_MATCH_2})
+      if(NOT last STREQUAL "" AND NOT in GREATER last)
+        message(FATAL_ERROR "${csv}: inputs must be strictly ascending, ${in} follows ${last}")
+      endif()
+      string(APPEND points "\t{${in}, ${out_value}},\n")
+      math(EXPR count "${count} + 1")
+      set(last ${in})
+    endforeach()
+
+    if(count LESS 2 OR count GREATER CALIB_MAX_POINTS)
+      message(FATAL_ERROR "${csv}: ${count} points, a table takes 2 to ${CALIB_MAX_POINTS}")
+    endif()
+    string(APPEND body "static const struct calib_point calib_${name}_default[] = {\n${points}};\n\n")
+  endforeach()
+
+  string(APPEND body "#endif /* _CALIB_TABLES_H_ */\n")
+  # only touch the header when a table changed, so nothing rebuilds otherwise
+  file(WRITE ${out}.tmp "${body}")
+  configure_file(${out}.tmp ${out} COPYONLY)
+endfunction()
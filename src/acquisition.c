@@ -0,0 +1,172 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include "acquisition.h"
+#include "activity.h"
+#include "adc.h"
+#include "pulse_counter.h"
+#include "wind_rate.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(acquisition, LOG_LEVEL_INF);
+
+BUILD_ASSERT((CONFIG_WIND_ACQ_RING_SIZE & (CONFIG_WIND_ACQ_RING_SIZE - 1)) == 0,
+			 "WIND_ACQ_RING_SIZE must be a power of two");
+
+static void acquisition_timer_cb(struct k_timer *timer);
+static void acquisition_thread(void *p1, void *p2, void *p3);
+
+static K_TIMER_DEFINE(acquisition_timer, acquisition_timer_cb, NULL);
+static K_SEM_DEFINE(tick_sem, 0, 1);
+K_THREAD_DEFINE(acquisition_tid, CONFIG_WIND_ACQ_STACK_SIZE, acquisition_thread, NULL, NULL, NULL,
+				CONFIG_WIND_ACQ_THREAD_PRIORITY, 0, 0);
+
+// Single producer, single consumer ring. head is only written by the
+// thread, tail only by the aggregator, each publishes its entry with
+// the atomic store of its index.
+static struct acq_sample ring[CONFIG_WIND_ACQ_RING_SIZE];
+static atomic_t head;
+static atomic_t tail;
+
+static void (*ready_cb)(void);
+
+// rate and timing are only touched by the thread, tick_us is set with the
+// tick, timing_allowed with the power tier
+static struct wind_rate rate;
+static bool timing;
+static volatile uint32_t tick_us = USEC_PER_SEC;
+static volatile bool timing_allowed = true;
+
+// written in the timer handler, read by the thread
+static volatile uint32_t tick_cycles;
+static atomic_t pending_ticks;
+
+static uint32_t ticks;
+static uint32_t missed;
+static uint32_t isr_max_cycles;
+static uint64_t wake_sum_cycles;
+static uint32_t wake_max_cycles;
+static uint32_t wakes;
+static uint32_t overruns;
+static uint32_t timed;
+
+// the only periodic wakeup, hands everything else to the thread
+static void acquisition_timer_cb(struct k_timer *timer)
+{
+	uint32_t start = k_cycle_get_32();
+
+	tick_cycles = start;
+	++ticks;
+	activity_add(ACTIVITY_TIMER, 1);
+	// the semaphore holds one tick, the thread has not taken the last one
+	// and this tick's pulses end up in the same sample
+	if (atomic_inc(&pending_ticks) != 0)
+	{
+		++missed;
+	}
+	k_sem_give(&tick_sem);
+
+	isr_max_cycles = MAX(isr_max_cycles, k_cycle_get_32() - start);
+}
+
+static void ring_put(const struct acq_sample *sample)
+{
+	atomic_val_t h = atomic_get(&head);
+
+	if (h - atomic_get(&tail) >= CONFIG_WIND_ACQ_RING_SIZE)
+	{
+		++overruns;
+		return;
+	}
+	ring[h & (CONFIG_WIND_ACQ_RING_SIZE - 1)] = *sample;
+	atomic_set(&head, h + 1);
+}
+
+static void acquisition_thread(void *p1, void *p2, void *p3)
+{
+	struct acq_sample sample;
+	struct pulse_reading reading;
+	atomic_val_t n;
+	uint32_t wake;
+
+	for (;;)
+	{
+		k_sem_take(&tick_sem, K_FOREVER);
+
+		// the handler counts and gives in one go, a given semaphore has
+		// at least one tick pending
+		n = atomic_clear(&pending_ticks);
+		sample.ticks = CLAMP(n, 1, UINT8_MAX);
+		sample.flags = 0;
+		if (pulse_counter_read(&reading) == 0)
+		{
+			sample.mpulses = wind_rate_update(&rate, &reading,
+											  MIN((uint64_t)tick_us * sample.ticks, UINT32_MAX));
+			sample.flags |= ACQ_PULSES_OK | (reading.timed ? ACQ_TIMED : 0);
+			timed += reading.timed;
+		}
+		// the edge timer keeps the high frequency clock running
+		if (timing != (rate.timing && timing_allowed))
+		{
+			timing = !timing;
+			pulse_counter_set_timing(timing);
+		}
+		if (get_adc_voltage(ADC_WIND_DIR_ID, &sample.dir_mv) == 0)
+		{
+			sample.flags |= ACQ_DIRECTION_OK;
+		}
+		ring_put(&sample);
+
+		wake = k_cycle_get_32() - tick_cycles;
+		wake_sum_cycles += wake;
+		wake_max_cycles = MAX(wake_max_cycles, wake);
+		++wakes;
+
+		if (ready_cb)
+		{
+			ready_cb();
+		}
+	}
+}
+
+void acquisition_init(void (*ready)(void))
+{
+	ready_cb = ready;
+	wind_rate_init(&rate, CONFIG_WIND_PERIOD_MAX_HZ);
+	timing = rate.timing && timing_allowed;
+	pulse_counter_set_timing(timing);
+}
+
+void acquisition_set_tick(uint8_t seconds)
+{
+	tick_us = seconds * USEC_PER_SEC;
+	k_timer_start(&acquisition_timer, K_SECONDS(seconds), K_SECONDS(seconds));
+}
+
+void acquisition_set_timing(bool allowed)
+{
+	timing_allowed = allowed;
+}
+
+bool acquisition_get(struct acq_sample *sample)
+{
+	atomic_val_t t = atomic_get(&tail);
+
+	if (t == atomic_get(&head))
+	{
+		return false;
+	}
+	*sample = ring[t & (CONFIG_WIND_ACQ_RING_SIZE - 1)];
+	atomic_set(&tail, t + 1);
+	return true;
+}
+
+void acquisition_stats_get(struct acq_stats *stats)
+{
+	stats->ticks = ticks;
+	stats->missed = missed;
+	stats->isr_max_us = k_cyc_to_us_floor32(isr_max_cycles);
+	stats->wake_mean_us = wakes ? k_cyc_to_us_floor32(wake_sum_cycles / wakes) : 0;
+	stats->wake_max_us = k_cyc_to_us_floor32(wake_max_cycles);
+	stats->overruns = overruns;
+	stats->timed = timed;
+}
@@ -0,0 +1,65 @@
+#ifndef _ACQUISITION_H_
+#define _ACQUISITION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sensor acquisition in its own low priority thread. The tick timer only
+// signals the thread, which reads the pulse counter and the direction ADC
+// and hands each sample to the aggregator through a single producer,
+// single consumer ring. Nothing blocks in interrupt context and the
+// aggregator never shares state with the thread. At light winds the pulses
+// of a sample are measured from the pulse period, see wind_rate.h.
+
+#define ACQ_PULSES_OK 0x01
+#define ACQ_DIRECTION_OK 0x02
+#define ACQ_TIMED 0x04
+
+struct acq_sample
+{
+	uint32_t mpulses; // since the previous sample, thousandths of a pulse
+	uint16_t dir_mv;  // direction vane voltage
+	uint8_t ticks;	  // timer ticks covered, more than one if the thread fell behind
+	uint8_t flags;	  // ACQ_*_OK, what was read successfully, ACQ_TIMED
+};
+
+// timing of the acquisition path since boot
+struct acq_stats
+{
+	uint32_t ticks;		   // timer expiries
+	uint32_t missed;	   // expiries merged into the next sample, the thread was still busy
+	uint32_t isr_max_us;   // longest timer expiry handler
+	uint32_t wake_mean_us; // timer expiry to sample in the ring
+	uint32_t wake_max_us;
+	uint32_t overruns; // samples dropped, the aggregator fell behind
+	uint32_t timed;	   // samples measured from the pulse period
+};
+
+/**
+ * @brief Start the acquisition thread.
+ *
+ * @param ready - called from the thread after each sample is queued.
+ */
+void acquisition_init(void (*ready)(void));
+
+/**
+ * @brief Set the tick, restarts the timer.
+ */
+void acquisition_set_tick(uint8_t seconds);
+
+/**
+ * @brief Allow the pulse period measurement, the edge timestamps cost
+ * current. Applied at the next tick, the pulses are counted without.
+ */
+void acquisition_set_timing(bool allowed);
+
+/**
+ * @brief Take the oldest queued sample, aggregator side only.
+ *
+ * @return bool - false if the ring is empty.
+ */
+bool acquisition_get(struct acq_sample *sample);
+
+void acquisition_stats_get(struct acq_stats *stats);
+
+#endif /* _ACQUISITION_H_ */
@@ -0,0 +1,75 @@
+#include <zephyr/kernel.h>
+#include <nrf_modem_at.h>
+
+#include "activity.h"
+#include "power.h"
+#include "pulse_counter.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(activity, LOG_LEVEL_INF);
+
+static atomic_t counters[ACTIVITY_COUNTER_COUNT];
+
+// totals at the previous delta
+static struct activity_delta last;
+
+void activity_add(enum activity_id id, uint32_t n)
+{
+	atomic_add(&counters[id], n);
+}
+
+void activity_modem_init(void)
+{
+	int err = nrf_modem_at_printf("AT%%XCONNSTAT=1");
+
+	if (err)
+	{
+		LOG_WRN("Failed to start connection statistics: %d\n", err);
+	}
+}
+
+int activity_modem_kb(uint32_t *tx_kb, uint32_t *rx_kb)
+{
+	// SMS sent and received, data sent and received, packet sizes
+	int err = nrf_modem_at_scanf("AT%XCONNSTAT?", "%%XCONNSTAT: %*u,%*u,%u,%u", tx_kb, rx_kb);
+
+	return err == 2 ? 0 : -EIO;
+}
+
+void activity_take_delta(struct activity_delta *delta)
+{
+	struct activity_delta now;
+	struct power_stats power;
+
+	for (int i = 0; i < ACTIVITY_COUNTER_COUNT; ++i)
+	{
+		now.count[i] = (uint32_t)atomic_get(&counters[i]);
+	}
+	// the pulse counter backends count their interrupts already
+	now.count[ACTIVITY_PULSE_IRQ] = pulse_counter_irq_count();
+
+	power_stats_get(&power);
+	now.connected_s = power.state_ms[POWER_RRC_CONNECTED] / MSEC_PER_SEC;
+	now.idle_s = power.state_ms[POWER_RRC_IDLE] / MSEC_PER_SEC;
+	now.sleep_s = power.state_ms[POWER_MODEM_SLEEP] / MSEC_PER_SEC;
+	now.charge_uah = power.charge_uah;
+
+	if (activity_modem_kb(&now.modem_tx_kb, &now.modem_rx_kb) != 0)
+	{
+		now.modem_tx_kb = last.modem_tx_kb;
+		now.modem_rx_kb = last.modem_rx_kb;
+	}
+
+	// unsigned subtraction is right across counter wrap
+	for (int i = 0; i < ACTIVITY_COUNTER_COUNT; ++i)
+	{
+		delta->count[i] = now.count[i] - last.count[i];
+	}
+	delta->connected_s = now.connected_s - last.connected_s;
+	delta->idle_s = now.idle_s - last.idle_s;
+	delta->sleep_s = now.sleep_s - last.sleep_s;
+	delta->charge_uah = now.charge_uah - last.charge_uah;
+	delta->modem_tx_kb = now.modem_tx_kb - last.modem_tx_kb;
+	delta->modem_rx_kb = now.modem_rx_kb - last.modem_rx_kb;
+
+	last = now;
+}
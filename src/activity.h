@@ -0,0 +1,50 @@
+#ifndef _ACTIVITY_H_
+#define _ACTIVITY_H_
+
+#include <stdint.h>
+
+// Activity counters, what the station spent its energy on. Counting is one
+// atomic add, so it is safe from ISRs. Deltas go out with the health report.
+
+enum activity_id
+{
+	ACTIVITY_PULSE_IRQ,	  // pulse counter interrupts
+	ACTIVITY_TIMER,		  // acquisition timer wakeups
+	ACTIVITY_ADC,		  // ADC conversion bursts
+	ACTIVITY_MQTT_TX,	  // MQTT packets sent
+	ACTIVITY_MQTT_TX_B,	  // MQTT payload and topic bytes sent
+	ACTIVITY_MQTT_RX,	  // MQTT packets received
+	ACTIVITY_MQTT_RX_B,	  // MQTT payload bytes received
+	ACTIVITY_COUNTER_COUNT
+};
+
+// everything reported per health interval
+struct activity_delta
+{
+	uint32_t count[ACTIVITY_COUNTER_COUNT];
+	uint32_t connected_s; // RRC connected
+	uint32_t idle_s;	  // RRC idle
+	uint32_t sleep_s;	  // modem sleep (PSM)
+	uint32_t charge_uah;  // estimated from the time in each state
+	uint32_t modem_tx_kb; // modem data counters from %XCONNSTAT
+	uint32_t modem_rx_kb;
+};
+
+void activity_add(enum activity_id id, uint32_t n);
+
+/**
+ * @brief Start the modem connection statistics, call once the modem is up.
+ */
+void activity_modem_init(void);
+
+/**
+ * @brief Read the modem data counters, in kB since activity_modem_init().
+ */
+int activity_modem_kb(uint32_t *tx_kb, uint32_t *rx_kb);
+
+/**
+ * @brief Get the activity since the previous call.
+ */
+void activity_take_delta(struct activity_delta *delta);
+
+#endif /* _ACTIVITY_H_ */
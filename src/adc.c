@@ -1,129 +1,180 @@
+#include <zephyr/kernel.h>
 #include <zephyr/drivers/adc.h>
+#include "activity.h"
 #include "adc.h"
+#include "wind_trace.h"
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(adc, LOG_LEVEL_INF);
 
-#define BATVOLT_R1 4.7f			 // MOhm
-#define BATVOLT_R2 10.0f		 // MOhm
-#define INPUT_VOLT_RANGE 3.67f	 // Volts
-#define VALUE_RANGE_10_BIT 1.023 // (2^10 - 1) / 1000
-
-#define ADC_NODE DT_NODELABEL(adc)
-
-#define ADC_RESOLUTION 10
-#define ADC_GAIN ADC_GAIN_1_6
-#define ADC_REFERENCE ADC_REF_INTERNAL
-#define ADC_ACQUISITION_TIME ADC_ACQ_TIME(ADC_ACQ_TIME_MICROSECONDS, 10)
-#define ADC_1ST_CHANNEL_INPUT SAADC_CH_PSELP_PSELP_AnalogInput0
-#define ADC_2ND_CHANNEL_INPUT SAADC_CH_PSELP_PSELP_AnalogInput1
-#define ADC_3RD_CHANNEL_INPUT SAADC_CH_PSELP_PSELP_AnalogInput2
-
-#define BUFFER_SIZE 1
-static int16_t m_sample_buffer[BUFFER_SIZE];
-
-static const struct device *adc_dev;
-
-// Battery voltage ADC
-static const struct adc_channel_cfg m_1st_channel_cfg = {
-	.gain = ADC_GAIN,
-	.reference = ADC_REFERENCE,
-	.acquisition_time = ADC_ACQUISITION_TIME,
-	.channel_id = ADC_BATTERY_VOLTAGE_ID,
-	.input_positive = ADC_1ST_CHANNEL_INPUT,
+#define INPUT_MV_RANGE 3670	   // millivolts at full scale
+#define VALUE_RANGE_10_BIT 1023 // 2^10 - 1
+
+// every scan converts all channels this many times back to back and averages,
+// a single channel read converts once
+#define ADC_OVERSAMPLE 8
+#define ADC_TIMEOUT_MS 100
+
+#define ADC_USER_NODE DT_PATH(zephyr_user)
+
+#define ADC_SPEC(node_id, prop, idx) ADC_DT_SPEC_GET_BY_IDX(node_id, idx),
+
+// channel table from the io-channels of the zephyr,user node
+static const struct adc_dt_spec adc_channels[] = {
+	DT_FOREACH_PROP_ELEM(ADC_USER_NODE, io_channels, ADC_SPEC)};
+
+BUILD_ASSERT(ARRAY_SIZE(adc_channels) == ADC_CHANNEL_COUNT, "zephyr,user io-channels must list every ADC channel");
+
+static int16_t sample_buffer[ADC_OVERSAMPLE][ADC_CHANNEL_COUNT];
+
+// position of each channel within one sampling, the SAADC stores results
+// in ascending channel id order
+static uint8_t sample_pos[ADC_CHANNEL_COUNT];
+
+static struct adc_sequence_options sequence_options = {
+	.interval_us = 0,
+	.extra_samplings = ADC_OVERSAMPLE - 1,
 };
 
-// Wind direction ADC
-static const struct adc_channel_cfg m_2nd_channel_cfg = {
-	.gain = ADC_GAIN,
-	.reference = ADC_REFERENCE,
-	.acquisition_time = ADC_ACQUISITION_TIME,
-	.channel_id = ADC_WIND_DIR_ID,
-	.input_positive = ADC_2ND_CHANNEL_INPUT,
+static struct adc_sequence sequence = {
+	.options = &sequence_options,
+	.buffer = sample_buffer,
+	.buffer_size = sizeof(sample_buffer), // in bytes!
 };
 
-// Temperature Sensor ADC
-static const struct adc_channel_cfg m_3rd_channel_cfg = {
-	.gain = ADC_GAIN,
-	.reference = ADC_REFERENCE,
-	.acquisition_time = ADC_ACQUISITION_TIME,
-	.channel_id = ADC_TEMPERATURE_ID,
-	.input_positive = ADC_3RD_CHANNEL_INPUT,
+// the direction is read every tick, one conversion of its channel only
+static int16_t single_buffer;
+
+static struct adc_sequence single_sequence = {
+	.buffer = &single_buffer,
+	.buffer_size = sizeof(single_buffer),
 };
 
-// Get battery voltage in millivolts, return 0 if successful
-int get_adc_voltage(uint8_t channel, uint16_t *battery_voltage)
+static struct k_poll_signal adc_signal = K_POLL_SIGNAL_INITIALIZER(adc_signal);
+static K_MUTEX_DEFINE(adc_lock);
+static bool adc_ready;
+
+// runs one sequence and waits for it, called with adc_lock held
+static int adc_convert(const struct adc_sequence *seq)
 {
+	struct k_poll_event event = K_POLL_EVENT_INITIALIZER(K_POLL_TYPE_SIGNAL,
+														  K_POLL_MODE_NOTIFY_ONLY, &adc_signal);
 	int err;
 
-	const struct adc_sequence sequence = {
-		.channels = BIT(channel),
-		.buffer = m_sample_buffer,
-		.buffer_size = sizeof(m_sample_buffer), // in bytes!
-		.resolution = ADC_RESOLUTION,
-	};
-
-	if (!adc_dev)
+	activity_add(ACTIVITY_ADC, 1);
+	k_poll_signal_reset(&adc_signal);
+	err = adc_read_async(adc_channels[0].dev, seq, &adc_signal);
+	if (!err)
 	{
-		return -1;
+		err = k_poll(&event, 1, K_MSEC(ADC_TIMEOUT_MS));
 	}
-
-	err = adc_read(adc_dev, &sequence);
 	if (err)
 	{
 		LOG_WRN("ADC read err: %d\n", err);
+	}
+	return err;
+}
+
+int adc_scan(struct adc_snapshot *snap)
+{
+	int err;
+
+	if (!adc_ready)
+	{
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&adc_lock, K_FOREVER);
 
+	err = adc_convert(&sequence);
+	if (err)
+	{
+		k_mutex_unlock(&adc_lock);
 		return err;
 	}
 
-	float sample_value = 0;
-	for (int i = 0; i < BUFFER_SIZE; i++)
+	for (int ch = 0; ch < ADC_CHANNEL_COUNT; ++ch)
 	{
-		sample_value += (float)m_sample_buffer[i];
+		int32_t sum = 0;
+
+		for (int i = 0; i < ADC_OVERSAMPLE; ++i)
+		{
+			sum += sample_buffer[i][sample_pos[ch]];
+		}
+		sum = MAX(sum, 0);
+		snap->mv[ch] = (sum * INPUT_MV_RANGE) / (VALUE_RANGE_10_BIT * ADC_OVERSAMPLE);
+	}
+	// the vane follows the replayed trace, power and temperature stay real
+	if (IS_ENABLED(CONFIG_WIND_PULSE_COUNTER_SIM))
+	{
+		snap->mv[ADC_WIND_DIR_ID] = wind_trace_direction_mv();
 	}
-	//	printk("   buf: %d\n", m_sample_buffer[0] );
-	sample_value /= BUFFER_SIZE;
-	*battery_voltage = (uint16_t)(sample_value * (INPUT_VOLT_RANGE / VALUE_RANGE_10_BIT));
-	//	*battery_voltage = (uint16_t)(sample_value * (INPUT_VOLT_RANGE / VALUE_RANGE_10_BIT) * ((BATVOLT_R1 + BATVOLT_R2) / BATVOLT_R2));
 
+	k_mutex_unlock(&adc_lock);
 	return 0;
 }
 
-// initalize all ADC channels
-bool init_adc()
+// Get the voltage of one channel in millivolts, return 0 if successful
+int get_adc_voltage(uint8_t channel, uint16_t *voltage)
 {
 	int err;
 
-	adc_dev = DEVICE_DT_GET(ADC_NODE);
-	if (!adc_dev)
+	if (channel >= ADC_CHANNEL_COUNT)
 	{
-		LOG_WRN("Error getting adc failed\n");
-
-		return false;
+		return -EINVAL;
 	}
-
-	err = adc_channel_setup(adc_dev, &m_1st_channel_cfg);
-	if (err)
+	if (!adc_ready)
 	{
-		LOG_WRN("Error in adc setup: %d\n", err);
+		return -ENODEV;
+	}
+
+	k_mutex_lock(&adc_lock, K_FOREVER);
 
-		return false;
+	single_sequence.channels = BIT(adc_channels[channel].channel_id);
+	err = adc_convert(&single_sequence);
+	if (!err)
+	{
+		*voltage = (MAX(single_buffer, 0) * INPUT_MV_RANGE) / VALUE_RANGE_10_BIT;
+	}
+	if (!err && channel == ADC_WIND_DIR_ID && IS_ENABLED(CONFIG_WIND_PULSE_COUNTER_SIM))
+	{
+		*voltage = wind_trace_direction_mv();
 	}
 
-	err = adc_channel_setup(adc_dev, &m_2nd_channel_cfg);
-	if (err)
+	k_mutex_unlock(&adc_lock);
+	return err;
+}
+
+// initalize all ADC channels
+bool init_adc()
+{
+	int err;
+
+	for (int i = 0; i < ADC_CHANNEL_COUNT; ++i)
 	{
-		LOG_WRN("Error in adc setup: %d\n", err);
+		if (!device_is_ready(adc_channels[i].dev))
+		{
+			LOG_WRN("Error getting adc failed\n");
+
+			return false;
+		}
+
+		err = adc_channel_setup_dt(&adc_channels[i]);
+		if (err)
+		{
+			LOG_WRN("Error in adc setup: %d\n", err);
 
-		return false;
+			return false;
+		}
+		sequence.channels |= BIT(adc_channels[i].channel_id);
 	}
+	sequence.resolution = adc_channels[0].resolution;
+	single_sequence.resolution = adc_channels[0].resolution;
 
-	err = adc_channel_setup(adc_dev, &m_3rd_channel_cfg);
-	if (err)
+	for (int i = 0; i < ADC_CHANNEL_COUNT; ++i)
 	{
-		LOG_WRN("Error in adc setup: %d\n", err);
-
-		return false;
+		sample_pos[i] = __builtin_popcount(sequence.channels & (BIT(adc_channels[i].channel_id) - 1));
 	}
 
+	adc_ready = true;
 	return true;
 }
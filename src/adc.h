@@ -1,22 +1,37 @@
 #ifndef _ADC_H_
 #define _ADC_H_
 
-// ADC Channel IDs
+#include <stdbool.h>
+#include <stdint.h>
+
+// ADC Channel IDs, index into the io-channels of the zephyr,user node
 #define ADC_BATTERY_VOLTAGE_ID 0
 #define ADC_WIND_DIR_ID 1
 #define ADC_TEMPERATURE_ID 2
+#define ADC_CHANNEL_COUNT 3
+
+// millivolts of every channel, taken in one conversion burst
+struct adc_snapshot
+{
+	uint16_t mv[ADC_CHANNEL_COUNT];
+};
 
 /**
- * @brief Take a temperature sample.
+ * @brief Scan all channels in one asynchronous, oversampled conversion burst.
  *
- * Value will either be a real sensor value taken from a sensor with device tree alias temp_sensor,
- * (if CONFIG_TEMP_DATA_USE_SENSOR is set) or will otherwise be a pseudorandom dummy reading.
+ * @param[out] snap - millivolts of every channel.
+ * @return int - 0 on success, otherwise, negative error code.
+ */
+int adc_scan(struct adc_snapshot *snap);
+
+/**
+ * @brief Get the voltage of a single channel in millivolts, from one
+ * conversion of that channel only.
  *
- * @param[out] temp - Pointer to the double to be filled with the taken temperature sample.
+ * @param[out] voltage - millivolts.
  * @return int - 0 on success, otherwise, negative error code.
  */
-int get_adc_voltage(uint8_t channel, uint16_t *battery_voltage);
-int get_temperature();
+int get_adc_voltage(uint8_t channel, uint16_t *voltage);
 bool init_adc();
 
 #endif /* _ADC_H_ */
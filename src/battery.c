@@ -0,0 +1,141 @@
+#include <zephyr/kernel.h>
+
+#include "battery.h"
+#include "leds.h"
+#include "power.h"
+#include "wind_sensor.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(battery, LOG_LEVEL_INF);
+
+// tiers are left this many percent above the level they were entered at
+#define TIER_HYSTERESIS_SOC 10
+
+// cold cells read low at the same charge
+#define TEMP_COMP_REF_C 20
+#define TEMP_COMP_MV_PER_C 2
+
+// filter weight is 1 / 2^shift, loaded samples count less than rested ones
+#define FILTER_SHIFT_REST 2
+#define FILTER_SHIFT_LOAD 4
+#define FILTER_FRAC 4 // fixed point bits of the filtered voltage
+
+// open circuit voltage of a single LiPo cell
+static const struct
+{
+	uint16_t mv;
+	uint8_t soc;
+} ocv_table[] = {
+	{3300, 0}, {3500, 5}, {3600, 12}, {3650, 20}, {3700, 30}, {3750, 40},
+	{3800, 50}, {3900, 65}, {4000, 78}, {4100, 90}, {4200, 100},
+};
+
+static struct battery_status status = {.soc = 100, .hours_left = UINT16_MAX};
+static uint32_t filtered_mv; // fixed point, 0 until the first sample
+
+static uint8_t soc_from_mv(uint32_t mv)
+{
+	if (mv <= ocv_table[0].mv)
+	{
+		return 0;
+	}
+	for (int i = 1; i < ARRAY_SIZE(ocv_table); ++i)
+	{
+		if (mv < ocv_table[i].mv)
+		{
+			uint32_t span_mv = ocv_table[i].mv - ocv_table[i - 1].mv;
+			uint32_t span_soc = ocv_table[i].soc - ocv_table[i - 1].soc;
+
+			return ocv_table[i - 1].soc + ((mv - ocv_table[i - 1].mv) * span_soc) / span_mv;
+		}
+	}
+	return 100;
+}
+
+// the lowest tier whose entry level is above soc, leaving a tier needs the
+// hysteresis on top
+static enum power_tier next_tier(enum power_tier tier, uint8_t soc)
+{
+	static const uint8_t enter_soc[] = {
+		[POWER_TIER_NORMAL] = 100,
+		[POWER_TIER_SAVING] = CONFIG_BATTERY_SAVING_SOC,
+		[POWER_TIER_CRITICAL] = CONFIG_BATTERY_CRITICAL_SOC,
+	};
+
+	while (tier < POWER_TIER_CRITICAL && soc < enter_soc[tier + 1])
+	{
+		++tier;
+	}
+	while (tier > POWER_TIER_NORMAL && soc >= enter_soc[tier] + TIER_HYSTERESIS_SOC)
+	{
+		--tier;
+	}
+	return tier;
+}
+
+static uint16_t hours_left(uint8_t soc)
+{
+	struct power_stats stats;
+	int64_t uptime_s = k_uptime_get() / MSEC_PER_SEC;
+	uint64_t mean_ua;
+	uint64_t hours;
+
+	power_stats_get(&stats);
+	if (uptime_s <= 0 || stats.charge_uah == 0)
+	{
+		return UINT16_MAX;
+	}
+	mean_ua = ((uint64_t)stats.charge_uah * 3600) / uptime_s;
+	if (mean_ua == 0)
+	{
+		return UINT16_MAX;
+	}
+	hours = ((uint64_t)CONFIG_BATTERY_CAPACITY_MAH * 1000 * soc / 100) / mean_ua;
+	return MIN(hours, UINT16_MAX);
+}
+
+void battery_update(uint16_t mv, int temp_c)
+{
+	bool loaded = power_state_get() == POWER_RRC_CONNECTED;
+	uint32_t ocv = mv;
+	enum power_tier tier;
+
+	// the radio draws tens of mA while connected, the cell sags
+	if (loaded)
+	{
+		ocv += CONFIG_BATTERY_LOAD_DROP_MV;
+	}
+	if (temp_c < TEMP_COMP_REF_C)
+	{
+		ocv += (TEMP_COMP_REF_C - temp_c) * TEMP_COMP_MV_PER_C;
+	}
+
+	if (filtered_mv == 0)
+	{
+		filtered_mv = ocv << FILTER_FRAC;
+	}
+	else
+	{
+		int32_t diff = (int32_t)(ocv << FILTER_FRAC) - (int32_t)filtered_mv;
+
+		filtered_mv += diff / (1 << (loaded ? FILTER_SHIFT_LOAD : FILTER_SHIFT_REST));
+	}
+
+	status.mv = filtered_mv >> FILTER_FRAC;
+	status.temp_c = temp_c;
+	status.soc = soc_from_mv(status.mv);
+	status.hours_left = hours_left(status.soc);
+
+	tier = next_tier(status.tier, status.soc);
+	if (tier != status.tier)
+	{
+		LOG_WRN("Battery %u%%, power tier %d -> %d\n", status.soc, status.tier, tier);
+		status.tier = tier;
+		wind_sensor_set_power_tier(tier);
+		leds_enable(tier == POWER_TIER_NORMAL);
+	}
+}
+
+void battery_status_get(struct battery_status *out)
+{
+	*out = status;
+}
@@ -0,0 +1,37 @@
+#ifndef _BATTERY_H_
+#define _BATTERY_H_
+
+#include <stdint.h>
+
+// Battery state of charge estimate and power tiers. Voltage is filtered,
+// corrected for load and temperature and mapped to charge with an open
+// circuit voltage table. Tiers change with hysteresis and make the station
+// sample and report less, and turn the LEDs off.
+
+enum power_tier
+{
+	POWER_TIER_NORMAL,
+	POWER_TIER_SAVING,	 // slower sampling, a report every 20 minutes
+	POWER_TIER_CRITICAL, // slowest sampling, one report per hour
+};
+
+struct battery_status
+{
+	uint16_t mv;		 // filtered open circuit estimate
+	int16_t temp_c;		 // latest temperature
+	uint8_t soc;		 // state of charge in percent
+	uint8_t tier;		 // enum power_tier
+	uint16_t hours_left; // at the mean current since boot
+};
+
+/**
+ * @brief Feed a battery measurement, steps the power tier when needed.
+ *
+ * @param mv - battery voltage in millivolts.
+ * @param temp_c - temperature in degrees Celsius.
+ */
+void battery_update(uint16_t mv, int temp_c);
+
+void battery_status_get(struct battery_status *status);
+
+#endif /* _BATTERY_H_ */
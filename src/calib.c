@@ -0,0 +1,215 @@
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "calib.h"
+#include "calib_tables.h"
+
+// the engine also builds on the host for tools/calib, without settings
+#if defined(CONFIG_SETTINGS)
+#include <zephyr/settings/settings.h>
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(calib, LOG_LEVEL_INF);
+#endif
+
+// a table with the slope of every segment precomputed, Q16 output per input
+// step, so a conversion is a search, one multiply and a shift
+struct calib_table
+{
+	uint8_t count;
+	int32_t in[CALIB_MAX_POINTS];
+	int32_t out[CALIB_MAX_POINTS];
+	int32_t slope[CALIB_MAX_POINTS - 1];
+};
+
+#define SLOPE_SHIFT 16
+
+static struct calib_table tables[CALIB_COUNT];
+
+static const struct
+{
+	const char *name;
+	const struct calib_point *points;
+	size_t count;
+} defaults[CALIB_COUNT] = {
+	[CALIB_SPEED] = {"speed", calib_speed_default, ARRAY_SIZE(calib_speed_default)},
+	[CALIB_DIRECTION] = {"direction", calib_direction_default, ARRAY_SIZE(calib_direction_default)},
+	[CALIB_TEMPERATURE] = {"temperature", calib_temperature_default, ARRAY_SIZE(calib_temperature_default)},
+	[CALIB_BATTERY] = {"battery", calib_battery_default, ARRAY_SIZE(calib_battery_default)},
+};
+
+// thousandths to units, rounded half away from zero
+static int32_t milli_round(int32_t milli)
+{
+	return milli >= 0 ? (milli + 500) / 1000 : -((500 - milli) / 1000);
+}
+
+int calib_set(enum calib_id id, const struct calib_point *points, size_t count)
+{
+	struct calib_table t;
+
+	if (id >= CALIB_COUNT || count < 2 || count > CALIB_MAX_POINTS)
+	{
+		return -EINVAL;
+	}
+	t.count = count;
+	for (size_t i = 0; i < count; ++i)
+	{
+		t.in[i] = points[i].in;
+		t.out[i] = points[i].out;
+		if (i == 0)
+		{
+			continue;
+		}
+
+		int64_t dx = (int64_t)points[i].in - points[i - 1].in;
+		int64_t dy = ((int64_t)points[i].out - points[i - 1].out) * (1 << SLOPE_SHIFT);
+		int64_t slope;
+
+		if (dx <= 0)
+		{
+			return -EINVAL;
+		}
+		slope = (dy + (dy >= 0 ? dx / 2 : -dx / 2)) / dx;
+		if (slope > INT32_MAX || slope < INT32_MIN)
+		{
+			return -EINVAL;
+		}
+		t.slope[i - 1] = slope;
+	}
+	tables[id] = t;
+	return 0;
+}
+
+int calib_find(const char *name)
+{
+	for (int id = 0; id < CALIB_COUNT; ++id)
+	{
+		if (strcmp(name, defaults[id].name) == 0)
+		{
+			return id;
+		}
+	}
+	return -ENOENT;
+}
+
+int32_t calib_convert(enum calib_id id, int32_t in)
+{
+	const struct calib_table *t = &tables[id];
+	int lo = 0;
+	int hi = t->count - 2;
+
+	// last segment starting at or below in, the end segments extrapolate
+	while (lo < hi)
+	{
+		int mid = (lo + hi + 1) / 2;
+
+		if (in >= t->in[mid])
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid - 1;
+		}
+	}
+	// rounded to the nearest thousandth, so exact table points stay exact
+	return t->out[lo] + (int32_t)(((int64_t)(in - t->in[lo]) * t->slope[lo] + (1 << (SLOPE_SHIFT - 1))) >> SLOPE_SHIFT);
+}
+
+uint8_t calib_speed_mph(uint32_t mhz)
+{
+	int32_t milli = calib_convert(CALIB_SPEED, MIN(mhz, INT32_MAX));
+
+	// truncated, a light air below 1 mph still reads calm
+	return CLAMP(milli / 1000, 0, UINT8_MAX);
+}
+
+uint16_t calib_direction(uint16_t mv)
+{
+	int32_t degrees = milli_round(calib_convert(CALIB_DIRECTION, mv)) % 360;
+
+	return degrees < 0 ? degrees + 360 : degrees;
+}
+
+int16_t calib_temperature_c(uint16_t mv)
+{
+	return CLAMP(milli_round(calib_convert(CALIB_TEMPERATURE, mv)), INT16_MIN, INT16_MAX);
+}
+
+uint16_t calib_battery_mv(uint16_t mv)
+{
+	return CLAMP(milli_round(calib_convert(CALIB_BATTERY, mv)), 0, UINT16_MAX);
+}
+
+#if defined(CONFIG_SETTINGS)
+
+static int settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	struct calib_point points[CALIB_MAX_POINTS];
+	const char *next;
+	int rc;
+
+	for (int id = 0; id < CALIB_COUNT; ++id)
+	{
+		if (!settings_name_steq(name, defaults[id].name, &next) || next)
+		{
+			continue;
+		}
+		if (len % sizeof(points[0]) != 0 || len > sizeof(points))
+		{
+			return -EINVAL;
+		}
+		rc = read_cb(cb_arg, points, len);
+		if (rc < 0)
+		{
+			return rc;
+		}
+		if (calib_set(id, points, rc / sizeof(points[0])) != 0)
+		{
+			LOG_WRN("Saved %s calibration rejected, using the default\n", defaults[id].name);
+		}
+		return 0;
+	}
+	return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(calib, "calib", NULL, settings_set, NULL, NULL);
+
+int calib_save(enum calib_id id, const struct calib_point *points, size_t count)
+{
+	char key[32];
+	int err = calib_set(id, points, count);
+
+	if (err)
+	{
+		return err;
+	}
+	snprintf(key, sizeof(key), "calib/%s", defaults[id].name);
+	return settings_save_one(key, points, count * sizeof(points[0]));
+}
+
+#else
+
+int calib_save(enum calib_id id, const struct calib_point *points, size_t count)
+{
+	return calib_set(id, points, count);
+}
+
+#endif
+
+void calib_init(void)
+{
+	for (int id = 0; id < CALIB_COUNT; ++id)
+	{
+		// the generator checked the defaults, this can not fail
+		calib_set(id, defaults[id].points, defaults[id].count);
+	}
+#if defined(CONFIG_SETTINGS)
+	if (settings_subsys_init() == 0)
+	{
+		settings_load_subtree("calib");
+	}
+#endif
+}
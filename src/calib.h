@@ -0,0 +1,69 @@
+#ifndef _CALIB_H_
+#define _CALIB_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Sensor calibration with piecewise linear tables, in integer fixed point.
+// The default tables are generated at build time from calibration/*.csv,
+// a table saved in settings under calib/<name> replaces its default.
+//
+// Table outputs are in thousandths of the output unit, so a two point
+// table already gives sub-unit resolution. Inputs between the points are
+// interpolated, inputs outside are extrapolated from the end segments.
+
+#define CALIB_MAX_POINTS 16
+
+enum calib_id
+{
+	CALIB_SPEED,	   // pulse rate in mHz to milli-mph
+	CALIB_DIRECTION,   // vane mV to milli-degrees, wrapped to 0..359 degrees
+	CALIB_TEMPERATURE, // sensor mV to milli-degrees C
+	CALIB_BATTERY,	   // divider mV to battery uV
+	CALIB_COUNT
+};
+
+struct calib_point
+{
+	int32_t in;
+	int32_t out;
+};
+
+/**
+ * @brief Load the default tables, then the ones saved in settings.
+ */
+void calib_init(void);
+
+/**
+ * @brief Replace a table until reboot. Call from the system work queue,
+ * where the conversions run.
+ *
+ * @param points - 2 to CALIB_MAX_POINTS points, inputs strictly ascending.
+ * @return int - 0 on success, -EINVAL if the table is not usable.
+ */
+int calib_set(enum calib_id id, const struct calib_point *points, size_t count);
+
+/**
+ * @brief Replace a table and keep it in settings, from the system work
+ * queue like calib_set().
+ */
+int calib_save(enum calib_id id, const struct calib_point *points, size_t count);
+
+/**
+ * @brief Table by its settings name, calib/<name>.
+ *
+ * @return int - the calib_id, -ENOENT if there is no such table.
+ */
+int calib_find(const char *name);
+
+/**
+ * @brief Raw table lookup, in thousandths of the output unit.
+ */
+int32_t calib_convert(enum calib_id id, int32_t in);
+
+uint8_t calib_speed_mph(uint32_t mhz);
+uint16_t calib_direction(uint16_t mv);
+int16_t calib_temperature_c(uint16_t mv);
+uint16_t calib_battery_mv(uint16_t mv);
+
+#endif /* _CALIB_H_ */
@@ -0,0 +1,258 @@
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "calib.h"
+#include "commands.h"
+#include "power.h"
+#include "wind_sensor.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(commands, LOG_LEVEL_INF);
+
+#define WAKEY_MODE "wake"
+#define SLEEPY_MODE "sleep"
+#define SAMPLE_FAST "fast"
+#define SAMPLE_SLOW "slow"
+#define REPORT "report"
+
+#define SAMPLE_PERIOD "period="
+#define SAMPLE_DURATION "duration="
+#define REPORT_INTERVAL "interval="
+#define CALIBRATION "calib="
+
+// a calibration table is the longest command
+#define CMD_MAX_LEN CONFIG_MQTT_PAYLOAD_BUFFER_SIZE
+
+static const struct wind_config fast_config = {
+	.sample_period_s = 1,
+	.sample_duration_s = 3,
+};
+
+static const struct wind_config slow_config = {
+	.sample_period_s = 10,
+	.sample_duration_s = 10,
+};
+
+static int settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+	struct wind_config cfg;
+	int rc;
+
+	if (!settings_name_steq(name, "cfg", &next) || next)
+	{
+		return -ENOENT;
+	}
+	if (len != sizeof(cfg))
+	{
+		return -EINVAL;
+	}
+
+	rc = read_cb(cb_arg, &cfg, sizeof(cfg));
+	if (rc < 0)
+	{
+		return rc;
+	}
+
+	if (wind_sensor_set_config(&cfg) != 0)
+	{
+		LOG_WRN("Saved wind config rejected\n");
+	}
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(wind, "wind", NULL, settings_set, NULL, NULL);
+
+// applies a new cadence and keeps it across reboots
+static int apply_config(const struct wind_config *cfg)
+{
+	int err = wind_sensor_set_config(cfg);
+
+	if (err)
+	{
+		LOG_WRN("Rejected config: period %d duration %d interval %d\n",
+				cfg->sample_period_s, cfg->sample_duration_s, cfg->report_minutes);
+		return err;
+	}
+
+	err = settings_save_one("wind/cfg", cfg, sizeof(*cfg));
+	if (err)
+	{
+		LOG_WRN("Failed to save config: %d\n", err);
+	}
+	return err;
+}
+
+// a received table, saved from the system work queue where the
+// conversions run
+static struct
+{
+	enum calib_id id;
+	struct calib_point points[CALIB_MAX_POINTS];
+	size_t count;
+} calib_pending;
+
+static void calib_work_cb(struct k_work *work)
+{
+	int err;
+
+	ARG_UNUSED(work);
+	err = calib_save(calib_pending.id, calib_pending.points, calib_pending.count);
+	if (err)
+	{
+		LOG_WRN("Calibration %d not saved: %d\n", calib_pending.id, err);
+	}
+}
+
+static K_WORK_DEFINE(calib_work, calib_work_cb);
+
+// parses <name>,<in>:<out>,<in>:<out>,... into calib_pending
+static int parse_calib(char *str)
+{
+	char *pos = strchr(str, ',');
+	int id;
+
+	if (pos == NULL)
+	{
+		return -EINVAL;
+	}
+	*pos = '\0';
+	id = calib_find(str);
+	if (id < 0)
+	{
+		return id;
+	}
+	// a save still pending keeps its table
+	if (k_work_busy_get(&calib_work) != 0)
+	{
+		return -EBUSY;
+	}
+	calib_pending.id = id;
+	calib_pending.count = 0;
+	while (*pos == ',')
+	{
+		struct calib_point *p = &calib_pending.points[calib_pending.count];
+		char *end;
+
+		if (calib_pending.count == CALIB_MAX_POINTS)
+		{
+			return -EINVAL;
+		}
+		p->in = strtol(pos + 1, &end, 10);
+		if (end == pos + 1 || *end != ':')
+		{
+			return -EINVAL;
+		}
+		pos = end + 1;
+		p->out = strtol(pos, &end, 10);
+		if (end == pos)
+		{
+			return -EINVAL;
+		}
+		pos = end;
+		++calib_pending.count;
+	}
+	return *pos == '\0' ? 0 : -EINVAL;
+}
+
+// parses the number after a key=, returns -1 if it is not a number
+static int parse_value(const char *str)
+{
+	char *end;
+	long value = strtol(str, &end, 10);
+
+	if (end == str || *end != '\0' || value < 0 || value > UINT8_MAX)
+	{
+		return -1;
+	}
+	return value;
+}
+
+int command_handle(const uint8_t *buf, size_t len)
+{
+	char cmd[CMD_MAX_LEN + 1];
+	struct wind_config cfg;
+	int value;
+
+	if (len > CMD_MAX_LEN)
+	{
+		return -EMSGSIZE;
+	}
+	memcpy(cmd, buf, len);
+	cmd[len] = '\0';
+
+	wind_sensor_get_config(&cfg);
+
+	if (strcmp(cmd, REPORT) == 0)
+	{
+		wind_sensor_report_now();
+		return 0;
+	}
+	if (strcmp(cmd, WAKEY_MODE) == 0 || strcmp(cmd, SLEEPY_MODE) == 0)
+	{
+		return power_psm_enable(strcmp(cmd, SLEEPY_MODE) == 0);
+	}
+	if (strncmp(cmd, CALIBRATION, strlen(CALIBRATION)) == 0)
+	{
+		int err = parse_calib(cmd + strlen(CALIBRATION));
+
+		if (err)
+		{
+			LOG_WRN("Bad calibration: %d\n", err);
+			return err;
+		}
+		k_work_submit(&calib_work);
+		return 0;
+	}
+	if (strcmp(cmd, SAMPLE_FAST) == 0 || strcmp(cmd, SAMPLE_SLOW) == 0)
+	{
+		const struct wind_config *preset = (cmd[0] == 'f') ? &fast_config : &slow_config;
+
+		cfg.sample_period_s = preset->sample_period_s;
+		cfg.sample_duration_s = preset->sample_duration_s;
+		return apply_config(&cfg);
+	}
+
+	if (strncmp(cmd, SAMPLE_PERIOD, strlen(SAMPLE_PERIOD)) == 0)
+	{
+		value = parse_value(cmd + strlen(SAMPLE_PERIOD));
+		cfg.sample_period_s = value;
+		// keep the gust window valid for the new period
+		cfg.sample_duration_s = MAX(cfg.sample_duration_s, value);
+	}
+	else if (strncmp(cmd, SAMPLE_DURATION, strlen(SAMPLE_DURATION)) == 0)
+	{
+		value = parse_value(cmd + strlen(SAMPLE_DURATION));
+		cfg.sample_duration_s = value;
+	}
+	else if (strncmp(cmd, REPORT_INTERVAL, strlen(REPORT_INTERVAL)) == 0)
+	{
+		value = parse_value(cmd + strlen(REPORT_INTERVAL));
+		cfg.report_minutes = value;
+	}
+	else
+	{
+		LOG_WRN("Unknown command: %s\n", cmd);
+		return -EINVAL;
+	}
+
+	if (value < 0)
+	{
+		LOG_WRN("Bad value: %s\n", cmd);
+		return -EINVAL;
+	}
+	return apply_config(&cfg);
+}
+
+void init_commands()
+{
+	int err = settings_subsys_init();
+
+	if (err)
+	{
+		LOG_WRN("settings init failed: %d\n", err);
+		return;
+	}
+	settings_load_subtree("wind");
+}
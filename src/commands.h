@@ -0,0 +1,32 @@
+#ifndef _COMMANDS_H_
+#define _COMMANDS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Commands received on <primary>/<station>/CONFIG_MQTT_CMD_TOPIC:
+//   fast, slow        preset sample period and gust window
+//   period=<s>        sample period in seconds
+//   duration=<s>      gust averaging window in seconds
+//   interval=<min>    report interval in minutes, must divide an hour
+//   report            publish the current hour and health data now
+//   wake, sleep       turn LTE power saving off or back on
+//   calib=<name>,<in>:<out>,...
+//                     replace a calibration table, see calib.h, names
+//                     as in calib/<name>: speed, direction, temperature,
+//                     battery
+// Accepted cadence changes and tables are saved with the settings subsystem.
+
+/**
+ * @brief Load the saved cadence, call after init_wind_sensor().
+ */
+void init_commands();
+
+/**
+ * @brief Parse and run one command.
+ *
+ * @return int - 0 on success, otherwise, negative error code.
+ */
+int command_handle(const uint8_t *buf, size_t len);
+
+#endif /* _COMMANDS_H_ */
@@ -0,0 +1,157 @@
+#include <zephyr/kernel.h>
+
+#include "direction.h"
+
+#define Q14_ONE 16384
+
+// sin(degrees) for 0 to 90 degrees, Q14
+static const int16_t sin_table[91] = {
+	0, 286, 572, 857, 1143, 1428, 1713, 1997, 2280, 2563,
+	2845, 3126, 3406, 3686, 3964, 4240, 4516, 4790, 5063, 5334,
+	5604, 5872, 6138, 6402, 6664, 6924, 7182, 7438, 7692, 7943,
+	8192, 8438, 8682, 8923, 9162, 9397, 9630, 9860, 10087, 10311,
+	10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+	12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+	14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+	15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+	16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+	16384,
+};
+
+static int32_t sin_deg(int degrees)
+{
+	degrees %= 360;
+	if (degrees < 90)
+	{
+		return sin_table[degrees];
+	}
+	if (degrees < 180)
+	{
+		return sin_table[180 - degrees];
+	}
+	if (degrees < 270)
+	{
+		return -sin_table[degrees - 180];
+	}
+	return -sin_table[360 - degrees];
+}
+
+static int32_t cos_deg(int degrees)
+{
+	return sin_deg(degrees + 90);
+}
+
+// atan2 in whole degrees, 0 to 359. Binary search for the angle where
+// y * cos(a) - x * sin(a) changes sign in the first quadrant, no division.
+static int atan2_deg(int64_t y, int64_t x)
+{
+	int64_t ax = (x < 0) ? -x : x;
+	int64_t ay = (y < 0) ? -y : y;
+	int lo = 0;
+	int hi = 90;
+
+	// scale down so the products below can not overflow
+	while (ax > INT32_MAX || ay > INT32_MAX)
+	{
+		ax >>= 1;
+		ay >>= 1;
+	}
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+
+		if (ay * sin_table[90 - mid] - ax * sin_table[mid] > 0)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	// lo is the first angle past the root, round to the nearer one
+	if (lo > 0)
+	{
+		int64_t past = ax * sin_table[lo] - ay * sin_table[90 - lo];
+		int64_t before = ay * sin_table[90 - lo + 1] - ax * sin_table[lo - 1];
+
+		if (before < past)
+		{
+			--lo;
+		}
+	}
+
+	if (x >= 0)
+	{
+		return (y >= 0) ? lo : (360 - lo) % 360;
+	}
+	return (y >= 0) ? 180 - lo : 180 + lo;
+}
+
+static uint64_t isqrt(uint64_t v)
+{
+	uint64_t root = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > v)
+	{
+		bit >>= 2;
+	}
+	while (bit)
+	{
+		if (v >= root + bit)
+		{
+			v -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else
+		{
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+void dir_accum_reset(struct dir_accum *acc)
+{
+	*acc = (struct dir_accum){0};
+}
+
+void dir_accum_add(struct dir_accum *acc, uint16_t degrees, uint32_t weight)
+{
+	int32_t c = cos_deg(degrees);
+	int32_t s = sin_deg(degrees);
+
+	acc->x += c;
+	acc->y += s;
+	acc->wx += (int64_t)c * weight;
+	acc->wy += (int64_t)s * weight;
+	++acc->count;
+}
+
+int dir_accum_mean(const struct dir_accum *acc, bool weighted)
+{
+	if (acc->count == 0)
+	{
+		return -1;
+	}
+	if (weighted && (acc->wx != 0 || acc->wy != 0))
+	{
+		return atan2_deg(acc->wy, acc->wx);
+	}
+	return atan2_deg(acc->y, acc->x);
+}
+
+uint8_t dir_accum_steadiness(const struct dir_accum *acc)
+{
+	if (acc->count == 0)
+	{
+		return 0;
+	}
+
+	uint64_t len = isqrt((uint64_t)((int64_t)acc->x * acc->x) + (uint64_t)((int64_t)acc->y * acc->y));
+
+	return MIN((len * 100) / ((uint64_t)acc->count * Q14_ONE), 100);
+}
@@ -0,0 +1,43 @@
+#ifndef _DIRECTION_H_
+#define _DIRECTION_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Vector (circular) mean of wind directions. Each sample adds a unit vector
+// from an integer sine table, so the mean does not depend on sample order,
+// works over any number of samples and needs no libm.
+struct dir_accum
+{
+	int32_t x; // sum of cos, Q14
+	int32_t y; // sum of sin, Q14
+	int64_t wx; // speed weighted sum of cos
+	int64_t wy; // speed weighted sum of sin
+	uint32_t count;
+};
+
+void dir_accum_reset(struct dir_accum *acc);
+
+/**
+ * @brief Add one direction sample, O(1).
+ *
+ * @param degrees - direction, 0 to 359.
+ * @param weight - speed (e.g. pulse count) at the time of the sample.
+ */
+void dir_accum_add(struct dir_accum *acc, uint16_t degrees, uint32_t weight);
+
+/**
+ * @brief Mean direction in degrees, 0 to 359, or -1 if there are no samples.
+ *
+ * @param weighted - use the speed weighted mean, falls back to the plain
+ * mean when all weights were zero.
+ */
+int dir_accum_mean(const struct dir_accum *acc, bool weighted);
+
+/**
+ * @brief Length of the mean resultant vector in percent, 100 is a steady
+ * direction, 0 is no prevailing direction.
+ */
+uint8_t dir_accum_steadiness(const struct dir_accum *acc);
+
+#endif /* _DIRECTION_H_ */
@@ -6,82 +6,76 @@
 
 #include "leds.h"
 #include "health.h"
+#include "activity.h"
 #include "adc.h"
+#include "battery.h"
+#include "calib.h"
 #include "mqtt_connection.h"
+#include "payload.h"
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(health, LOG_LEVEL_INF);
 
-#define NUM_PWR 12
-
-int n_pwr = NUM_PWR - 1;
-uint16_t volts[NUM_PWR];
-uint16_t temperature[NUM_PWR];
-static uint16_t current_volts;
-
-
-#define BATVOLT_R1 4.7f
-#define BATVOLT_R2 10.0f
-
-static int get_battery_voltage()
+// battery voltage behind the divider, calibration/battery.csv
+static int get_battery_voltage(const struct adc_snapshot *snap)
 {
-	uint16_t volts;
-	int corrected;
+	uint16_t volts = snap->mv[ADC_BATTERY_VOLTAGE_ID];
+	int corrected = calib_battery_mv(volts);
 
-	get_adc_voltage(ADC_BATTERY_VOLTAGE_ID, &volts);
-	corrected = (volts * ((BATVOLT_R1 + BATVOLT_R2) / BATVOLT_R2));
 	LOG_DBG("battery %d  %d\n", volts, corrected);
 	return corrected;
 }
 
-static int get_annie_temperature()
+// temperature in C, calibration/temperature.csv
+static int get_annie_temperature(const struct adc_snapshot *snap)
 {
-	const int T1 = 0;	 // low C temp
-	const int T2 = 50;	 // high C temp
-	const int V1 = 2100; // low voltage
-	const int V2 = 1558; // high voltage
-	int temperature;
-
-	uint16_t volts;
-
-	get_adc_voltage(ADC_TEMPERATURE_ID, &volts);
-
-	temperature = T1 + (volts - V1) * (T2 - T1) / (V2 - V1); // conversion
-	temperature = (temperature * 9.0 / 5.0) + 32;			 // F conversion
-	return temperature;
+	return calib_temperature_c(snap->mv[ADC_TEMPERATURE_ID]);
 }
 
-static void report_power(uint8_t *buf)
+void health_sample(void)
 {
-	current_volts = get_battery_voltage();
-	volts[n_pwr] = current_volts;
-
-	temperature[n_pwr] = get_annie_temperature();
-	buf += sprintf(buf, "{\"pwr\":[");
+	struct adc_snapshot snap;
 
-	for (int i = n_pwr; i < NUM_PWR + n_pwr; ++i)
+	// battery and temperature from the same conversion burst
+	if (adc_scan(&snap) != 0)
 	{
-		buf += sprintf(buf, "[%d, %d],", volts[i % NUM_PWR], temperature[i % NUM_PWR]);
+		return;
 	}
-	--buf; // remove the last comma
-	sprintf(buf, "]}");
-
-	n_pwr = (n_pwr - 1 + NUM_PWR) % NUM_PWR;
+	battery_update(get_battery_voltage(&snap), get_annie_temperature(&snap));
 }
 
+static int report_power(uint8_t *buf, size_t size)
+{
+	struct battery_status bat;
+	struct activity_delta act;
 
+	battery_status_get(&bat);
+	activity_take_delta(&act);
+	return payload_health(buf, size, mqtt_station_id(), &bat, &act);
+}
 
 void publish_health_data()
 {
 	int err;
+	struct mqtt_msg *msg = mqtt_msg_alloc(K_NO_WAIT);
 
-	uint8_t * msgbuf = get_mqtt_message_buf();
-	uint8_t * topicbuf = get_mqtt_topic_buf();
+	if (msg == NULL)
+	{
+		LOG_WRN("No message buffer for pwr message\n");
+		return;
+	}
 
-	report_power(msgbuf);
-	sprintf(topicbuf, "%s/health", CONFIG_MQTT_PRIMARY_TOPIC);
+	int len = report_power(msg->payload, sizeof(msg->payload));
+	if (len < 0)
+	{
+		LOG_WRN("Failed to encode pwr message, %d\n", len);
+		mqtt_msg_free(msg);
+		return;
+	}
+	msg->len = len;
+	msg->retain = 1;
+	payload_topic(msg->topic, sizeof(msg->topic), mqtt_station_id(), "health");
 
-	err = data_publish(MQTT_QOS_1_AT_LEAST_ONCE,
-					   msgbuf, strlen(msgbuf), topicbuf, 1);
+	err = data_publish(msg);
 	if (err)
 	{
 		LOG_WRN("Failed to send pwr message, %d\n", err);
@@ -91,5 +85,6 @@ void publish_health_data()
 
 void init_health()
 {
-
+	// first estimate before the first report
+	health_sample();
 }
@@ -3,6 +3,11 @@
 
 
 
+/**
+ * @brief Measure battery and temperature and update the charge estimate.
+ */
+void health_sample(void);
+
 void publish_health_data();
 
 void init_health();
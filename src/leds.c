@@ -24,6 +24,7 @@ static struct gpio_dt_spec green_led = GPIO_DT_SPEC_GET(GREEN_LED_NODE, gpios);
 static struct gpio_dt_spec blue_led = GPIO_DT_SPEC_GET(BLUE_LED_NODE, gpios);
 
 static bool button_pressed = false;
+static bool leds_enabled = true;
 
 void button_pressed_callback(const struct device *gpiob, struct gpio_callback *cb, gpio_port_pins_t pins)
 {
@@ -84,8 +85,22 @@ void turn_leds_off(void)
     gpio_pin_set_dt(&blue_led, LED_OFF);
 }
 
+void leds_enable(bool enable)
+{
+    leds_enabled = enable;
+    if (!enable)
+    {
+        turn_leds_off();
+    }
+}
+
 void turn_leds_on_with_color(led_color_t color)
 {
+    if (!leds_enabled)
+    {
+        return;
+    }
+
     switch (color)
     {
     case RED:
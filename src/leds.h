@@ -1,6 +1,8 @@
 #ifndef _LEDS_H_
 #define _LED_H_
 
+#include <stdbool.h>
+
 typedef enum
 {
     RED,
@@ -16,6 +18,8 @@ typedef enum
 void init_leds(void);
 void turn_leds_off(void);
 void turn_leds_on_with_color(led_color_t color);
+// LEDs stay off while disabled, e.g. on low battery
+void leds_enable(bool enable);
 
 
 #endif /* _LED_H_ */
@@ -17,8 +17,14 @@
 #include "wind_sensor.h"
 
 #include "leds.h"
+#include "activity.h"
 #include "adc.h"
 #include "health.h"
+#include "report_store.h"
+#include "power.h"
+#include "commands.h"
+#include "mqtt_tls.h"
+#include "calib.h"
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
@@ -30,6 +36,8 @@ static K_SEM_DEFINE(lte_connected, 0, 1);
 
 static void lte_handler(const struct lte_lc_evt *const evt)
 {
+    power_lte_event(evt);
+
     switch (evt->type)
     {
     case LTE_LC_EVT_NW_REG_STATUS:
@@ -60,9 +68,11 @@ static void modem_configure(void)
         LOG_ERR("Modem could not be configured, error: %d\n", err);
         return;
     }
+    power_init();
     k_sem_take(&lte_connected, K_FOREVER);
     turn_leds_on_with_color(CYAN);
 
+    activity_modem_init();
     LOG_INF("Connected to LTE network\n");
 }
 
@@ -74,22 +84,31 @@ void main(void)
     int err;
  
     init_adc();
+    calib_init();
+    report_store_init();
+
+    // key storage can only be written while the modem is offline
+    if (IS_ENABLED(CONFIG_MQTT_TLS) && mqtt_tls_provision() != 0)
+    {
+        LOG_ERR("No TLS credentials, the broker connection will fail\n");
+    }
 
     modem_configure();
 
     turn_leds_on_with_color(YELLOW);
 
-    err = client_init();
-    if (err)
+    // no broker address or station ID yet, nothing can be published
+    while ((err = client_init()) != 0)
     {
         LOG_ERR("Failed to initialize MQTT client: %d\n", err);
-        return;
+        k_sleep(K_SECONDS(CONFIG_MQTT_RECONNECT_DELAY_S));
     }
     setenv("TZ", "PST8PDT", 1);
     struct _reent r;
     _tzset_r(&r);
 
     init_wind_sensor();
+    init_commands();
     init_health();
 
     mqtt_idleloop();  // does not return
@@ -2,11 +2,16 @@
 #include <string.h>
 
 #include <zephyr/kernel.h>
-#include <zephyr/random/rand32.h>
 #include <zephyr/net/mqtt.h>
+#include <zephyr/posix/sys/eventfd.h>
 #include <nrf_modem_at.h>
 #include <zephyr/logging/log.h>
 #include "mqtt_connection.h"
+#include "activity.h"
+#include "mqtt_tls.h"
+#include "report_store.h"
+#include "commands.h"
+#include "payload.h"
 
 /* Buffers for MQTT client. */
 static uint8_t rx_buffer[CONFIG_MQTT_MESSAGE_BUFFER_SIZE];
@@ -18,29 +23,51 @@ static struct sockaddr_storage broker;
 
 /* The mqtt client struct */
 static struct mqtt_client client;
-/* File descriptor */
-static struct pollfd fds;
+/* File descriptors, the socket and the wakeup of data_publish() */
+static struct pollfd fds[2];
+static int wake_fd = -1;
+/* Set between CONNACK and disconnect */
+static bool connected;
+
+/* Report buffers, the queue hands them to the MQTT thread */
+K_MEM_SLAB_DEFINE_STATIC(msg_slab, sizeof(struct mqtt_msg), CONFIG_MQTT_MSG_POOL_SIZE, 4);
+K_MSGQ_DEFINE(publish_q, sizeof(struct mqtt_msg *), CONFIG_MQTT_MSG_POOL_SIZE, 4);
+
+/* QoS 1 messages sent and waiting for their PUBACK */
+static struct mqtt_msg *inflight[CONFIG_MQTT_INFLIGHT_WINDOW];
+static int inflight_count;
+static uint16_t next_message_id = 1;
+static struct mqtt_delivery_stats delivery;
 
 // LOG_MODULE_DECLARE(AnnieM);
 LOG_MODULE_REGISTER(mqtt_con, LOG_LEVEL_INF);
 
-#define WAKEY_MODE "wake"
-#define SAMPLE_FAST "fast"
-#define SAMPLE_SLOW "slow"
-#define REPORT "report"
-
+struct mqtt_msg *mqtt_msg_alloc(k_timeout_t timeout)
+{
+	struct mqtt_msg *msg;
 
-uint8_t _mqtt_message_buf[200];
-uint8_t _mqtt_topic_buf[80];
+	if (k_mem_slab_alloc(&msg_slab, (void **)&msg, timeout) != 0)
+	{
+		return NULL;
+	}
+	msg->qos = MQTT_QOS_1_AT_LEAST_ONCE;
+	msg->retain = 0;
+	msg->stored = false;
+	msg->store_seq = 0;
+	msg->retries = 0;
+	msg->len = 0;
+	msg->topic[0] = '\0';
+	return msg;
+}
 
-uint8_t * get_mqtt_message_buf()
+void mqtt_msg_free(struct mqtt_msg *msg)
 {
-	return _mqtt_message_buf;
+	k_mem_slab_free(&msg_slab, (void **)&msg);
 }
 
-uint8_t * get_mqtt_topic_buf()
+uint32_t mqtt_msg_free_count(void)
 {
-	return _mqtt_topic_buf;
+	return k_mem_slab_num_free_get(&msg_slab);
 }
 
 
@@ -85,22 +112,60 @@ static int get_received_payload(struct mqtt_client *c, size_t length)
 	return err;
 }
 
+static bool message_id_in_flight(uint16_t id)
+{
+	for (int i = 0; i < ARRAY_SIZE(inflight); ++i)
+	{
+		if (inflight[i] && inflight[i]->message_id == id)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+/**@brief Next packet identifier, sequential, skips 0 and IDs still in flight
+ */
+static uint16_t message_id_get(void)
+{
+	uint16_t id;
+
+	do
+	{
+		id = next_message_id++;
+		if (next_message_id == 0)
+		{
+			next_message_id = 1;
+		}
+	} while (message_id_in_flight(id));
+	return id;
+}
+
 /**@brief Function to subscribe to the configured topic
  */
 /* STEP 4 - Define the function subscribe() to subscribe to a specific topic.  */
 static int subscribe(struct mqtt_client *const c)
 {
+	// each station only hears its own commands
+	static char cmd_topic[MQTT_TOPIC_BUF_SIZE];
+
+	if (payload_topic(cmd_topic, sizeof(cmd_topic), mqtt_station_id(), CONFIG_MQTT_CMD_TOPIC) < 0)
+	{
+		return -ENOMEM;
+	}
+
 	struct mqtt_topic subscribe_topic = {
 		.topic = {
-			.utf8 = CONFIG_MQTT_CMD_TOPIC,
-			.size = strlen(CONFIG_MQTT_CMD_TOPIC)},
+			.utf8 = cmd_topic,
+			.size = strlen(cmd_topic)},
 		.qos = MQTT_QOS_1_AT_LEAST_ONCE};
 	const struct mqtt_subscription_list subscription_list = {
 		.list = &subscribe_topic,
 		.list_count = 1,
-		.message_id = 1234};
-	LOG_INF("Subscribing to: %s len %u\n", CONFIG_MQTT_CMD_TOPIC,
-			(unsigned int)strlen(CONFIG_MQTT_CMD_TOPIC));
+		.message_id = message_id_get()};
+	LOG_INF("Subscribing to: %s len %u\n", cmd_topic,
+			(unsigned int)strlen(cmd_topic));
+	activity_add(ACTIVITY_MQTT_TX, 1);
 	return mqtt_subscribe(c, &subscription_list);
 }
 
@@ -115,34 +180,258 @@ static void data_print(uint8_t *prefix, uint8_t *data, size_t len)
 	printk("%s%s\n", (char *)prefix, (char *)buf);
 }
 
-/**@brief Function to publish data on the configured topic
+/**@brief Sends one message, called on the MQTT thread only
  */
-/* STEP 7.1 - Define the function data_publish() to publish data */
-int data_publish(enum mqtt_qos qos,
-				 uint8_t *data, size_t len, uint8_t *topic, uint8_t retain)
+static int publish_msg(struct mqtt_msg *msg, bool dup)
 {
-	if (len > CONFIG_MQTT_MESSAGE_BUFFER_SIZE)
+	struct mqtt_publish_param param;
+
+	param.message.topic.qos = msg->qos;
+	param.message.topic.topic.utf8 = (const uint8_t *)msg->topic;
+	param.message.topic.topic.size = strlen(msg->topic);
+	param.message.payload.data = msg->payload;
+	param.message.payload.len = msg->len;
+	param.message_id = msg->message_id;
+	param.dup_flag = dup;
+	param.retain_flag = msg->retain;
+	if (msg->len > 2)
 	{
-		LOG_ERR("_mqtt_message_buf overflow: %d\n", len);
-		len = CONFIG_MQTT_MESSAGE_BUFFER_SIZE - 1;
+		data_print("Pub: ", msg->payload, msg->len);
 	}
-	struct mqtt_publish_param param;
-	param.message.topic.qos = qos;
-	param.message.topic.topic.utf8 = topic; // CONFIG_MQTT_PUB_TOPIC;
-	param.message.topic.topic.size = strlen(topic);
-	param.message.payload.data = data;
-	param.message.payload.len = len;
-	param.message_id = sys_rand32_get();
-	param.dup_flag = 0;
-	param.retain_flag = retain;
-	if (len > 2)
-	{
-		data_print("Pub: ", data, len);
-	}
-	//	printk("to topic: %s len: %u\n", topic, (unsigned int)strlen(topic));
+	activity_add(ACTIVITY_MQTT_TX, 1);
+	activity_add(ACTIVITY_MQTT_TX_B, param.message.topic.topic.size + msg->len);
 	return mqtt_publish(&client, &param);
 }
 
+static void inflight_add(struct mqtt_msg *msg)
+{
+	for (int i = 0; i < ARRAY_SIZE(inflight); ++i)
+	{
+		if (inflight[i] == NULL)
+		{
+			inflight[i] = msg;
+			++inflight_count;
+			return;
+		}
+	}
+}
+
+/**@brief Correlates a PUBACK with its message, records the latency and frees it
+ */
+static void inflight_ack(uint16_t message_id)
+{
+	for (int i = 0; i < ARRAY_SIZE(inflight); ++i)
+	{
+		struct mqtt_msg *msg = inflight[i];
+
+		if (msg && msg->message_id == message_id)
+		{
+			uint32_t ms = k_uptime_get() - msg->sent_at;
+
+			++delivery.acked;
+			delivery.latency_ms_sum += ms;
+			delivery.latency_ms_max = MAX(delivery.latency_ms_max, ms);
+			LOG_DBG("PUBACK %u after %u ms, %u retries\n", message_id, ms, msg->retries);
+
+			// only now the broker has it, a stored report leaves the flash
+			if (msg->stored)
+			{
+				report_store_ack(msg->store_seq);
+			}
+			mqtt_msg_free(msg);
+			inflight[i] = NULL;
+			--inflight_count;
+			// a free slot in the window, send the backlog at link speed
+			report_store_drain_kick();
+			return;
+		}
+	}
+	LOG_WRN("PUBACK for unknown message %u\n", message_id);
+}
+
+/**@brief Sends the messages in flight again, after a timeout or a reconnect
+ *
+ * @param all - resend every message, not only those past their deadline.
+ * @param dup - the broker may have seen them, set the DUP flag.
+ * @return int - 0, or a negative error once a message ran out of retries.
+ */
+static int inflight_resend(bool all, bool dup)
+{
+	int64_t now = k_uptime_get();
+
+	for (int i = 0; i < ARRAY_SIZE(inflight); ++i)
+	{
+		struct mqtt_msg *msg = inflight[i];
+
+		if (msg == NULL || (!all && now < msg->ack_due))
+		{
+			continue;
+		}
+		if (!all && msg->retries >= CONFIG_MQTT_RETRANSMIT_MAX)
+		{
+			LOG_WRN("No PUBACK for message %u\n", msg->message_id);
+			return -ETIMEDOUT;
+		}
+
+		// a reconnect starts the retries over
+		msg->retries = all ? 0 : msg->retries + 1;
+		++delivery.retransmits;
+		msg->ack_due = now + CONFIG_MQTT_PUBACK_TIMEOUT_MS;
+		int err = publish_msg(msg, dup);
+		if (err)
+		{
+			return err;
+		}
+	}
+	return 0;
+}
+
+/**@brief Time until the next PUBACK is due
+ */
+static int32_t inflight_time_left(void)
+{
+	int64_t now = k_uptime_get();
+	int64_t left = INT32_MAX;
+
+	for (int i = 0; i < ARRAY_SIZE(inflight); ++i)
+	{
+		if (inflight[i])
+		{
+			left = MIN(left, MAX(inflight[i]->ack_due - now, 0));
+		}
+	}
+	return left;
+}
+
+/**@brief Keeps a message in flash for the next connection, frees it
+ */
+static void store_msg(struct mqtt_msg *msg)
+{
+	// a stored report is still in flash until its PUBACK, it is sent again
+	// after the reconnect. Empty retained messages only clear the
+	// broker, and QoS 0 reports are superseded by the next one, no use
+	// keeping them
+	if (!msg->stored && msg->len > 0 && msg->qos != MQTT_QOS_0_AT_MOST_ONCE && report_store_put((const uint8_t *)msg->topic, msg->payload, msg->len, msg->qos, msg->retain) == 0 &&
+		connected)
+	{
+		report_store_drain_start();
+	}
+	mqtt_msg_free(msg);
+}
+
+/**@brief Sends or stores a dequeued message, called on the MQTT thread only
+ */
+static void handle_msg(struct mqtt_msg *msg)
+{
+	int err;
+
+	// keep reports in order behind any stored backlog
+	if (!connected || (!msg->stored && report_store_count() != 0))
+	{
+		store_msg(msg);
+		return;
+	}
+
+	msg->message_id = message_id_get();
+	msg->sent_at = k_uptime_get();
+	msg->ack_due = msg->sent_at + CONFIG_MQTT_PUBACK_TIMEOUT_MS;
+
+	err = publish_msg(msg, false);
+	if (err)
+	{
+		LOG_WRN("Publish failed: %d, storing report\n", err);
+		store_msg(msg);
+		return;
+	}
+	// QoS 0 is done once it is written, QoS 1 waits for the PUBACK
+	if (msg->qos == MQTT_QOS_0_AT_MOST_ONCE)
+	{
+		mqtt_msg_free(msg);
+		return;
+	}
+	inflight_add(msg);
+}
+
+/**@brief Sends queued messages while the in-flight window has room
+ */
+static void handle_queued(void)
+{
+	struct mqtt_msg *msg;
+
+	while (inflight_count < ARRAY_SIZE(inflight) && k_msgq_get(&publish_q, &msg, K_NO_WAIT) == 0)
+	{
+		handle_msg(msg);
+	}
+}
+
+/**@brief Stores the messages the broker never acknowledged
+ *
+ * @param all - also the reports made since the backlog, otherwise they stay
+ * in flight for the persistent session.
+ */
+static void inflight_store(bool all)
+{
+	for (int i = 0; i < ARRAY_SIZE(inflight); ++i)
+	{
+		if (inflight[i] && (all || inflight[i]->stored))
+		{
+			store_msg(inflight[i]);
+			inflight[i] = NULL;
+			--inflight_count;
+		}
+	}
+}
+
+/**@brief Hands every queued message to the report store, stored reports
+ * are freed and drained again after report_store_rewind()
+ */
+static void store_queued(void)
+{
+	struct mqtt_msg *msg;
+
+	while (k_msgq_get(&publish_q, &msg, K_NO_WAIT) == 0)
+	{
+		store_msg(msg);
+	}
+}
+
+/**@brief Waits without a connection, queued messages go to the report store
+ */
+static void wait_offline(int32_t ms)
+{
+	int64_t end = k_uptime_get() + ms;
+	int64_t left;
+	struct mqtt_msg *msg;
+
+	while ((left = end - k_uptime_get()) > 0)
+	{
+		if (k_msgq_get(&publish_q, &msg, K_MSEC(left)) == 0)
+		{
+			store_msg(msg);
+		}
+	}
+}
+
+void mqtt_delivery_stats_get(struct mqtt_delivery_stats *stats)
+{
+	*stats = delivery;
+}
+
+int data_publish(struct mqtt_msg *msg)
+{
+	if (k_msgq_put(&publish_q, &msg, K_NO_WAIT) != 0)
+	{
+		mqtt_msg_free(msg);
+		return -ENOBUFS;
+	}
+	// the MQTT thread may sleep in poll() until the keepalive
+	if (wake_fd >= 0)
+	{
+		eventfd_write(wake_fd, 1);
+	}
+	return 0;
+}
+
 /**@brief MQTT client event handler
  */
 void mqtt_evt_handler(struct mqtt_client *const c,
@@ -150,20 +439,40 @@ void mqtt_evt_handler(struct mqtt_client *const c,
 {
 	int err;
 
+	activity_add(ACTIVITY_MQTT_RX, 1);
+
 	switch (evt->type)
 	{
 	case MQTT_EVT_CONNACK:
+		if (IS_ENABLED(CONFIG_MQTT_TLS))
+		{
+			mqtt_tls_connect_done(evt->result == 0);
+		}
 		if (evt->result != 0)
 		{
 			LOG_WRN("MQTT connect failed: %d\n", evt->result);
 			break;
 		}
-		LOG_INF("MQTT client connected\n");
-		subscribe(c);
+		LOG_INF("MQTT client connected, session %s\n",
+				evt->param.connack.session_present_flag ? "resumed" : "new");
+		connected = true;
+		// a persistent session keeps the subscription on the broker
+		if (!evt->param.connack.session_present_flag)
+		{
+			subscribe(c);
+		}
+		// messages kept in flight over the reconnect go first, the broker
+		// may have seen them if it kept the session
+		inflight_resend(true, evt->param.connack.session_present_flag);
+		// stored reports sent on the last connection and never acknowledged
+		// were dropped from RAM, they go again from flash
+		report_store_rewind();
+		report_store_drain_start();
 		break;
 
 	case MQTT_EVT_DISCONNECT:
 		LOG_WRN("MQTT client disconnected: %d\n", evt->result);
+		connected = false;
 		break;
 
 	case MQTT_EVT_PUBLISH:
@@ -175,6 +484,7 @@ void mqtt_evt_handler(struct mqtt_client *const c,
 			LOG_INF("MQTT PUBLISH result=%d len=%d\n", evt->result, p->message.payload.len);
 			// Extract the data of the recived message
 			err = get_received_payload(c, p->message.payload.len);
+			activity_add(ACTIVITY_MQTT_RX_B, p->message.payload.len);
 			// Send acknowledgment to the broker on receiving QoS1 publish message
 			if (p->message.topic.qos == MQTT_QOS_1_AT_LEAST_ONCE)
 			{
@@ -182,12 +492,14 @@ void mqtt_evt_handler(struct mqtt_client *const c,
 					.message_id = p->message_id};
 				/* Send acknowledgment. */
 				mqtt_publish_qos1_ack(c, &ack);
+				activity_add(ACTIVITY_MQTT_TX, 1);
 			}
 			/* STEP 6.2 - On successful extraction of data */
 			// On successful extraction of data
 			if (err >= 0)
 			{
 				data_print("Received: ", payload_buf, p->message.payload.len);
+				command_handle(payload_buf, p->message.payload.len);
 			}
 			/* STEP 6.3 - On failed extraction of data */
 			// On failed extraction of data - Payload buffer is smaller than the recived data . Increase
@@ -217,7 +529,7 @@ void mqtt_evt_handler(struct mqtt_client *const c,
 			break;
 		}
 
-		//		printk("PUBACK packet id: %u\n", evt->param.puback.message_id);
+		inflight_ack(evt->param.puback.message_id);
 		break;
 
 	case MQTT_EVT_SUBACK:
@@ -303,11 +615,17 @@ static int broker_init(void)
 	return err;
 }
 
-/* Function to get the client id */
+/* The client id, read once by client_init(), the station ID of every topic */
+static uint8_t client_id[MAX(sizeof(CONFIG_MQTT_CLIENT_ID),
+							 CLIENT_ID_LEN)];
+
+/* Function to get the client id, NULL if the IMEI can not be read */
 static const uint8_t *client_id_get(void)
 {
-	static uint8_t client_id[MAX(sizeof(CONFIG_MQTT_CLIENT_ID),
-								 CLIENT_ID_LEN)];
+	if (client_id[0] != '\0')
+	{
+		return client_id;
+	}
 
 	if (strlen(CONFIG_MQTT_CLIENT_ID) > 0)
 	{
@@ -323,7 +641,16 @@ static const uint8_t *client_id_get(void)
 	if (err)
 	{
 		LOG_WRN("Failed to obtain IMEI, error: %d\n", err);
-		goto exit;
+		return NULL;
+	}
+	// an empty or short answer would leave the station without a name
+	for (int i = 0; i < IMEI_LEN; ++i)
+	{
+		if (imei_buf[i] < '0' || imei_buf[i] > '9')
+		{
+			LOG_WRN("Unexpected AT+CGSN response\n");
+			return NULL;
+		}
 	}
 
 	imei_buf[IMEI_LEN] = '\0';
@@ -336,6 +663,12 @@ exit:
 	return client_id;
 }
 
+const char *mqtt_station_id(void)
+{
+	// set by client_init(), which fails without it
+	return (const char *)client_id;
+}
+
 	/**@brief Initialize the MQTT client structure
 	 */
 	/* STEP 3 - Define the function client_init() to initialize the MQTT client instance.  */
@@ -356,6 +689,12 @@ exit:
 	client.broker = &broker;
 	client.evt_cb = mqtt_evt_handler;
 	client.client_id.utf8 = client_id_get();
+	if (client.client_id.utf8 == NULL)
+	{
+		// every topic names the station, there is nothing to publish under
+		LOG_WRN("No client ID\n");
+		return -EIO;
+	}
 	client.client_id.size = strlen(client.client_id.utf8);
 	client.password = NULL;
 	client.user_name = NULL;
@@ -365,11 +704,40 @@ exit:
 	client.rx_buf_size = sizeof(rx_buffer);
 	client.tx_buf = tx_buffer;
 	client.tx_buf_size = sizeof(tx_buffer);
-	/* We are not using TLS in Exercise 1 */
+#if defined(CONFIG_MQTT_TLS)
+	// the broker address stays resolved and the modem keeps the TLS
+	// session, a reconnect only costs the TCP and abbreviated handshakes
+	client.transport.type = MQTT_TRANSPORT_SECURE;
+	mqtt_tls_config(&client.transport.tls.config);
+#else
 	client.transport.type = MQTT_TRANSPORT_NON_SECURE;
+#endif
+	if (wake_fd < 0)
+	{
+		wake_fd = eventfd(0, EFD_NONBLOCK);
+		if (wake_fd < 0)
+		{
+			// still works, the queue is checked every publish poll interval
+			LOG_WRN("No eventfd: %d\n", errno);
+		}
+	}
 	return err;
 }
 
+/**@brief Longest wait in poll(), until the keepalive when there is nothing
+ * to send or acknowledge, data_publish() wakes the thread
+ */
+static int poll_timeout(void)
+{
+	int timeout = MIN(mqtt_keepalive_time_left(&client), inflight_time_left());
+
+	if (wake_fd < 0 || inflight_count != 0 || k_msgq_num_used_get(&publish_q) != 0)
+	{
+		timeout = MIN(timeout, CONFIG_MQTT_PUBLISH_POLL_MS);
+	}
+	return timeout;
+}
+
 void mqtt_idleloop()
 {
 	int err;
@@ -380,39 +748,64 @@ do_connect:
 	{
 		LOG_INF("Reconnecting in %d seconds...\n",
 				CONFIG_MQTT_RECONNECT_DELAY_S);
-		k_sleep(K_SECONDS(CONFIG_MQTT_RECONNECT_DELAY_S));
+		wait_offline(CONFIG_MQTT_RECONNECT_DELAY_S * MSEC_PER_SEC);
+	}
+	if (IS_ENABLED(CONFIG_MQTT_TLS))
+	{
+		mqtt_tls_connect_start();
 	}
 	err = mqtt_connect(&client);
 	if (err)
 	{
 		LOG_WRN("Error in mqtt_connect: %d\n", err);
+		if (IS_ENABLED(CONFIG_MQTT_TLS))
+		{
+			mqtt_tls_connect_done(false);
+		}
 		goto do_connect;
 	}
 
-	err = fds_init(&client, &fds);
+	err = fds_init(&client, &fds[0]);
 	if (err)
 	{
 		LOG_WRN("Error in fds_init: %d\n", err);
 		return;
 	}
+	// poll() skips a negative descriptor
+	fds[1].fd = wake_fd;
+	fds[1].events = POLLIN;
 
 	while (1)
 	{
-		err = poll(&fds, 1, mqtt_keepalive_time_left(&client));
+		handle_queued();
+
+		err = poll(fds, ARRAY_SIZE(fds), poll_timeout());
 		if (err < 0)
 		{
 			LOG_WRN("Error in poll(): %d\n", errno);
 			break;
 		}
+		if ((fds[1].revents & POLLIN) == POLLIN)
+		{
+			eventfd_t value;
+
+			// the queue is handled at the top of the loop
+			eventfd_read(wake_fd, &value);
+		}
 
 		err = mqtt_live(&client);
+		if (err == 0)
+		{
+			// keepalive ping sent
+			activity_add(ACTIVITY_MQTT_TX, 1);
+		}
 		if ((err != 0) && (err != -EAGAIN))
 		{
 			LOG_WRN("Error in mqtt_live: %d\n", err);
 			break;
 		}
 
-		if ((fds.revents & POLLIN) == POLLIN)
+		if ((fds[0].revents & POLLIN) == POLLIN)
 		{
 			err = mqtt_input(&client);
 			if (err != 0)
@@ -422,20 +815,37 @@ do_connect:
 			}
 		}
 
-		if ((fds.revents & POLLERR) == POLLERR)
+		if ((fds[0].revents & POLLERR) == POLLERR)
 		{
 			LOG_WRN("POLLERR\n");
 			break;
 		}
 
-		if ((fds.revents & POLLNVAL) == POLLNVAL)
+		if ((fds[0].revents & POLLNVAL) == POLLNVAL)
 		{
 			LOG_WRN("POLLNVAL\n");
 			break;
 		}
+
+		// a message out of retries means the link is gone, reconnect
+		if (connected && inflight_resend(false, true) != 0)
+		{
+			break;
+		}
 	}
 
-	LOG_INF("Disconnecting MQTT client\n");
+	LOG_INF("Disconnecting MQTT client, %u acked, mean %u ms, max %u ms, %u retransmits\n",
+			delivery.acked, delivery.acked ? delivery.latency_ms_sum / delivery.acked : 0,
+			delivery.latency_ms_max, delivery.retransmits);
+	connected = false;
+	// nothing reads the flash while there is no broker, and no stored
+	// report is left queued for the rewind on the next CONNACK to repeat
+	report_store_drain_stop();
+	store_queued();
+	// with a persistent session new reports are sent again after the
+	// reconnect, otherwise they wait in flash. Stored reports always drain
+	// again from flash, where they stay until acknowledged.
+	inflight_store(IS_ENABLED(CONFIG_MQTT_CLEAN_SESSION));
 
 	err = mqtt_disconnect(&client);
 	if (err)
@@ -453,6 +863,12 @@ int fds_init(struct mqtt_client *c, struct pollfd *fds)
 	{
 		fds->fd = c->transport.tcp.sock;
 	}
+#if defined(CONFIG_MQTT_TLS)
+	else if (c->transport.type == MQTT_TRANSPORT_SECURE)
+	{
+		fds->fd = c->transport.tls.sock;
+	}
+#endif
 	else
 	{
 		return -ENOTSUP;
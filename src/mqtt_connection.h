@@ -1,15 +1,66 @@
-#include <zephyr/net/socket.h>
-
 #ifndef _MQTTCONNECTION_H_
 #define _MQTTCONNECTION_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/net/socket.h>
+
 #define LED_CONTROL_OVER_MQTT DK_LED1 /*The LED to control over MQTT*/
 #define IMEI_LEN 15
 #define CGSN_RESPONSE_LENGTH (IMEI_LEN + 6 + 1) /* Add 6 for \r\nOK\r\n and 1 for \0 */
 #define CLIENT_ID_LEN sizeof("nrf-") + IMEI_LEN
 
-uint8_t * get_mqtt_message_buf();
-uint8_t * get_mqtt_topic_buf();
+#define MQTT_MESSAGE_BUF_SIZE CONFIG_MQTT_MSG_PAYLOAD_SIZE
+#define MQTT_TOPIC_BUF_SIZE 80
 
+// A report on its way to the broker. Producers take one from the pool,
+// serialize into it and hand it to data_publish(). The MQTT thread owns it
+// from then on and frees it once it is sent, acknowledged or stored.
+struct mqtt_msg
+{
+	uint16_t message_id;
+	uint16_t len;
+	uint8_t qos;
+	uint8_t retain;
+	bool stored; // comes from the report store, skips the backlog check
+	uint8_t retries;
+	uint32_t store_seq; // report store sequence if stored, deleted on its PUBACK
+	int64_t sent_at; // uptime of the first send, for the delivery latency
+	int64_t ack_due; // uptime the PUBACK is due, retransmitted after
+	char topic[MQTT_TOPIC_BUF_SIZE];
+	uint8_t payload[MQTT_MESSAGE_BUF_SIZE];
+};
+
+/**@brief Take a message buffer from the pool, NULL if none is free in time.
+ */
+struct mqtt_msg *mqtt_msg_alloc(k_timeout_t timeout);
+
+/**@brief Return a message that was not handed to data_publish().
+ */
+void mqtt_msg_free(struct mqtt_msg *msg);
+
+/**@brief Number of free message buffers in the pool.
+ */
+uint32_t mqtt_msg_free_count(void);
+
+
+// QoS 1 delivery since boot
+struct mqtt_delivery_stats
+{
+	uint32_t acked;
+	uint32_t retransmits;
+	uint32_t latency_ms_sum; // first send to PUBACK
+	uint32_t latency_ms_max;
+};
+
+/**@brief Get the QoS 1 delivery totals.
+ */
+void mqtt_delivery_stats_get(struct mqtt_delivery_stats *stats);
+
+/**@brief Station ID, the client ID, which names the station in every topic
+ * and payload. CONFIG_MQTT_CLIENT_ID if set, otherwise nrf-<IMEI>.
+ */
+const char *mqtt_station_id(void);
 
 /**@brief Initialize the MQTT client structure
  */
@@ -19,14 +70,14 @@ int client_init();
  */
 int fds_init(struct mqtt_client *c, struct pollfd *fds);
 
+/**@brief Run the MQTT client, owns the client and every publish. Does not return.
+ */
 void mqtt_idleloop();
 
-/**@brief Function to publish data on the configured topic
+/**@brief Queue a message for the MQTT thread, never blocks. Takes ownership
+ * of msg, also on error. Reports that can not be sent are kept in the report
+ * store and sent after reconnecting.
  */
-int data_publish(enum mqtt_qos qos,
-				 uint8_t *data, size_t len, uint8_t *topic, uint8_t retain);
-
-int get_sample_time();
-bool sleepy_mode();
+int data_publish(struct mqtt_msg *msg);
 
-#endif /* _CONNECTION_H_ */
+#endif /* _MQTTCONNECTION_H_ */
@@ -0,0 +1,146 @@
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/settings/settings.h>
+#include <modem/modem_key_mgmt.h>
+
+#include "mqtt_tls.h"
+#include "activity.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(mqtt_tls, LOG_LEVEL_INF);
+
+static const sec_tag_t sec_tags[] = {CONFIG_MQTT_TLS_SEC_TAG};
+
+// CA certificate from settings, PEM
+static char ca_cert[CONFIG_MQTT_TLS_CA_MAX_LEN];
+static size_t ca_len;
+
+static struct mqtt_tls_stats stats;
+static int64_t connect_start;
+static uint32_t connect_start_kb;
+static enum mqtt_tls_handshake connect_kind;
+// the modem holds a session from the last successful connect
+static bool session_valid;
+
+static int settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+	const char *next;
+	int rc;
+
+	if (!settings_name_steq(name, "ca", &next) || next)
+	{
+		return -ENOENT;
+	}
+	if (len > sizeof(ca_cert))
+	{
+		LOG_WRN("Saved CA certificate too large: %u\n", len);
+		return -EINVAL;
+	}
+
+	rc = read_cb(cb_arg, ca_cert, len);
+	if (rc < 0)
+	{
+		return rc;
+	}
+	ca_len = rc;
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(tls, "tls", NULL, settings_set, NULL, NULL);
+
+// total of both directions, the counters only move in whole kB
+static uint32_t modem_kb(void)
+{
+	uint32_t tx_kb;
+	uint32_t rx_kb;
+
+	if (activity_modem_kb(&tx_kb, &rx_kb) != 0)
+	{
+		return 0;
+	}
+	return tx_kb + rx_kb;
+}
+
+int mqtt_tls_provision(void)
+{
+	bool exists = false;
+	int err;
+
+	err = settings_subsys_init();
+	if (err == 0)
+	{
+		settings_load_subtree("tls");
+	}
+
+	// writing the key storage needs the modem offline, and wears its flash,
+	// so only a certificate that differs is written
+	if (ca_len > 0 &&
+		modem_key_mgmt_cmp(CONFIG_MQTT_TLS_SEC_TAG, MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN, ca_cert, ca_len) != 0)
+	{
+		err = modem_key_mgmt_write(CONFIG_MQTT_TLS_SEC_TAG, MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN, ca_cert, ca_len);
+		if (err)
+		{
+			LOG_WRN("Failed to write CA certificate: %d\n", err);
+			return err;
+		}
+		LOG_INF("CA certificate provisioned to sec tag %d\n", CONFIG_MQTT_TLS_SEC_TAG);
+	}
+
+	err = modem_key_mgmt_exists(CONFIG_MQTT_TLS_SEC_TAG, MODEM_KEY_MGMT_CRED_TYPE_CA_CHAIN, &exists);
+	if (err || !exists)
+	{
+		LOG_WRN("No CA certificate in sec tag %d\n", CONFIG_MQTT_TLS_SEC_TAG);
+		return err ? err : -ENOENT;
+	}
+	return 0;
+}
+
+void mqtt_tls_config(struct mqtt_sec_config *tls)
+{
+	tls->peer_verify = CONFIG_MQTT_TLS_PEER_VERIFY;
+	tls->cipher_count = 0;
+	tls->cipher_list = NULL; // modem defaults
+	tls->sec_tag_count = ARRAY_SIZE(sec_tags);
+	tls->sec_tag_list = sec_tags;
+	tls->hostname = CONFIG_MQTT_BROKER_HOSTNAME;
+	tls->session_cache = IS_ENABLED(CONFIG_MQTT_TLS_SESSION_CACHE) ? TLS_SESSION_CACHE_ENABLED
+																  : TLS_SESSION_CACHE_DISABLED;
+}
+
+void mqtt_tls_connect_start(void)
+{
+	// assumed, the modem offers the cached session but does not report
+	// whether the broker took it
+	connect_kind = session_valid && IS_ENABLED(CONFIG_MQTT_TLS_SESSION_CACHE) ? MQTT_TLS_RESUMED
+																			 : MQTT_TLS_FULL;
+	connect_start_kb = modem_kb();
+	connect_start = k_uptime_get();
+}
+
+void mqtt_tls_connect_done(bool ok)
+{
+	uint32_t ms = k_uptime_get() - connect_start;
+	uint32_t kb = modem_kb() - connect_start_kb;
+	enum mqtt_tls_handshake kind = connect_kind;
+
+	session_valid = ok;
+	if (!ok)
+	{
+		++stats.failed;
+		return;
+	}
+
+	++stats.count[kind];
+	stats.ms[kind] += ms;
+	stats.kb[kind] += kb;
+
+	// per handshake bytes are only meaningful as a mean over many connects,
+	// each one is off by up to a kB
+	LOG_INF("%s handshake (assumed) %u ms, mean %u ms, est. %u B +-%u over %u\n",
+			kind == MQTT_TLS_FULL ? "Full" : "Resumed", ms, stats.ms[kind] / stats.count[kind],
+			(stats.kb[kind] * 1024) / stats.count[kind], 1024 / stats.count[kind], stats.count[kind]);
+}
+
+void mqtt_tls_stats_get(struct mqtt_tls_stats *out)
+{
+	*out = stats;
+}
@@ -0,0 +1,60 @@
+#ifndef _MQTT_TLS_H_
+#define _MQTT_TLS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/net/mqtt.h>
+
+// TLS for the broker connection, offloaded to the modem. The CA certificate
+// lives in modem key storage under CONFIG_MQTT_TLS_SEC_TAG, a certificate
+// kept in settings ("tls/ca") replaces it at boot. The modem keeps the TLS
+// session, so reconnects can resume it instead of a full handshake.
+//
+// The statistics are estimates. The modem does not say whether a handshake
+// resumed the session, a connect is counted as resumed when a session was
+// offered. The modem data counters move in whole kB, so the bytes of one
+// handshake are only meaningful as a mean over many connects.
+
+// handshake kind as expected from the session cache, not as negotiated
+enum mqtt_tls_handshake
+{
+	MQTT_TLS_FULL,
+	MQTT_TLS_RESUMED,
+	MQTT_TLS_HANDSHAKE_COUNT
+};
+
+struct mqtt_tls_stats
+{
+	uint32_t count[MQTT_TLS_HANDSHAKE_COUNT];
+	uint32_t failed;
+	uint32_t ms[MQTT_TLS_HANDSHAKE_COUNT]; // connect to CONNACK, summed
+	uint32_t kb[MQTT_TLS_HANDSHAKE_COUNT]; // modem data counters, summed, +-1 kB per connect
+};
+
+/**
+ * @brief Provision the CA certificate, call before the modem goes online.
+ *
+ * @return int - 0 if a certificate is in key storage, otherwise, negative error code.
+ */
+int mqtt_tls_provision(void);
+
+/**
+ * @brief Fill in the TLS settings of the MQTT transport.
+ */
+void mqtt_tls_config(struct mqtt_sec_config *tls);
+
+/**
+ * @brief Mark the start of a connect, call right before mqtt_connect().
+ */
+void mqtt_tls_connect_start(void);
+
+/**
+ * @brief Mark the end of a connect, on CONNACK or on failure.
+ *
+ * @param ok - the broker accepted the connection.
+ */
+void mqtt_tls_connect_done(bool ok);
+
+void mqtt_tls_stats_get(struct mqtt_tls_stats *stats);
+
+#endif /* _MQTT_TLS_H_ */
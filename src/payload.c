@@ -0,0 +1,299 @@
+#include <zephyr/kernel.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <zephyr/sys/base64.h>
+
+#include "payload.h"
+
+// the health report has always carried whole degrees Fahrenheit, the
+// battery model works in Celsius
+static int temp_f(int temp_c)
+{
+	return (temp_c * 9 + 160) / 5;
+}
+
+#if defined(CONFIG_PAYLOAD_FORMAT_CBOR)
+
+// Minimal CBOR (RFC 8949) writer, only what the reports need:
+// integers, byte and text strings and definite length arrays.
+#define CBOR_UINT 0
+#define CBOR_NINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+
+struct cbor_buf
+{
+	uint8_t *pos;
+	uint8_t *end;
+	bool overflow;
+};
+
+static void cbor_head(struct cbor_buf *c, uint8_t major, uint32_t value)
+{
+	uint8_t head[5];
+	int len;
+
+	if (value < 24)
+	{
+		head[0] = (major << 5) | value;
+		len = 1;
+	}
+	else if (value <= UINT8_MAX)
+	{
+		head[0] = (major << 5) | 24;
+		head[1] = value;
+		len = 2;
+	}
+	else if (value <= UINT16_MAX)
+	{
+		head[0] = (major << 5) | 25;
+		head[1] = value >> 8;
+		head[2] = value;
+		len = 3;
+	}
+	else
+	{
+		head[0] = (major << 5) | 26;
+		head[1] = value >> 24;
+		head[2] = value >> 16;
+		head[3] = value >> 8;
+		head[4] = value;
+		len = 5;
+	}
+
+	if (c->end - c->pos < len)
+	{
+		c->overflow = true;
+		return;
+	}
+	memcpy(c->pos, head, len);
+	c->pos += len;
+}
+
+static void cbor_int(struct cbor_buf *c, int32_t value)
+{
+	if (value < 0)
+	{
+		cbor_head(c, CBOR_NINT, (uint32_t)(-1 - value));
+	}
+	else
+	{
+		cbor_head(c, CBOR_UINT, value);
+	}
+}
+
+static void cbor_string(struct cbor_buf *c, uint8_t major, const uint8_t *data, size_t len)
+{
+	cbor_head(c, major, len);
+	// pos never passes end, the difference is never negative
+	if ((size_t)(c->end - c->pos) < len)
+	{
+		c->overflow = true;
+		return;
+	}
+	memcpy(c->pos, data, len);
+	c->pos += len;
+}
+
+static void cbor_bytes(struct cbor_buf *c, const uint8_t *data, size_t len)
+{
+	cbor_string(c, CBOR_BYTES, data, len);
+}
+
+static void cbor_text(struct cbor_buf *c, const char *text)
+{
+	cbor_string(c, CBOR_TEXT, (const uint8_t *)text, strlen(text));
+}
+
+static int cbor_finish(struct cbor_buf *c, uint8_t *buf)
+{
+	return c->overflow ? -ENOMEM : (c->pos - buf);
+}
+
+int payload_wind(uint8_t *buf, size_t size, const char *station, time_t time, const struct w_sensor *slots, int count)
+{
+	struct cbor_buf c = {.pos = buf, .end = buf + size};
+
+	cbor_head(&c, CBOR_ARRAY, 4);
+	cbor_int(&c, PAYLOAD_VERSION);
+	cbor_text(&c, station);
+	cbor_head(&c, CBOR_UINT, (uint32_t)time);
+	cbor_head(&c, CBOR_ARRAY, count);
+	for (int i = 0; i < count; ++i)
+	{
+		cbor_head(&c, CBOR_ARRAY, 4);
+		cbor_int(&c, slots[i].speed);
+		cbor_int(&c, slots[i].direction);
+		cbor_int(&c, slots[i].gust);
+		cbor_int(&c, slots[i].lull);
+	}
+	return cbor_finish(&c, buf);
+}
+
+int payload_wind_slot(uint8_t *buf, size_t size, const char *station, time_t time, int index, const struct w_sensor *slot)
+{
+	struct cbor_buf c = {.pos = buf, .end = buf + size};
+
+	cbor_head(&c, CBOR_ARRAY, 5);
+	cbor_int(&c, PAYLOAD_VERSION);
+	cbor_text(&c, station);
+	cbor_head(&c, CBOR_UINT, (uint32_t)time);
+	cbor_int(&c, index);
+	cbor_head(&c, CBOR_ARRAY, 4);
+	cbor_int(&c, slot->speed);
+	cbor_int(&c, slot->direction);
+	cbor_int(&c, slot->gust);
+	cbor_int(&c, slot->lull);
+	return cbor_finish(&c, buf);
+}
+
+int payload_wind_day(uint8_t *buf, size_t size, const char *station, time_t time, const uint8_t *rows)
+{
+	struct cbor_buf c = {.pos = buf, .end = buf + size};
+
+	cbor_head(&c, CBOR_ARRAY, 4);
+	cbor_int(&c, PAYLOAD_VERSION);
+	cbor_text(&c, station);
+	cbor_head(&c, CBOR_UINT, (uint32_t)time);
+	cbor_bytes(&c, rows, WIND_DAY_SIZE);
+	return cbor_finish(&c, buf);
+}
+
+int payload_health(uint8_t *buf, size_t size, const char *station, const struct battery_status *bat,
+				   const struct activity_delta *act)
+{
+	struct cbor_buf c = {.pos = buf, .end = buf + size};
+
+	cbor_head(&c, CBOR_ARRAY, 4);
+	cbor_int(&c, PAYLOAD_VERSION);
+	cbor_text(&c, station);
+	cbor_head(&c, CBOR_ARRAY, 5);
+	cbor_int(&c, bat->mv);
+	cbor_int(&c, temp_f(bat->temp_c));
+	cbor_int(&c, bat->soc);
+	cbor_int(&c, bat->tier);
+	cbor_int(&c, bat->hours_left);
+	cbor_head(&c, CBOR_ARRAY, ACTIVITY_COUNTER_COUNT + 6);
+	for (int i = 0; i < ACTIVITY_COUNTER_COUNT; ++i)
+	{
+		cbor_head(&c, CBOR_UINT, act->count[i]);
+	}
+	cbor_head(&c, CBOR_UINT, act->connected_s);
+	cbor_head(&c, CBOR_UINT, act->idle_s);
+	cbor_head(&c, CBOR_UINT, act->sleep_s);
+	cbor_head(&c, CBOR_UINT, act->charge_uah);
+	cbor_head(&c, CBOR_UINT, act->modem_tx_kb);
+	cbor_head(&c, CBOR_UINT, act->modem_rx_kb);
+	return cbor_finish(&c, buf);
+}
+
+#else /* CONFIG_PAYLOAD_FORMAT_JSON */
+
+// appends to a JSON string, tracking the space left
+#define JSON_APPEND(pos, end, ...)                                      \
+	do                                                                  \
+	{                                                                   \
+		int n = snprintf((char *)(pos), (end) - (pos), __VA_ARGS__);    \
+		if (n < 0 || n >= (end) - (pos))                                \
+		{                                                               \
+			return -ENOMEM;                                             \
+		}                                                               \
+		(pos) += n;                                                     \
+	} while (0)
+
+// creates JSON string containing time and wind data
+int payload_wind(uint8_t *buf, size_t size, const char *station, time_t time, const struct w_sensor *slots, int count)
+{
+	uint8_t *pos = buf;
+	uint8_t *end = buf + size;
+	struct tm t;
+
+	gmtime_r(&time, &t);
+	JSON_APPEND(pos, end, "{\"station\":\"%s\", \"time\":\"%04d-%02d-%02dT%02d:%02dZ\", ", station,
+				(t.tm_year + 1900), t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min);
+	JSON_APPEND(pos, end, "\"wind\":[");
+
+	for (int i = 0; i < count; ++i)
+	{
+		JSON_APPEND(pos, end, "[%d, %d, %d, %d],", slots[i].speed, slots[i].direction, slots[i].gust, slots[i].lull);
+	}
+	--pos; // remove the last comma
+	JSON_APPEND(pos, end, "]}");
+	return pos - buf;
+}
+
+int payload_wind_slot(uint8_t *buf, size_t size, const char *station, time_t time, int index, const struct w_sensor *slot)
+{
+	uint8_t *pos = buf;
+	uint8_t *end = buf + size;
+	struct tm t;
+
+	gmtime_r(&time, &t);
+	JSON_APPEND(pos, end, "{\"station\":\"%s\", \"time\":\"%04d-%02d-%02dT%02d:%02dZ\", \"slot\":%d, ", station,
+				(t.tm_year + 1900), t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, index);
+	JSON_APPEND(pos, end, "\"wind\":[%d, %d, %d, %d]}", slot->speed, slot->direction, slot->gust, slot->lull);
+	return pos - buf;
+}
+
+int payload_wind_day(uint8_t *buf, size_t size, const char *station, time_t time, const uint8_t *rows)
+{
+	uint8_t *pos = buf;
+	uint8_t *end = buf + size;
+	size_t len;
+	struct tm t;
+
+	gmtime_r(&time, &t);
+	JSON_APPEND(pos, end, "{\"station\":\"%s\", \"time\":\"%04d-%02d-%02dT%02d:%02dZ\", \"day\":\"", station,
+				(t.tm_year + 1900), t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min);
+	if (base64_encode(pos, end - pos, &len, rows, WIND_DAY_SIZE) != 0)
+	{
+		return -ENOMEM;
+	}
+	pos += len;
+	JSON_APPEND(pos, end, "\"}");
+	return pos - buf;
+}
+
+int payload_health(uint8_t *buf, size_t size, const char *station, const struct battery_status *bat,
+				   const struct activity_delta *act)
+{
+	uint8_t *pos = buf;
+	uint8_t *end = buf + size;
+
+	JSON_APPEND(pos, end, "{\"station\":\"%s\", \"bat\":{\"mv\":%u,\"temp\":%d,\"soc\":%u,\"tier\":%u,\"hours\":%u},",
+				station, bat->mv, temp_f(bat->temp_c), bat->soc, bat->tier, bat->hours_left);
+	JSON_APPEND(pos, end, "\"act\":[");
+	for (int i = 0; i < ACTIVITY_COUNTER_COUNT; ++i)
+	{
+		JSON_APPEND(pos, end, "%u,", act->count[i]);
+	}
+	JSON_APPEND(pos, end, "%u,%u,%u,%u,%u,%u]}", act->connected_s, act->idle_s, act->sleep_s,
+				act->charge_uah, act->modem_tx_kb, act->modem_rx_kb);
+	return pos - buf;
+}
+
+#endif
+
+int payload_topic(char *buf, size_t size, const char *station, const char *sub, ...)
+{
+	va_list args;
+	int len;
+	int n;
+
+	len = snprintf(buf, size, "%s/%s/", CONFIG_MQTT_PRIMARY_TOPIC, station);
+	if (len < 0 || (size_t)len >= size)
+	{
+		return -ENOMEM;
+	}
+	va_start(args, sub);
+	n = vsnprintf(buf + len, size - len, sub, args);
+	va_end(args);
+	if (n < 0 || (size_t)n >= size - len)
+	{
+		return -ENOMEM;
+	}
+	return len + n;
+}
@@ -0,0 +1,66 @@
+#ifndef _PAYLOAD_H_
+#define _PAYLOAD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "activity.h"
+#include "battery.h"
+#include "wind_day.h"
+#include "wind_sensor.h"
+
+// Encoders for the wind and health reports. The format is chosen with
+// CONFIG_PAYLOAD_FORMAT_JSON or CONFIG_PAYLOAD_FORMAT_CBOR.
+//
+// Every topic is <primary>/<station>/..., the station ID is also the first
+// field of every payload, so a report stays attributable off its topic.
+//
+// CBOR layout, every report starts with the schema version and station:
+//   wind:   [version, station, unix time, [[speed, direction, gust, lull], ...]]
+//   slot:   [version, station, unix time, slot index, [speed, direction, gust, lull]]
+//   day:    [version, station, unix time of the newest report, bytes], rows as in wind_day.h
+//   health: [version, station, [millivolts, temperature F, charge %, power tier, hours left],
+//            [pulse irqs, timer wakeups, adc scans, mqtt tx, tx bytes, mqtt rx, rx bytes,
+//             connected s, idle s, sleep s, charge uAh, modem tx kB, modem rx kB]]
+#define PAYLOAD_VERSION 2
+
+/**
+ * @brief Format the topic <primary>/<station>/<sub>, sub is a printf format.
+ *
+ * @return int - length of the topic, otherwise, negative error code.
+ */
+int payload_topic(char *buf, size_t size, const char *station, const char *sub, ...);
+
+/**
+ * @brief Encode the wind slots of one hour into buf.
+ *
+ * @return int - number of bytes written, otherwise, negative error code.
+ */
+int payload_wind(uint8_t *buf, size_t size, const char *station, time_t time, const struct w_sensor *slots, int count);
+
+/**
+ * @brief Encode a single wind slot, tagged with its index within the hour.
+ *
+ * @return int - number of bytes written, otherwise, negative error code.
+ */
+int payload_wind_slot(uint8_t *buf, size_t size, const char *station, time_t time, int index, const struct w_sensor *slot);
+
+/**
+ * @brief Encode the 24 hour summary, WIND_DAY_SIZE bytes of rows. JSON
+ * carries the rows as base64.
+ *
+ * @return int - number of bytes written, otherwise, negative error code.
+ */
+int payload_wind_day(uint8_t *buf, size_t size, const char *station, time_t time, const uint8_t *rows);
+
+/**
+ * @brief Encode the battery estimate into buf, followed by the activity
+ * since the previous health report.
+ *
+ * @return int - number of bytes written, otherwise, negative error code.
+ */
+int payload_health(uint8_t *buf, size_t size, const char *station, const struct battery_status *bat,
+				   const struct activity_delta *act);
+
+#endif /* _PAYLOAD_H_ */
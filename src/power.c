@@ -0,0 +1,243 @@
+#include <zephyr/kernel.h>
+#include <modem/lte_lc.h>
+
+#include "power.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(power, LOG_LEVEL_INF);
+
+#define MS_PER_UAH (60 * 60 * 1000)
+
+// PSM periodic TAU follows the hourly health report, every report in
+// between wakes the modem on its own
+#define PSM_TAU_S (60 * 60)
+
+static const uint32_t state_current_ua[POWER_STATE_COUNT] = {
+	[POWER_RRC_CONNECTED] = CONFIG_POWER_RRC_CONNECTED_UA,
+	[POWER_RRC_IDLE] = CONFIG_POWER_RRC_IDLE_UA,
+	[POWER_MODEM_SLEEP] = CONFIG_POWER_MODEM_SLEEP_UA,
+};
+
+static const char *const state_names[POWER_STATE_COUNT] = {
+	[POWER_RRC_CONNECTED] = "connected",
+	[POWER_RRC_IDLE] = "idle",
+	[POWER_MODEM_SLEEP] = "sleep",
+};
+
+static struct k_spinlock lock;
+static enum power_state state = POWER_RRC_IDLE;
+static int64_t state_since;
+static uint64_t state_ms[POWER_STATE_COUNT];
+static uint64_t charge_ua_ms;
+static uint64_t report_charge_ua_ms;
+static uint32_t reports;
+static bool psm_granted;
+
+// GPRS timer 3 (T3412 extended), 3 bit unit and 5 bit value
+static void encode_tau(char *buf, uint32_t seconds)
+{
+	static const struct
+	{
+		uint8_t unit;
+		uint32_t seconds;
+	} units[] = {
+		{0x3, 2}, {0x4, 30}, {0x5, 60}, {0x0, 600}, {0x1, 3600}, {0x2, 36000}, {0x6, 1152000},
+	};
+	uint8_t unit = units[ARRAY_SIZE(units) - 1].unit;
+	uint32_t value = 31;
+
+	for (int i = 0; i < ARRAY_SIZE(units); ++i)
+	{
+		uint32_t v = DIV_ROUND_UP(seconds, units[i].seconds);
+
+		if (v <= 31)
+		{
+			unit = units[i].unit;
+			value = v;
+			break;
+		}
+	}
+	for (int bit = 0; bit < 8; ++bit)
+	{
+		buf[bit] = (((unit << 5) | value) & BIT(7 - bit)) ? '1' : '0';
+	}
+	buf[8] = '\0';
+}
+
+// GPRS timer 2 (T3324 active time), 3 bit unit and 5 bit value
+static void encode_active_time(char *buf, uint32_t seconds)
+{
+	uint8_t unit;
+	uint32_t value;
+
+	if (seconds <= 31 * 2)
+	{
+		unit = 0x0;
+		value = DIV_ROUND_UP(seconds, 2);
+	}
+	else if (seconds <= 31 * 60)
+	{
+		unit = 0x1;
+		value = DIV_ROUND_UP(seconds, 60);
+	}
+	else
+	{
+		unit = 0x2;
+		value = MIN(DIV_ROUND_UP(seconds, 360), 31);
+	}
+	for (int bit = 0; bit < 8; ++bit)
+	{
+		buf[bit] = (((unit << 5) | value) & BIT(7 - bit)) ? '1' : '0';
+	}
+	buf[8] = '\0';
+}
+
+// closes the time spent in the current state, call with the lock held
+static void account(int64_t now)
+{
+	uint64_t elapsed = now - state_since;
+
+	state_ms[state] += elapsed;
+	charge_ua_ms += elapsed * state_current_ua[state];
+	state_since = now;
+}
+
+static void set_state(enum power_state new_state)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	account(k_uptime_get());
+	state = new_state;
+
+	k_spin_unlock(&lock, key);
+	LOG_DBG("power state %s\n", state_names[new_state]);
+}
+
+void power_init(void)
+{
+	char tau[9];
+	char active_time[9];
+	int err;
+
+	state_since = k_uptime_get();
+
+	encode_tau(tau, PSM_TAU_S);
+	encode_active_time(active_time, CONFIG_POWER_PSM_ACTIVE_TIME_S);
+
+	err = lte_lc_psm_param_set(tau, active_time);
+	if (!err)
+	{
+		err = lte_lc_psm_req(true);
+	}
+	if (err)
+	{
+		LOG_WRN("PSM request failed: %d\n", err);
+	}
+	else
+	{
+		LOG_INF("PSM requested, TAU %s active %s\n", tau, active_time);
+	}
+
+	err = lte_lc_edrx_param_set(LTE_LC_LTE_MODE_LTEM, CONFIG_POWER_EDRX_VALUE);
+	if (!err)
+	{
+		err = lte_lc_edrx_req(true);
+	}
+	if (err)
+	{
+		LOG_WRN("eDRX request failed: %d\n", err);
+	}
+}
+
+void power_lte_event(const struct lte_lc_evt *const evt)
+{
+	switch (evt->type)
+	{
+	case LTE_LC_EVT_RRC_UPDATE:
+		set_state(evt->rrc_mode == LTE_LC_RRC_MODE_CONNECTED ? POWER_RRC_CONNECTED : POWER_RRC_IDLE);
+		break;
+	case LTE_LC_EVT_MODEM_SLEEP_ENTER:
+		set_state(POWER_MODEM_SLEEP);
+		break;
+	case LTE_LC_EVT_MODEM_SLEEP_EXIT:
+		set_state(POWER_RRC_IDLE);
+		break;
+	case LTE_LC_EVT_PSM_UPDATE:
+		psm_granted = evt->psm_cfg.active_time >= 0;
+		LOG_INF("PSM %s, TAU %d s, active time %d s\n", psm_granted ? "granted" : "rejected",
+				evt->psm_cfg.tau, evt->psm_cfg.active_time);
+		break;
+	case LTE_LC_EVT_EDRX_UPDATE:
+		LOG_INF("eDRX %d ms, PTW %d ms\n", (int)(evt->edrx_cfg.edrx * 1000), (int)(evt->edrx_cfg.ptw * 1000));
+		break;
+	default:
+		break;
+	}
+}
+
+void power_report_done(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	uint64_t ms[POWER_STATE_COUNT];
+	uint64_t used;
+	uint32_t n;
+
+	account(k_uptime_get());
+	used = charge_ua_ms - report_charge_ua_ms;
+	report_charge_ua_ms = charge_ua_ms;
+	n = ++reports;
+	// 64-bit totals, copied under the lock so the log never sees a torn value
+	for (int i = 0; i < POWER_STATE_COUNT; ++i)
+	{
+		ms[i] = state_ms[i];
+	}
+
+	k_spin_unlock(&lock, key);
+
+	LOG_INF("report %u used %u uAh, connected %u s, idle %u s, sleep %u s\n", n, (uint32_t)(used / MS_PER_UAH),
+			(uint32_t)(ms[POWER_RRC_CONNECTED] / 1000), (uint32_t)(ms[POWER_RRC_IDLE] / 1000),
+			(uint32_t)(ms[POWER_MODEM_SLEEP] / 1000));
+}
+
+enum power_state power_state_get(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	enum power_state s = state;
+
+	k_spin_unlock(&lock, key);
+	return s;
+}
+
+void power_stats_get(struct power_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	account(k_uptime_get());
+	for (int i = 0; i < POWER_STATE_COUNT; ++i)
+	{
+		stats->state_ms[i] = state_ms[i];
+	}
+	stats->charge_uah = charge_ua_ms / MS_PER_UAH;
+	stats->reports = reports;
+
+	k_spin_unlock(&lock, key);
+}
+
+int power_psm_enable(bool enable)
+{
+	int err = lte_lc_psm_req(enable);
+
+	if (!err)
+	{
+		err = lte_lc_edrx_req(enable);
+	}
+	if (err)
+	{
+		LOG_WRN("PSM %s failed: %d\n", enable ? "enable" : "disable", err);
+	}
+	return err;
+}
+
+bool sleepy_mode()
+{
+	return psm_granted;
+}
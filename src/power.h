@@ -0,0 +1,64 @@
+#ifndef _POWER_H_
+#define _POWER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <modem/lte_lc.h>
+
+// LTE power management. Requests PSM and eDRX timers that follow the report
+// schedule, tracks the RRC and modem sleep state from lte_lc events and
+// estimates the charge spent per report.
+
+enum power_state
+{
+	POWER_RRC_CONNECTED,
+	POWER_RRC_IDLE,
+	POWER_MODEM_SLEEP,
+	POWER_STATE_COUNT
+};
+
+struct power_stats
+{
+	uint64_t state_ms[POWER_STATE_COUNT]; // time spent in each state
+	uint32_t charge_uah;				  // estimated charge used
+	uint32_t reports;					  // reports sent
+};
+
+/**
+ * @brief Request PSM and eDRX from the network. Call after the modem is initialized.
+ */
+void power_init(void);
+
+/**
+ * @brief Feed lte_lc events to the power state machine.
+ */
+void power_lte_event(const struct lte_lc_evt *const evt);
+
+/**
+ * @brief Account one report, logs the charge used since the previous report.
+ */
+void power_report_done(void);
+
+/**
+ * @brief Current radio state.
+ */
+enum power_state power_state_get(void);
+
+/**
+ * @brief Get totals since boot.
+ */
+void power_stats_get(struct power_stats *stats);
+
+/**
+ * @brief Turn PSM and eDRX off to keep the station reachable, or back on.
+ *
+ * @return int - 0 on success, otherwise, negative error code.
+ */
+int power_psm_enable(bool enable);
+
+/**
+ * @brief True when the network has granted PSM.
+ */
+bool sleepy_mode();
+
+#endif /* _POWER_H_ */
@@ -0,0 +1,55 @@
+#ifndef _PULSE_COUNTER_H_
+#define _PULSE_COUNTER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/drivers/gpio.h>
+
+// Anemometer pulse counter. One backend is linked in, selected by
+// CONFIG_WIND_PULSE_COUNTER_*:
+//   NRFX - GPIOTE event routed over (D)PPI to a TIMER in counter mode,
+//          the CPU is not involved while counting.
+//   GPIO - one GPIO interrupt per pulse with a software glitch filter.
+//   SIM  - replays a recorded or synthetic wind trace, see wind_trace.h.
+//
+// Besides the count, each backend timestamps the latest pulse edge so the
+// speed can be measured from the pulse period at light winds, see
+// wind_rate.h.
+
+// what was counted since the previous read, times are in microseconds of a
+// free running clock that wraps at 32 bits
+struct pulse_reading
+{
+	uint32_t pulses;  // pulses since the previous read
+	uint32_t edge_us; // latest pulse edge, valid when timed and pulses > 0
+	uint32_t now_us;  // the read, valid when timed
+	bool timed;		  // edges are timestamped
+};
+
+/**
+ * @brief Prepare the backend to count pulses on the given pin.
+ *
+ * @return int - 0 on success, otherwise, negative error code.
+ */
+int pulse_counter_init(const struct gpio_dt_spec *spec);
+
+/**
+ * @brief Get the pulses counted since the previous call.
+ *
+ * @param[out] reading - the pulses and, when timed, the latest edge.
+ * @return int - 0 on success, otherwise, negative error code.
+ */
+int pulse_counter_read(struct pulse_reading *reading);
+
+/**
+ * @brief Turn edge timestamps on or off. Edges after the call are
+ * timestamped, a backend may stop its clock while they are off.
+ */
+void pulse_counter_set_timing(bool enable);
+
+/**
+ * @brief Number of CPU interrupts the backend has taken since boot.
+ */
+uint32_t pulse_counter_irq_count(void);
+
+#endif /* _PULSE_COUNTER_H_ */
@@ -0,0 +1,78 @@
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+
+#include "pulse_counter.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(pulse_gpio, LOG_LEVEL_INF);
+
+#define GLITCH_FILTER_MS 10
+
+static struct k_spinlock lock;
+static uint32_t pulses;
+static int64_t edge_ticks; // uptime of the latest counted pulse
+static atomic_t irq_count;
+static int64_t lasttime;
+
+static struct gpio_callback windspeed_cb_data;
+
+// ISR called on each pulse from the speed sensor
+static void windspeed_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
+{
+	int64_t ticks = k_uptime_ticks();
+	int64_t time = k_ticks_to_ms_floor64(ticks);
+
+	atomic_inc(&irq_count);
+	// filter out sensor glitches
+	if ((time - lasttime) > GLITCH_FILTER_MS)
+	{
+		k_spinlock_key_t key = k_spin_lock(&lock);
+
+		++pulses;
+		edge_ticks = ticks;
+		k_spin_unlock(&lock, key);
+	}
+	lasttime = time;
+}
+
+int pulse_counter_init(const struct gpio_dt_spec *spec)
+{
+	int err;
+
+	err = gpio_pin_interrupt_configure_dt(spec, GPIO_INT_EDGE_TO_ACTIVE);
+	if (err < 0)
+	{
+		return err;
+	}
+
+	gpio_init_callback(&windspeed_cb_data, windspeed_handler, BIT(spec->pin));
+
+	return gpio_add_callback(spec->port, &windspeed_cb_data);
+}
+
+// The interrupt is taken per pulse anyway, so the edges are always
+// timestamped, to the resolution of the system tick.
+int pulse_counter_read(struct pulse_reading *reading)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+	int64_t edge = edge_ticks;
+
+	reading->pulses = pulses;
+	pulses = 0;
+	k_spin_unlock(&lock, key);
+
+	// truncated, the microsecond clock wraps at 32 bits like the others
+	reading->edge_us = (uint32_t)k_ticks_to_us_floor64(edge);
+	reading->now_us = (uint32_t)k_ticks_to_us_floor64(k_uptime_ticks());
+	reading->timed = true;
+	return 0;
+}
+
+void pulse_counter_set_timing(bool enable)
+{
+	ARG_UNUSED(enable);
+}
+
+uint32_t pulse_counter_irq_count(void)
+{
+	return (uint32_t)atomic_get(&irq_count);
+}
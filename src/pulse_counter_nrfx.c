@@ -0,0 +1,157 @@
+#include <zephyr/kernel.h>
+#include <zephyr/drivers/gpio.h>
+#include <nrfx_gpiote.h>
+#include <nrfx_timer.h>
+#include <helpers/nrfx_gppi.h>
+
+#include "pulse_counter.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(pulse_nrfx, LOG_LEVEL_INF);
+
+// The pin's GPIOTE IN event is wired over (D)PPI to the COUNT task of a
+// TIMER running in low power counter mode. Nothing runs on the CPU per
+// pulse, the count is captured once when the window is read.
+//
+// For edge timestamps the same event is forked to the CAPTURE task of a
+// second TIMER running at 1 MHz, so CC0 always holds the time of the latest
+// pulse. That timer keeps the high frequency clock requested, it only runs
+// while timing is on.
+static const nrfx_timer_t pulse_timer = NRFX_TIMER_INSTANCE(1);
+static const nrfx_timer_t edge_timer = NRFX_TIMER_INSTANCE(2);
+
+#define EDGE_CC NRF_TIMER_CC_CHANNEL0
+#define NOW_CC NRF_TIMER_CC_CHANNEL1
+
+static uint32_t last_count;
+static bool timing;
+static bool edge_seen; // an edge was captured since timing was turned on
+
+// required by nrfx, no timer interrupts are enabled
+static void pulse_timer_handler(nrf_timer_event_t event_type, void *p_context)
+{
+}
+
+int pulse_counter_init(const struct gpio_dt_spec *spec)
+{
+	nrfx_err_t err;
+	uint8_t gpiote_ch;
+	uint8_t ppi_ch;
+	nrfx_gpiote_pin_t pin = spec->pin;
+
+	nrfx_timer_config_t timer_cfg = NRFX_TIMER_DEFAULT_CONFIG;
+	timer_cfg.mode = NRF_TIMER_MODE_LOW_POWER_COUNTER;
+	timer_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+	err = nrfx_timer_init(&pulse_timer, &timer_cfg, pulse_timer_handler);
+	if (err != NRFX_SUCCESS)
+	{
+		LOG_WRN("pulse timer init failed: %08x\n", err);
+		return -EBUSY;
+	}
+
+	nrfx_timer_config_t edge_cfg = NRFX_TIMER_DEFAULT_CONFIG;
+	edge_cfg.frequency = NRF_TIMER_FREQ_1MHz;
+	edge_cfg.mode = NRF_TIMER_MODE_TIMER;
+	edge_cfg.bit_width = NRF_TIMER_BIT_WIDTH_32;
+
+	err = nrfx_timer_init(&edge_timer, &edge_cfg, pulse_timer_handler);
+	if (err != NRFX_SUCCESS)
+	{
+		LOG_WRN("edge timer init failed: %08x\n", err);
+		return -EBUSY;
+	}
+
+	err = nrfx_gpiote_channel_alloc(&gpiote_ch);
+	if (err != NRFX_SUCCESS)
+	{
+		LOG_WRN("no free GPIOTE channel: %08x\n", err);
+		return -ENOMEM;
+	}
+
+	const nrfx_gpiote_input_config_t input_cfg = {
+		.pull = NRF_GPIO_PIN_PULLUP,
+	};
+	const nrfx_gpiote_trigger_config_t trigger_cfg = {
+		.trigger = (spec->dt_flags & GPIO_ACTIVE_LOW) ? NRFX_GPIOTE_TRIGGER_HITOLO
+													  : NRFX_GPIOTE_TRIGGER_LOTOHI,
+		.p_in_channel = &gpiote_ch,
+	};
+
+	err = nrfx_gpiote_input_configure(pin, &input_cfg, &trigger_cfg, NULL);
+	if (err != NRFX_SUCCESS)
+	{
+		LOG_WRN("GPIOTE input config failed: %08x\n", err);
+		return -EIO;
+	}
+
+	err = nrfx_gppi_channel_alloc(&ppi_ch);
+	if (err != NRFX_SUCCESS)
+	{
+		LOG_WRN("no free PPI channel: %08x\n", err);
+		return -ENOMEM;
+	}
+
+	nrfx_gppi_channel_endpoints_setup(ppi_ch,
+									  nrfx_gpiote_in_event_addr_get(pin),
+									  nrfx_timer_task_address_get(&pulse_timer, NRF_TIMER_TASK_COUNT));
+	nrfx_gppi_fork_endpoint_setup(ppi_ch, nrfx_timer_task_address_get(&edge_timer, NRF_TIMER_TASK_CAPTURE0));
+
+	// event only, no interrupt
+	nrfx_gpiote_trigger_enable(pin, false);
+	nrfx_gppi_channels_enable(BIT(ppi_ch));
+	nrfx_timer_enable(&pulse_timer);
+
+	last_count = 0;
+	return 0;
+}
+
+int pulse_counter_read(struct pulse_reading *reading)
+{
+	uint32_t count;
+	uint32_t edge;
+
+	// The timer is never cleared, so no pulse is lost between capture and
+	// clear. Unsigned subtraction handles the 32 bit wrap. An edge between
+	// the two reads of its time would pair the count with the wrong edge,
+	// the capture is then taken again.
+	do
+	{
+		edge = nrfx_timer_capture_get(&edge_timer, EDGE_CC);
+		count = nrfx_timer_capture(&pulse_timer, NRF_TIMER_CC_CHANNEL0);
+	} while (timing && edge != nrfx_timer_capture_get(&edge_timer, EDGE_CC));
+
+	reading->pulses = count - last_count;
+	last_count = count;
+
+	// the edge timer starts at 0 with CC0 cleared, a capture moves it on
+	edge_seen = edge_seen || edge != 0;
+	reading->timed = timing && edge_seen;
+	reading->edge_us = edge;
+	reading->now_us = timing ? nrfx_timer_capture(&edge_timer, NOW_CC) : 0;
+	return 0;
+}
+
+void pulse_counter_set_timing(bool enable)
+{
+	if (enable == timing)
+	{
+		return;
+	}
+	timing = enable;
+	if (enable)
+	{
+		edge_seen = false;
+		nrfx_timer_clear(&edge_timer);
+		nrfx_timer_compare(&edge_timer, EDGE_CC, 0, false);
+		nrfx_timer_enable(&edge_timer);
+	}
+	else
+	{
+		nrfx_timer_disable(&edge_timer);
+	}
+}
+
+uint32_t pulse_counter_irq_count(void)
+{
+	return 0;
+}
@@ -0,0 +1,55 @@
+#include <zephyr/kernel.h>
+#include <stdlib.h>
+
+#include "report_policy.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(report_policy, LOG_LEVEL_INF);
+
+static struct w_sensor last_sent;
+static bool have_last;
+static struct report_policy_stats stats;
+
+// smallest angle between two directions, 0 to 180
+static int direction_diff(uint16_t a, uint16_t b)
+{
+	int diff = abs((int)a - (int)b) % 360;
+
+	return (diff > 180) ? 360 - diff : diff;
+}
+
+static bool changed(const struct w_sensor *slot)
+{
+	if (!have_last)
+	{
+		return true;
+	}
+	if (abs(slot->speed - last_sent.speed) >= CONFIG_REPORT_DEADBAND_SPEED ||
+		abs(slot->gust - last_sent.gust) >= CONFIG_REPORT_DEADBAND_GUST ||
+		abs(slot->lull - last_sent.lull) >= CONFIG_REPORT_DEADBAND_SPEED)
+	{
+		return true;
+	}
+	// direction is meaningless in a calm
+	return slot->speed > 0 &&
+		   direction_diff(slot->direction, last_sent.direction) >= CONFIG_REPORT_DEADBAND_DIRECTION;
+}
+
+bool report_policy_should_publish(const struct w_sensor *slot, bool heartbeat)
+{
+	if (!heartbeat && !changed(slot))
+	{
+		++stats.suppressed;
+		LOG_INF("report suppressed, %u sent %u suppressed\n", stats.sent, stats.suppressed);
+		return false;
+	}
+
+	last_sent = *slot;
+	have_last = true;
+	++stats.sent;
+	return true;
+}
+
+void report_policy_stats_get(struct report_policy_stats *out)
+{
+	*out = stats;
+}
@@ -0,0 +1,30 @@
+#ifndef _REPORT_POLICY_H_
+#define _REPORT_POLICY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "wind_sensor.h"
+
+// Change driven report suppression. A slot is only published when speed,
+// gust or direction moved outside their dead-bands since the last published
+// slot. The end of hour report is always sent as a heartbeat.
+
+struct report_policy_stats
+{
+	uint32_t sent;
+	uint32_t suppressed;
+};
+
+/**
+ * @brief Decide whether a new slot is worth publishing and count the decision.
+ *
+ * @param slot - the new slot.
+ * @param heartbeat - true to force a publish, e.g. at the end of the hour.
+ * @return bool - true if the slot should be published.
+ */
+bool report_policy_should_publish(const struct w_sensor *slot, bool heartbeat);
+
+void report_policy_stats_get(struct report_policy_stats *stats);
+
+#endif /* _REPORT_POLICY_H_ */
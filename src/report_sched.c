@@ -0,0 +1,161 @@
+#include <zephyr/kernel.h>
+#include <date_time.h>
+
+#include "report_sched.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(report_sched, LOG_LEVEL_INF);
+
+#define MS_PER_HOUR (60 * 60 * 1000)
+
+// a report this far into its slot is late
+#define SLOT_LATE_MS (5 * 1000)
+// a wall clock correction larger than this is a jump, not drift
+#define TIME_JUMP_MS (2 * 1000)
+
+static K_MUTEX_DEFINE(sched_lock);
+static report_sched_handler_t report_handler;
+static uint32_t interval_ms;
+
+// wall clock minus uptime, 0 until date_time has the time
+static int64_t wall_offset_ms;
+static bool synced;
+
+// uptime of the last report, its slot and hour follow the current time base
+static int64_t last_report_uptime = -1;
+static int64_t last_slot = -1;
+static int64_t last_hour = -1;
+
+static struct report_sched_stats stats;
+
+static int64_t wall_now_ms(void)
+{
+	return k_uptime_get() + wall_offset_ms;
+}
+
+// recomputes the last reported slot and hour after the interval or the
+// time base changed, call with the lock held
+static void rebase_last_report(void)
+{
+	if (last_report_uptime < 0)
+	{
+		return;
+	}
+
+	int64_t wall = last_report_uptime + wall_offset_ms;
+
+	last_slot = wall / interval_ms;
+	last_hour = wall / MS_PER_HOUR;
+}
+
+void report_sched_run_due(void)
+{
+	struct report_slot slot;
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	int64_t now = wall_now_ms();
+	int64_t slot_nr = now / interval_ms;
+	int64_t hour_nr = now / MS_PER_HOUR;
+
+	if (report_handler == NULL || slot_nr <= last_slot)
+	{
+		k_mutex_unlock(&sched_lock);
+		return;
+	}
+	if (last_slot >= 0 && slot_nr > last_slot + 1)
+	{
+		stats.skipped += slot_nr - last_slot - 1;
+		LOG_WRN("%u report slots skipped\n", (uint32_t)(slot_nr - last_slot - 1));
+	}
+	if (now % interval_ms > SLOT_LATE_MS)
+	{
+		++stats.late;
+	}
+
+	slot.time = (slot_nr * interval_ms) / MSEC_PER_SEC;
+	slot.hour = hour_nr % 24;
+	slot.per_hour = MS_PER_HOUR / interval_ms;
+	slot.index = (now % MS_PER_HOUR) / interval_ms;
+	slot.new_hour = hour_nr != last_hour;
+	slot.synced = synced;
+
+	last_report_uptime = k_uptime_get();
+	last_slot = slot_nr;
+	last_hour = hour_nr;
+	++stats.reports;
+
+	k_mutex_unlock(&sched_lock);
+
+	report_handler(&slot);
+}
+
+static void date_time_event_handler(const struct date_time_evt *evt)
+{
+	int64_t wall;
+
+	if (evt->type == DATE_TIME_NOT_OBTAINED || date_time_now(&wall) != 0)
+	{
+		return;
+	}
+
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	int64_t offset = wall - k_uptime_get();
+	int64_t step = offset - wall_offset_ms;
+
+	if (synced && (step > TIME_JUMP_MS || step < -TIME_JUMP_MS))
+	{
+		++stats.jumps;
+		LOG_WRN("Wall clock jumped %lld ms\n", (long long)step);
+	}
+	else if (!synced)
+	{
+		LOG_INF("Report slots aligned to the wall clock\n");
+	}
+	wall_offset_ms = offset;
+	synced = true;
+
+	rebase_last_report();
+
+	k_mutex_unlock(&sched_lock);
+}
+
+void report_sched_init(report_sched_handler_t handler, uint8_t report_minutes)
+{
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	report_handler = handler;
+	interval_ms = report_minutes * 60 * MSEC_PER_SEC;
+	// the slot running at boot is incomplete, the first report is at the
+	// next boundary
+	last_report_uptime = k_uptime_get();
+	rebase_last_report();
+
+	k_mutex_unlock(&sched_lock);
+
+	// the time may already be known, otherwise the event aligns the slots
+	date_time_register_handler(date_time_event_handler);
+	if (date_time_is_valid())
+	{
+		struct date_time_evt evt = {.type = DATE_TIME_OBTAINED_MODEM};
+
+		date_time_event_handler(&evt);
+	}
+}
+
+void report_sched_set_interval(uint8_t report_minutes)
+{
+	k_mutex_lock(&sched_lock, K_FOREVER);
+
+	interval_ms = report_minutes * 60 * MSEC_PER_SEC;
+	rebase_last_report();
+
+	k_mutex_unlock(&sched_lock);
+}
+
+void report_sched_stats_get(struct report_sched_stats *out)
+{
+	k_mutex_lock(&sched_lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&sched_lock);
+}
@@ -0,0 +1,51 @@
+#ifndef _REPORT_SCHED_H_
+#define _REPORT_SCHED_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Report scheduler. Runs on uptime and aligns to wall clock slot boundaries
+// once date_time has the time, so drift and time jumps are corrected at the
+// next slot. It has no timer of its own, the acquisition tick polls it and
+// the handler is called exactly once per slot.
+
+struct report_slot
+{
+	time_t time;	  // start of the slot, seconds since the epoch
+	uint8_t hour;	  // hour of the day, UTC
+	uint8_t index;	  // slot within the hour
+	uint8_t per_hour; // slots per hour
+	bool new_hour;	  // first report of this hour
+	bool synced;	  // time comes from date_time, otherwise from uptime
+};
+
+struct report_sched_stats
+{
+	uint32_t reports;	 // slots reported
+	uint32_t skipped;	 // slots that passed without a report
+	uint32_t late;		 // slots reported late
+	uint32_t jumps;		 // wall clock steps after the first sync
+};
+
+typedef void (*report_sched_handler_t)(const struct report_slot *slot);
+
+/**
+ * @brief Start scheduling, the first report is at the next slot boundary.
+ */
+void report_sched_init(report_sched_handler_t handler, uint8_t report_minutes);
+
+/**
+ * @brief Call the handler if a new slot has started since the last report.
+ * Runs the handler in the calling thread.
+ */
+void report_sched_run_due(void);
+
+/**
+ * @brief Change the report interval, takes effect at the next slot.
+ */
+void report_sched_set_interval(uint8_t report_minutes);
+
+void report_sched_stats_get(struct report_sched_stats *stats);
+
+#endif /* _REPORT_SCHED_H_ */
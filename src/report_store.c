@@ -0,0 +1,420 @@
+#include <zephyr/kernel.h>
+#include <zephyr/fs/nvs.h>
+#include <zephyr/drivers/flash.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/net/mqtt.h>
+#include <string.h>
+
+#include "mqtt_connection.h"
+#include "report_store.h"
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(report_store, LOG_LEVEL_INF);
+
+// pm_static.yml, the settings subsystem keeps its own NVS in storage_partition
+#define STORE_PARTITION report_storage
+#define SETTINGS_PARTITION storage_partition
+
+BUILD_ASSERT(FIXED_PARTITION_OFFSET(STORE_PARTITION) + FIXED_PARTITION_SIZE(STORE_PARTITION) <=
+					 FIXED_PARTITION_OFFSET(SETTINGS_PARTITION) ||
+				 FIXED_PARTITION_OFFSET(SETTINGS_PARTITION) + FIXED_PARTITION_SIZE(SETTINGS_PARTITION) <=
+					 FIXED_PARTITION_OFFSET(STORE_PARTITION),
+			 "the report store and the settings must not share flash");
+
+// NVS id 0 holds the queue position, reports use ids 1..CAPACITY
+#define META_ID 0
+#define RECORD_ID(seq) (1 + ((seq) % CONFIG_REPORT_STORE_CAPACITY))
+
+// message buffers the drain leaves free for new reports
+#define DRAIN_POOL_RESERVE 2
+
+// most reports sent and not yet acknowledged, one bit each in acked
+#define DRAIN_WINDOW 32
+
+// NVS allocation entry, every write and delete adds one, and every sector
+// ends in two of its own
+#define NVS_ATE_SIZE 8
+#define NVS_WRITE_BLOCK 4
+#define RECORD_MAX (sizeof(struct store_hdr) + MQTT_TOPIC_BUF_SIZE + MQTT_MESSAGE_BUF_SIZE)
+#define RECORD_COST(len) (ROUND_UP(len, NVS_WRITE_BLOCK) + NVS_ATE_SIZE)
+
+struct store_meta
+{
+	uint32_t head; // sequence number of the next report written
+	uint32_t tail; // sequence number of the oldest unacknowledged report
+};
+
+struct store_hdr
+{
+	uint8_t qos;
+	uint8_t retain;
+	uint8_t topic_len;
+	uint16_t payload_len;
+} __packed;
+
+static struct nvs_fs fs;
+static struct store_meta meta;
+static bool mounted;
+static uint32_t dropped;
+static uint32_t live_bytes; // flash taken by the stored reports
+static uint32_t budget;		// flash the stored reports may take
+// reports tail..sent were handed to the MQTT thread, bit n of acked is set
+// once report tail + n is acknowledged and deleted, they arrive out of order
+static uint32_t sent;
+static uint32_t acked;
+// set between report_store_drain_start() and report_store_drain_stop()
+static bool draining;
+
+static K_MUTEX_DEFINE(store_lock);
+
+static uint8_t record_buf[sizeof(struct store_hdr) + MQTT_TOPIC_BUF_SIZE + MQTT_MESSAGE_BUF_SIZE];
+
+static void drain_work_cb(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(drain_work, drain_work_cb);
+
+// drain statistics, logged when the queue is empty again
+static int64_t drain_start;
+static uint32_t drain_reports;
+static uint32_t drain_bytes;
+
+static int save_meta(void)
+{
+	int err = nvs_write(&fs, META_ID, &meta, sizeof(meta));
+
+	return (err < 0) ? err : 0;
+}
+
+// flash taken by a stored report, 0 if it is gone
+static uint32_t record_cost(uint32_t seq)
+{
+	struct store_hdr hdr;
+	int len = nvs_read(&fs, RECORD_ID(seq), &hdr, sizeof(hdr));
+
+	return (len > 0) ? RECORD_COST(len) : 0;
+}
+
+// removes the oldest report from flash, called with the lock held
+static void drop_tail(void)
+{
+	live_bytes -= MIN(record_cost(meta.tail), live_bytes);
+	nvs_delete(&fs, RECORD_ID(meta.tail));
+	++meta.tail;
+	acked >>= 1;
+	if ((int32_t)(sent - meta.tail) < 0)
+	{
+		sent = meta.tail;
+	}
+}
+
+// deletes a sent report and moves the tail past every acknowledged one,
+// called with the lock held, returns true if the tail moved
+static bool release(uint32_t seq)
+{
+	uint32_t tail = meta.tail;
+
+	live_bytes -= MIN(record_cost(seq), live_bytes);
+	nvs_delete(&fs, RECORD_ID(seq));
+	acked |= BIT(seq - meta.tail);
+	while (acked & 1)
+	{
+		acked >>= 1;
+		++meta.tail;
+	}
+	return meta.tail != tail;
+}
+
+int report_store_init(void)
+{
+	int err;
+	struct flash_pages_info info;
+
+	fs.flash_device = FIXED_PARTITION_DEVICE(STORE_PARTITION);
+	if (!device_is_ready(fs.flash_device))
+	{
+		LOG_WRN("Flash device not ready\n");
+		return -ENODEV;
+	}
+	fs.offset = FIXED_PARTITION_OFFSET(STORE_PARTITION);
+
+	err = flash_get_page_info_by_offs(fs.flash_device, fs.offset, &info);
+	if (err)
+	{
+		LOG_WRN("Unable to get flash page info: %d\n", err);
+		return err;
+	}
+	fs.sector_size = info.size;
+	fs.sector_count = FIXED_PARTITION_SIZE(STORE_PARTITION) / info.size;
+
+	err = nvs_mount(&fs);
+	if (err)
+	{
+		LOG_WRN("NVS mount failed: %d\n", err);
+		return err;
+	}
+
+	// NVS needs a free sector to collect garbage into, and a sector can be
+	// left short of a record at its end
+	if (fs.sector_count < 2 || fs.sector_size < 2 * NVS_ATE_SIZE + 2 * RECORD_COST(RECORD_MAX))
+	{
+		LOG_WRN("Report store partition too small\n");
+		return -ENOSPC;
+	}
+	budget = (fs.sector_count - 1) * (fs.sector_size - 2 * NVS_ATE_SIZE - RECORD_COST(RECORD_MAX)) -
+			 RECORD_COST(sizeof(meta));
+
+	if (nvs_read(&fs, META_ID, &meta, sizeof(meta)) != sizeof(meta) ||
+		(meta.head - meta.tail) > CONFIG_REPORT_STORE_CAPACITY)
+	{
+		meta.head = 0;
+		meta.tail = 0;
+	}
+	// whatever was sent before the reboot goes again
+	sent = meta.tail;
+	acked = 0;
+	draining = false;
+	live_bytes = 0;
+	for (uint32_t seq = meta.tail; seq != meta.head; ++seq)
+	{
+		live_bytes += record_cost(seq);
+	}
+	mounted = true;
+
+	LOG_INF("%u stored reports, %u of %u bytes\n", meta.head - meta.tail, live_bytes, budget);
+	return 0;
+}
+
+int report_store_put(const uint8_t *topic, const uint8_t *payload, size_t len,
+					 uint8_t qos, uint8_t retain)
+{
+	struct store_hdr hdr = {
+		.qos = qos,
+		.retain = retain,
+		.topic_len = strlen((const char *)topic),
+		.payload_len = len,
+	};
+	uint32_t cost = RECORD_COST(sizeof(hdr) + hdr.topic_len + len);
+	int err;
+
+	if (!mounted)
+	{
+		return -ENODEV;
+	}
+	if (hdr.topic_len >= MQTT_TOPIC_BUF_SIZE || len > MQTT_MESSAGE_BUF_SIZE)
+	{
+		return -EMSGSIZE;
+	}
+
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	// make room by dropping the oldest reports, the ring is bounded by
+	// both the record IDs and the partition
+	while (meta.head != meta.tail &&
+		   (meta.head - meta.tail >= CONFIG_REPORT_STORE_CAPACITY || live_bytes + cost > budget))
+	{
+		drop_tail();
+		++dropped;
+		LOG_WRN("Report store full, %u reports dropped\n", dropped);
+	}
+
+	memcpy(record_buf, &hdr, sizeof(hdr));
+	memcpy(record_buf + sizeof(hdr), topic, hdr.topic_len);
+	memcpy(record_buf + sizeof(hdr) + hdr.topic_len, payload, len);
+
+	err = nvs_write(&fs, RECORD_ID(meta.head), record_buf, sizeof(hdr) + hdr.topic_len + len);
+	if (err >= 0)
+	{
+		++meta.head;
+		live_bytes += cost;
+		err = save_meta();
+	}
+
+	k_mutex_unlock(&store_lock);
+
+	if (err)
+	{
+		LOG_WRN("Failed to store report: %d\n", err);
+	}
+	return err;
+}
+
+// hands the next stored report to the MQTT thread, returns its size or a
+// negative error
+static int drain_one(void)
+{
+	struct store_hdr hdr = {0};
+	struct mqtt_msg *msg;
+	int len;
+	int err;
+
+	if (mqtt_msg_free_count() <= DRAIN_POOL_RESERVE)
+	{
+		return -ENOMEM;
+	}
+	msg = mqtt_msg_alloc(K_NO_WAIT);
+	if (msg == NULL)
+	{
+		return -ENOMEM;
+	}
+
+	len = nvs_read(&fs, RECORD_ID(sent), record_buf, sizeof(record_buf));
+	if (len >= (int)sizeof(hdr))
+	{
+		memcpy(&hdr, record_buf, sizeof(hdr));
+	}
+	// nvs_read returns the full entry length even when it did not fit
+	if (len < (int)sizeof(hdr) || len > (int)sizeof(record_buf) || hdr.topic_len >= sizeof(msg->topic) ||
+		hdr.payload_len > sizeof(msg->payload) || (int)(sizeof(hdr) + hdr.topic_len + hdr.payload_len) != len)
+	{
+		// lost or corrupt entry, skip it
+		LOG_WRN("Stored report %u unreadable: %d\n", sent, len);
+		mqtt_msg_free(msg);
+		if (release(sent++))
+		{
+			save_meta();
+		}
+		return 0;
+	}
+
+	memcpy(msg->topic, record_buf + sizeof(hdr), hdr.topic_len);
+	msg->topic[hdr.topic_len] = '\0';
+	memcpy(msg->payload, record_buf + sizeof(hdr) + hdr.topic_len, hdr.payload_len);
+	msg->len = hdr.payload_len;
+	msg->qos = hdr.qos;
+	msg->retain = hdr.retain;
+	msg->stored = true;
+	msg->store_seq = sent;
+
+	// the record stays in flash until report_store_ack(), a message lost
+	// with the connection is sent again after report_store_rewind() and one
+	// lost with a reboot after the next drain
+	err = data_publish(msg);
+	if (err)
+	{
+		return err;
+	}
+	++sent;
+	return len;
+}
+
+// the next report not acknowledged yet, false if all were sent
+static bool drain_next(void)
+{
+	while (sent != meta.head && sent - meta.tail < DRAIN_WINDOW && (acked & BIT(sent - meta.tail)))
+	{
+		++sent;
+	}
+	return sent != meta.head;
+}
+
+// sends up to one batch, then yields the workqueue until the next batch
+static void drain_work_cb(struct k_work *work)
+{
+	ARG_UNUSED(work);
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	// stopped while this run was already due
+	if (!draining)
+	{
+		k_mutex_unlock(&store_lock);
+		return;
+	}
+
+	for (int i = 0; i < CONFIG_REPORT_STORE_DRAIN_BATCH && drain_next(); ++i)
+	{
+		int len = (sent - meta.tail < DRAIN_WINDOW) ? drain_one() : -ENOBUFS;
+
+		if (len == -ENOMEM || len == -ENOBUFS)
+		{
+			// the MQTT thread is still busy with the previous batch
+			break;
+		}
+		if (len < 0)
+		{
+			LOG_WRN("Drain stopped: %d\n", len);
+			k_mutex_unlock(&store_lock);
+			return;
+		}
+		++drain_reports;
+		drain_bytes += len;
+	}
+
+	bool empty = !drain_next();
+
+	k_mutex_unlock(&store_lock);
+
+	if (!empty)
+	{
+		k_work_reschedule(&drain_work, K_MSEC(CONFIG_REPORT_STORE_DRAIN_INTERVAL_MS));
+		return;
+	}
+
+	if (drain_reports)
+	{
+		int64_t ms = k_uptime_get() - drain_start;
+
+		LOG_INF("Drained %u reports, %u bytes in %lld ms\n", drain_reports, drain_bytes, (long long)ms);
+	}
+}
+
+void report_store_drain_start(void)
+{
+	if (!mounted)
+	{
+		return;
+	}
+	k_mutex_lock(&store_lock, K_FOREVER);
+	draining = true;
+	k_mutex_unlock(&store_lock);
+	if (sent == meta.head || k_work_delayable_is_pending(&drain_work))
+	{
+		return;
+	}
+
+	drain_start = k_uptime_get();
+	drain_reports = 0;
+	drain_bytes = 0;
+	k_work_reschedule(&drain_work, K_NO_WAIT);
+}
+
+void report_store_drain_stop(void)
+{
+	// a batch in progress finishes under the lock, nothing is queued after
+	k_mutex_lock(&store_lock, K_FOREVER);
+	draining = false;
+	k_mutex_unlock(&store_lock);
+	k_work_cancel_delayable(&drain_work);
+}
+
+void report_store_drain_kick(void)
+{
+	// only while a drain is running, its statistics stay with it
+	if (mounted && k_work_delayable_is_pending(&drain_work))
+	{
+		k_work_reschedule(&drain_work, K_NO_WAIT);
+	}
+}
+
+void report_store_ack(uint32_t seq)
+{
+	k_mutex_lock(&store_lock, K_FOREVER);
+
+	// an acknowledgment for a report dropped since is ignored, its record ID
+	// may hold a newer report
+	if (mounted && seq - meta.tail < sent - meta.tail && release(seq))
+	{
+		save_meta();
+	}
+
+	k_mutex_unlock(&store_lock);
+}
+
+void report_store_rewind(void)
+{
+	k_mutex_lock(&store_lock, K_FOREVER);
+	sent = meta.tail;
+	k_mutex_unlock(&store_lock);
+}
+
+uint32_t report_store_count(void)
+{
+	return meta.head - meta.tail;
+}
@@ -0,0 +1,62 @@
+#ifndef _REPORT_STORE_H_
+#define _REPORT_STORE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Store-and-forward queue for reports that could not be published. Reports
+// are kept in a ring of NVS entries in flash, so they survive a reboot, and
+// are drained in batches once the broker connection is back. A drained
+// report stays in flash until the broker acknowledges it.
+
+/**
+ * @brief Mount the flash store and recover the queue.
+ *
+ * @return int - 0 on success, otherwise, negative error code.
+ */
+int report_store_init(void);
+
+/**
+ * @brief Append a report. The oldest report is dropped when the ring is full.
+ *
+ * @return int - 0 on success, otherwise, negative error code.
+ */
+int report_store_put(const uint8_t *topic, const uint8_t *payload, size_t len,
+					 uint8_t qos, uint8_t retain);
+
+/**
+ * @brief Start draining stored reports, called once the client is connected.
+ */
+void report_store_drain_start(void);
+
+/**
+ * @brief Stop draining, called when the connection is lost. Once it returns
+ * no more stored reports are queued for the MQTT thread.
+ */
+void report_store_drain_stop(void);
+
+/**
+ * @brief Send the next stored reports now, called when the MQTT thread has room.
+ */
+void report_store_drain_kick(void);
+
+/**
+ * @brief Delete a drained report once the broker acknowledged it.
+ *
+ * @param seq - mqtt_msg::store_seq of the report.
+ */
+void report_store_ack(uint32_t seq);
+
+/**
+ * @brief Drain the unacknowledged reports again, called on connect once the
+ * messages of the previous connection are gone, from flight and from the
+ * publish queue.
+ */
+void report_store_rewind(void);
+
+/**
+ * @brief Number of reports waiting in flash, sent or not.
+ */
+uint32_t report_store_count(void);
+
+#endif /* _REPORT_STORE_H_ */
@@ -0,0 +1,76 @@
+#include <zephyr/kernel.h>
+
+#include "wind_bins.h"
+
+BUILD_ASSERT((WIND_BIN_RING_SIZE & (WIND_BIN_RING_SIZE - 1)) == 0, "ring size must be a power of two");
+
+#define RING_IDX(i) ((i) & (WIND_BIN_RING_SIZE - 1))
+
+static struct k_spinlock lock;
+
+static uint32_t bins[WIND_BIN_RING_SIZE]; // pulses per bin, thousandths
+static uint32_t seq;					  // number of bins added since boot
+static uint32_t filled;					  // bins added since the window was configured
+static uint32_t window_sum;
+
+static uint8_t bin_seconds = 1;
+static uint8_t window_bins = 3;
+
+static struct wind_period period = {.lull_mhz = UINT32_MAX};
+
+void wind_bins_configure(uint8_t seconds, uint8_t window)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	bin_seconds = MAX(seconds, 1);
+	window_bins = CLAMP(window, 1, WIND_BIN_RING_SIZE);
+	filled = 0;
+	window_sum = 0;
+
+	k_spin_unlock(&lock, key);
+}
+
+void wind_bins_add(uint32_t mpulses)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	if (filled >= window_bins)
+	{
+		window_sum -= bins[RING_IDX(seq - window_bins)];
+	}
+	bins[RING_IDX(seq)] = mpulses;
+	window_sum += mpulses;
+	++filled;
+
+	period.seconds += bin_seconds;
+	period.mpulses += mpulses;
+
+	// the window slides one bin per add, so the gust and lull of the period
+	// are the running max and min of its rate
+	if (filled >= window_bins)
+	{
+		uint32_t rate = window_sum / (window_bins * bin_seconds);
+
+		period.gust_mhz = MAX(period.gust_mhz, rate);
+		period.lull_mhz = MIN(period.lull_mhz, rate);
+	}
+	++seq;
+
+	k_spin_unlock(&lock, key);
+}
+
+void wind_bins_period_take(struct wind_period *p)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*p = period;
+	period = (struct wind_period){.lull_mhz = UINT32_MAX};
+
+	k_spin_unlock(&lock, key);
+
+	// no complete gust window in this period
+	if (p->lull_mhz == UINT32_MAX)
+	{
+		p->lull_mhz = p->gust_mhz;
+	}
+}
@@ -0,0 +1,39 @@
+#ifndef _WIND_BINS_H_
+#define _WIND_BINS_H_
+
+#include <stdint.h>
+
+// Continuous wind speed acquisition. Pulses are binned once per sample
+// period into a fixed ring, in thousandths so a bin can hold the fraction
+// of a pulse measured from the pulse period. A sliding sum over the gust
+// window (3 seconds by default) gives the WMO style gust, the gust and lull
+// of a report period are the running max and min of that sum, O(1) per bin.
+// Memory does not depend on the report interval.
+#define WIND_BIN_RING_SIZE 64 // longest gust window in bins, power of two
+
+// statistics of a report period, rates are in milli pulses per second
+struct wind_period
+{
+	uint32_t seconds;  // time covered by the bins of the period
+	uint32_t mpulses;  // total pulses in the period, thousandths
+	uint32_t gust_mhz; // highest gust window rate
+	uint32_t lull_mhz; // lowest gust window rate
+};
+
+/**
+ * @brief Set the bin length and the number of bins in the gust window.
+ * Restarts the gust window, the report period is kept.
+ */
+void wind_bins_configure(uint8_t bin_seconds, uint8_t window_bins);
+
+/**
+ * @brief Add the pulses of the latest bin, in thousandths. O(1), ISR safe.
+ */
+void wind_bins_add(uint32_t mpulses);
+
+/**
+ * @brief Get the statistics of the current report period and start a new one.
+ */
+void wind_bins_period_take(struct wind_period *period);
+
+#endif /* _WIND_BINS_H_ */
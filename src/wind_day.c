@@ -0,0 +1,64 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+
+#include "wind_day.h"
+
+#define SECONDS_PER_HOUR 3600
+
+// indexed by hour of the day, hour_nr tells which day the rows belong to
+static uint8_t rows[24][WIND_DAY_ROWS_PER_HOUR][WIND_DAY_ROW_SIZE];
+static int64_t hour_nr[24] = {[0 ... 23] = -1};
+static time_t newest;
+static K_MUTEX_DEFINE(day_lock);
+
+void wind_day_add(time_t time, const struct w_sensor *wind)
+{
+	int64_t hour = time / SECONDS_PER_HOUR;
+	int index = hour % 24;
+	uint8_t *row = rows[index][(time % SECONDS_PER_HOUR) / (WIND_DAY_ROW_MINUTES * 60)];
+
+	k_mutex_lock(&day_lock, K_FOREVER);
+
+	// the slot of this hour still holds yesterday
+	if (hour_nr[index] != hour)
+	{
+		memset(rows[index], 0, sizeof(rows[index]));
+		hour_nr[index] = hour;
+	}
+
+	bool filled = row[1] != 0;
+
+	row[0] = wind->speed;
+	row[1] = MAX((wind->direction + 1) / 2, 1);
+	row[2] = filled ? MAX(row[2], wind->gust) : wind->gust;
+	row[3] = filled ? MIN(row[3], wind->lull) : wind->lull;
+	newest = MAX(newest, time);
+
+	k_mutex_unlock(&day_lock);
+}
+
+time_t wind_day_get(uint8_t *out)
+{
+	k_mutex_lock(&day_lock, K_FOREVER);
+
+	int64_t last = newest / SECONDS_PER_HOUR;
+
+	for (int i = 0; i < 24; ++i)
+	{
+		int64_t hour = last - 23 + i;
+		uint8_t *dst = out + i * sizeof(rows[0]);
+
+		if (hour >= 0 && hour_nr[hour % 24] == hour)
+		{
+			memcpy(dst, rows[hour % 24], sizeof(rows[0]));
+		}
+		else
+		{
+			memset(dst, 0, sizeof(rows[0]));
+		}
+	}
+	time_t time = newest;
+
+	k_mutex_unlock(&day_lock);
+	return time;
+}
@@ -0,0 +1,36 @@
+#ifndef _WIND_DAY_H_
+#define _WIND_DAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "wind_sensor.h"
+
+// Rolling 24 hour wind summary on a fixed 10 minute grid, whatever the
+// report interval. Each report updates its row in place, the whole day is
+// then published as one retained message. A row is 4 bytes: speed mph,
+// direction in 2 degree steps (0 for no data), gust mph, lull mph.
+#define WIND_DAY_ROW_MINUTES 10
+#define WIND_DAY_ROWS_PER_HOUR (60 / WIND_DAY_ROW_MINUTES)
+#define WIND_DAY_ROW_SIZE 4
+#define WIND_DAY_SIZE (24 * WIND_DAY_ROWS_PER_HOUR * WIND_DAY_ROW_SIZE)
+
+/**
+ * @brief Add a report to the row of its time. A second report in the same
+ * row replaces speed and direction, and keeps the highest gust and lowest lull.
+ *
+ * @param time - start of the report slot, unix time.
+ */
+void wind_day_add(time_t time, const struct w_sensor *wind);
+
+/**
+ * @brief Copy the 24 hours ending with the hour of the newest report, oldest
+ * row first. Rows of hours without reports are zero.
+ *
+ * @param[out] rows - WIND_DAY_SIZE bytes.
+ * @return time_t - time of the newest report.
+ */
+time_t wind_day_get(uint8_t *rows);
+
+#endif /* _WIND_DAY_H_ */
@@ -0,0 +1,89 @@
+#include <zephyr/kernel.h>
+
+#include "wind_rate.h"
+
+// a gap this long is calm, the latest edge says nothing about the next one,
+// and it is well within the wrap of the 32 bit microsecond clock
+#define MAX_GAP_US (60 * USEC_PER_SEC)
+
+// a gust above the limit keeps the timestamps, only a rate held this long
+// turns them off. A gust of a few seconds counted would lose the fraction
+// at each switch, and the gust maximum carries that error.
+#define SUSTAIN_US (10 * USEC_PER_SEC)
+
+void wind_rate_init(struct wind_rate *wr, uint32_t max_hz)
+{
+	*wr = (struct wind_rate){
+		.max_mhz = max_hz * 1000,
+		.timing = max_hz > 0,
+	};
+}
+
+// the part of the pulse in progress idle_us after the latest edge, an
+// overdue pulse is credited up to its edge and never beyond
+static uint16_t pulse_fraction(const struct wind_rate *wr, uint32_t idle_us)
+{
+	if (idle_us >= wr->period_us)
+	{
+		return 1000;
+	}
+	return ((uint64_t)idle_us * 1000) / wr->period_us;
+}
+
+uint32_t wind_rate_update(struct wind_rate *wr, const struct pulse_reading *r, uint32_t tick_us)
+{
+	uint16_t frac = wr->frac;
+	uint32_t mpulses;
+	uint64_t mhz;
+
+	if (!r->timed)
+	{
+		// counted, a credited fraction is used up by the next pulse
+		wr->edge_valid = false;
+		if (r->pulses)
+		{
+			frac = 0;
+		}
+	}
+	else if (r->pulses)
+	{
+		// without an earlier edge the count gives the first period
+		wr->period_us = wr->edge_valid ? (r->edge_us - wr->edge_us) / r->pulses : tick_us / r->pulses;
+		wr->period_us = MAX(wr->period_us, 1);
+		wr->edge_us = r->edge_us;
+		wr->edge_valid = true;
+		frac = pulse_fraction(wr, r->now_us - r->edge_us);
+	}
+	else if (wr->edge_valid)
+	{
+		uint32_t idle_us = r->now_us - wr->edge_us;
+
+		// past the gap the fraction stays where it is until the next edge
+		if (idle_us >= MAX_GAP_US)
+		{
+			wr->edge_valid = false;
+		}
+		else
+		{
+			frac = MAX(frac, pulse_fraction(wr, idle_us));
+		}
+	}
+
+	// never negative, a new pulse adds 1000 and a fraction is at most 1000
+	mpulses = r->pulses * 1000 + frac - wr->frac;
+	wr->frac = frac;
+
+	mhz = ((uint64_t)mpulses * USEC_PER_SEC) / MAX(tick_us, 1);
+	wr->high_us = mhz > wr->max_mhz ? MIN(wr->high_us + tick_us, SUSTAIN_US) : 0;
+	wr->quiet_us = r->pulses == 0 ? MIN(wr->quiet_us + tick_us, MAX_GAP_US) : 0;
+	// in a calm nothing is left to time, the next pulse is counted
+	if (wr->timing && (wr->high_us >= SUSTAIN_US || wr->quiet_us >= MAX_GAP_US))
+	{
+		wr->timing = false;
+	}
+	else if (!wr->timing && wr->quiet_us < MAX_GAP_US && mhz < wr->max_mhz * 3 / 4)
+	{
+		wr->timing = true;
+	}
+	return mpulses;
+}
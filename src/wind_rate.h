@@ -0,0 +1,44 @@
+#ifndef _WIND_RATE_H_
+#define _WIND_RATE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pulse_counter.h"
+
+// Reciprocal speed measurement for light winds. A tick at light wind holds
+// only a few pulses, so a count alone quantizes the speed to one pulse per
+// window. With edge timestamps each tick is also credited the fraction of
+// the pulse in progress, from the time since the latest edge over the mean
+// period of the latest edges. The fractions telescope, over any run of
+// ticks the credited pulses stay within one of the counted ones.
+//
+// Held above max_hz a count is precise enough, the timestamps are turned
+// off and the ticks are counted, with hysteresis so the mode does not
+// chatter. They are also off in a calm, the next pulse turns them on.
+
+struct wind_rate
+{
+	uint32_t max_mhz;	// period measurement below this rate, 0 never
+	uint32_t period_us; // mean period of the latest edges
+	uint32_t edge_us;	// latest edge
+	uint32_t high_us;	// above max_mhz for this long
+	uint32_t quiet_us;	// without a pulse for this long
+	uint16_t frac;		// pulse in progress credited so far, thousandths
+	bool edge_valid;	// edge_us and period_us can be used
+	bool timing;		// edge timestamps wanted
+};
+
+void wind_rate_init(struct wind_rate *wr, uint32_t max_hz);
+
+/**
+ * @brief Pulses of one tick, from a reading of the pulse counter. Apply
+ * wr->timing to the pulse counter after the call.
+ *
+ * @param tick_us - nominal tick length, for the mode switch.
+ * @return uint32_t - pulses in thousandths, a fraction of a pulse at light
+ * winds when the reading is timed.
+ */
+uint32_t wind_rate_update(struct wind_rate *wr, const struct pulse_reading *r, uint32_t tick_us);
+
+#endif /* _WIND_RATE_H_ */
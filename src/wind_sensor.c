@@ -9,163 +9,169 @@
 
 #include "mqtt_connection.h"
 #include "wind_sensor.h"
-#include "adc.h"
+#include "acquisition.h"
+#include "activity.h"
+#include "calib.h"
+#include "battery.h"
+#include "direction.h"
 #include "health.h"
 #include "leds.h"
+#include "payload.h"
+#include "power.h"
+#include "pulse_counter.h"
+#include "report_policy.h"
+#include "report_sched.h"
+#include "wind_day.h"
+#include "wind_bins.h"
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(sensor, LOG_LEVEL_INF);
 
-#define SECONDS_PER_SAMPLE (60)    // 60 is the minimum, lower requires code fix
-#define SAMPLE_DURATION 6
-#define REPORTS_PER_HOUR 6     // 6 is every 10 minutes
-#define MINUTES_PER_REPORT (60 / REPORTS_PER_HOUR)
+#define MAX_SAMPLE_PERIOD_S 60
 
 #define WIND_SPEED_NODE DT_ALIAS(windspeed0)
 static const struct gpio_dt_spec windspeed = GPIO_DT_SPEC_GET(WIND_SPEED_NODE, gpios);
 
-#define WIND_SCALE (102.0 / 60.0)
-#define MAX_DIRECTION_VOLTAGE 1630
-#define NORTH_OFFSET 90 // Aim to the east so discontinuity is not at north
+static uint32_t wakeups_per_hour;
+static uint8_t tick_seconds = 1;
 
-static volatile int frequency = 0;
-static volatile int64_t lasttime = 0;
+// cadence asked for by commands and the power tier, set from the MQTT and
+// battery threads under config_lock
+static K_MUTEX_DEFINE(config_lock);
+static struct wind_config requested = {
+	.sample_period_s = 1,
+	.sample_duration_s = 3,
+	.report_minutes = 10,
+};
+static enum power_tier requested_tier = POWER_TIER_NORMAL;
 
-static int sample_count;
-static int speed;
-static int gust;
-static int lull;
+// what runs after the power tier, only written in the system work queue
+// like the aggregation and reports that read it
+static struct wind_config config;
+static bool clear_hour;
 
-static bool broker_cleared = false;
 static uint16_t wind_direction;
 
-// circular buffer holding direction voltages
-uint16_t _dir_buf[8]; // fixed size due to averaging calculation
-uint16_t _dir_idx = 0;
+// direction samples of the current report period, weighted by the pulses of
+// the latest speed bin. Aggregation and reports both run in the system work
+// queue, so the period needs no lock.
+static struct dir_accum dir_period;
+static uint32_t last_bin_mpulses;
 
-struct w_sensor
-{
-	uint8_t speed;
-	uint8_t gust;
-	uint8_t lull;
-	uint16_t direction;
-} wind_sensor[REPORTS_PER_HOUR];
-
-static struct gpio_callback windspeed_cb_data;
+struct w_sensor wind_sensor[WIND_MAX_REPORTS_PER_HOUR];
 
-static void sensor_sample_timer_cb(struct k_timer *work);
-static void wind_direction_timer_cb(struct k_timer *work);
-static void wind_speed_sample_timer_cb(struct k_timer *work);
-static void publish_reports_work_cb(struct k_work *timer_id);
+static void acquisition_ready(void);
+static void aggregate_work_cb(struct k_work *work);
+static void publish_report(const struct report_slot *rs);
+static void report_now_work_cb(struct k_work *work);
+static void config_work_cb(struct k_work *work);
+static void apply_config(void);
 
-static void restart_samples();
-static void build_array_string(uint8_t *buf, struct tm *t);
-static void clear_broker_history();
-static uint16_t circ_avg(uint16_t a, uint16_t b);
+static uint8_t pulses_to_mph(uint32_t mpulses, uint32_t seconds);
+static int publish_wind(time_t now, int hour, int slot, int slots, bool end_of_hour);
+static int publish_day(void);
 
 //************************
 // Timers and Work threads
 //************************
-static K_TIMER_DEFINE(sensor_sample_timer, sensor_sample_timer_cb, NULL);
-static K_TIMER_DEFINE(wind_direction_timer, wind_direction_timer_cb, NULL);
-static K_TIMER_DEFINE(wind_speed_sample_timer, wind_speed_sample_timer_cb, NULL);
-static K_WORK_DEFINE(publish_reports_work, publish_reports_work_cb);
+static K_WORK_DEFINE(aggregate_work, aggregate_work_cb);
+static K_WORK_DEFINE(report_now_work, report_now_work_cb);
+static K_WORK_DEFINE(config_work, config_work_cb);
 
-// initiates the measuring of wind data
-static void sensor_sample_timer_cb(struct k_timer *work)
+// called by the acquisition thread once a sample is queued
+static void acquisition_ready(void)
 {
-	turn_leds_on_with_color(GREEN);
-
-	// start counting windspeed pulses
-	frequency = 0;
-	k_timer_start(&wind_speed_sample_timer, K_SECONDS(SAMPLE_DURATION), K_FOREVER);
-
-	// start sampling direction sensor
-	k_timer_start(&wind_direction_timer, K_SECONDS(1), K_MSEC(400));
+	k_work_submit(&aggregate_work);
 }
 
-// updates the wind_direction variable by reading sensor voltage and applying a running average.
-// runs multiple times while windspeed is being calculated
-static void wind_direction_timer_cb(struct k_timer *work)
+// Aggregates the queued acquisition ticks. The pulses of each tick become one
+// bin of the continuous wind record, the direction is added to the vector
+// mean, and a due report is prepared in the same wakeup.
+static void aggregate_work_cb(struct k_work *work)
 {
-	uint16_t voltage;
+	struct acq_sample sample;
+	uint32_t mpulses;
 
-	if (get_adc_voltage(ADC_WIND_DIR_ID, &voltage) != 0)
+	ARG_UNUSED(work);
+	while (acquisition_get(&sample))
 	{
-		LOG_WRN("Failed to get direction voltage\n");
-		return;
-	};
+		if (sample.flags & ACQ_PULSES_OK)
+		{
+			// plausibility limit, replaces the per-pulse software glitch filter
+			mpulses = MIN(sample.mpulses, (uint64_t)CONFIG_WIND_PULSE_MAX_HZ * tick_seconds * 1000 * sample.ticks);
+			// ticks merged while the thread was busy are spread evenly over
+			// their bins, the remainder goes to the last
+			for (int i = sample.ticks; i > 0; --i)
+			{
+				uint32_t bin = i == 1 ? mpulses : mpulses / i;
 
-	//	printk("direction voltage, %d\n", voltage);
-	_dir_buf[_dir_idx] = (((uint32_t)voltage * 360) / MAX_DIRECTION_VOLTAGE + NORTH_OFFSET) % 360;
+				wind_bins_add(bin);
+				mpulses -= bin;
+				last_bin_mpulses = bin;
+			}
+		}
+		else
+		{
+			LOG_WRN("Failed to read pulse counter\n");
+		}
 
-	_dir_idx = (_dir_idx + 1) % 8;
-	wind_direction = circ_avg(
-		circ_avg(circ_avg(_dir_buf[0], _dir_buf[1]), circ_avg(_dir_buf[2], _dir_buf[3])),
-		circ_avg(circ_avg(_dir_buf[4], _dir_buf[5]), circ_avg(_dir_buf[6], _dir_buf[7])));
+		if (sample.flags & ACQ_DIRECTION_OK)
+		{
+			dir_accum_add(&dir_period, calib_direction(sample.dir_mv), last_bin_mpulses);
+		}
+		else
+		{
+			LOG_WRN("Failed to get direction voltage\n");
+		}
+	}
 
-	//	LOG_INF("dir volts %d  dir %d\n", voltage, wind_direction);
+	report_sched_run_due();
 }
 
-// The timer sets the period wind speed pulses are counted. At the end of the timer
-// all sensor data gathering (speed and direction) is complete and then
-// the wind speed is calculated from the number of pulses counted.
-// A job is submitted to send the MQTT data
-static void wind_speed_sample_timer_cb(struct k_timer *work)
+// wakeups per hour since the previous call
+static void measure_wakeups(uint32_t timer_wakeups)
 {
-	float f = frequency / 6.0 * WIND_SCALE;
-	int current_speed = (int)f;
-	++sample_count;
-	speed += current_speed;
-	gust = (gust > current_speed) ? gust : current_speed;
-	lull = (lull < current_speed) ? lull : current_speed;
+	static uint32_t last_wakeups;
+	static int64_t last_uptime;
+	int64_t now = k_uptime_get();
 
-	LOG_DBG("Windspeed %d ...\n", speed);
-	frequency = 0;
-
-	k_work_submit(&publish_reports_work);
-}
-
-// ISR called on each pulse from the speed sensor, counts the number of pulses in
-// the timer period
-void windspeed_handler(const struct device *dev, struct gpio_callback *cb, uint32_t pins)
-{
-	int64_t time = k_uptime_get();
-	// filter out sensor glitches
-	if ((time - lasttime) > 10)
+	if (now > last_uptime)
 	{
-		frequency++;
+		wakeups_per_hour = ((uint64_t)(timer_wakeups - last_wakeups) * 3600 * MSEC_PER_SEC) / (now - last_uptime);
 	}
-	lasttime = time;
+	last_wakeups = timer_wakeups;
+	last_uptime = now;
 }
 
-// background task that sends the MQTT sensor data
-// data is sent less often if night time or little wind
-static void publish_reports_work_cb(struct k_work *timer_id)
+// called by the report scheduler once per report slot, sends the MQTT
+// sensor data, less often if there is little change in the wind
+static void publish_report(const struct report_slot *rs)
 {
-	time_t now;
-	now = time(NULL);
-	struct tm tm;
-	gmtime_r(&now, &tm);
+	struct report_sched_stats sched;
+	struct acq_stats acq;
+	struct wind_period period;
+	struct dir_accum dir;
 	int avg_speed;
 
-	clear_broker_history();
-
-	int hour = tm.tm_hour;
-	int minute = tm.tm_min;
-
-	// only report if it's the first sample period of the report period
-	if (minute % MINUTES_PER_REPORT != 0)
-	{
-		turn_leds_on_with_color(BLUE);
-		return;
-	}
+	int reports_per_hour = rs->per_hour;
 
 	turn_leds_on_with_color(MAGENTA);
 
-	// zero out hourly data for the first report of the hour
-	if (minute < MINUTES_PER_REPORT)
+	acquisition_stats_get(&acq);
+	measure_wakeups(acq.ticks);
+	LOG_INF("pulse irqs %u, timer wakeups %u, %u per hour (budget %u), missed %u\n", pulse_counter_irq_count(),
+			acq.ticks, wakeups_per_hour, CONFIG_WIND_WAKEUP_BUDGET_PER_HOUR, acq.missed);
+	LOG_INF("timer isr max %u us, tick to sample mean %u us max %u us, overruns %u, timed %u\n",
+			acq.isr_max_us, acq.wake_mean_us, acq.wake_max_us, acq.overruns, acq.timed);
+	report_sched_stats_get(&sched);
+	LOG_INF("report slots %u, skipped %u, late %u, clock jumps %u%s\n", sched.reports, sched.skipped,
+			sched.late, sched.jumps, rs->synced ? "" : ", time not synced");
+
+	// zero out hourly data for the first report of the hour, or when the
+	// report interval changed
+	if (rs->new_hour || clear_hour)
 	{
-		for (int i = 0; i < REPORTS_PER_HOUR; ++i)
+		clear_hour = false;
+		for (int i = 0; i < WIND_MAX_REPORTS_PER_HOUR; ++i)
 		{
 			wind_sensor[i].speed = 0;
 			wind_sensor[i].gust = 0;
@@ -174,113 +180,163 @@ static void publish_reports_work_cb(struct k_work *timer_id)
 		}
 	}
 
-	avg_speed = speed / sample_count;
+	wind_bins_period_take(&period);
+	avg_speed = pulses_to_mph(period.mpulses, period.seconds);
+
+	dir = dir_period;
+	dir_accum_reset(&dir_period);
+
+	// keep the last direction if no sample was taken
+	if (dir.count)
+	{
+		wind_direction = dir_accum_mean(&dir, true);
+	}
+	LOG_INF("direction %u from %u samples, steadiness %u%%\n", wind_direction, dir.count,
+			dir_accum_steadiness(&dir));
+
 	// 0,0 indicates unset item.
 	if (avg_speed == 0 && wind_direction == 0)
 	{
 		wind_direction = 1;
 	}
 
-	wind_sensor[minute / MINUTES_PER_REPORT].speed = avg_speed;
-	wind_sensor[minute / MINUTES_PER_REPORT].gust = gust;
-	wind_sensor[minute / MINUTES_PER_REPORT].lull = lull;
-	k_timer_stop(&wind_direction_timer);
-	wind_sensor[minute / MINUTES_PER_REPORT].direction = wind_direction;
-	restart_samples();
+	int slot = rs->index;
 
-	uint8_t *msgbuf = get_mqtt_message_buf();
-	uint8_t *topicbuf = get_mqtt_topic_buf();
+	wind_sensor[slot].speed = avg_speed;
+	wind_sensor[slot].gust = calib_speed_mph(period.gust_mhz);
+	wind_sensor[slot].lull = calib_speed_mph(period.lull_mhz);
+	wind_sensor[slot].direction = wind_direction;
 
-	build_array_string(msgbuf, &tm);
-	sprintf(topicbuf, "%s/wind/%02d", CONFIG_MQTT_PRIMARY_TOPIC, hour);
+	bool end_of_hour = slot == reports_per_hour - 1;
 
-	bool end_of_hour = minute / 5 == 11;
+	wind_day_add(rs->time, &wind_sensor[slot]);
 
-	// always publish data just before the next hour, or
-	// publish only if the time is between 10AM and 9PM and
-	// the speed is higher than 5
-	if (end_of_hour ||
-		( // hour > 9 && hour < 21 &&
-			(avg_speed >= 0)))
+	// always publish data just before the next hour, otherwise
+	// only if the wind changed enough since the last report
+	if (report_policy_should_publish(&wind_sensor[slot], end_of_hour))
 	{
-
-		int err;
-		err = data_publish(MQTT_QOS_1_AT_LEAST_ONCE,
-						   msgbuf, strlen(msgbuf), topicbuf, 1);
-		if (err)
+		if (publish_wind(rs->time, rs->hour, slot, reports_per_hour, end_of_hour) != 0)
 		{
-			LOG_WRN("Failed to send message, %d\n", err);
 			return;
 		}
+		publish_day();
+		power_report_done();
 	}
 	if (end_of_hour)
 	{
-		k_msleep(1000);
 		turn_leds_on_with_color(RED);
 		publish_health_data();
 	}
+
+	// a power tier change takes effect from the next report slot
+	health_sample();
+}
+
+// publishes the hour so far and the health data on request
+static void report_now_work_cb(struct k_work *work)
+{
+	time_t now = time(NULL);
+	struct tm tm;
+
+	ARG_UNUSED(work);
+	gmtime_r(&now, &tm);
+	turn_leds_on_with_color(MAGENTA);
+	if (publish_wind(now, tm.tm_hour, tm.tm_min / config.report_minutes, 60 / config.report_minutes, true) == 0)
+	{
+		publish_day();
+		power_report_done();
+	}
+	publish_health_data();
 }
 
 //************************
 // Static functions
 //************************
 
-static void restart_samples()
+// converts pulses over a number of seconds to mph, an hour at the highest
+// plausible rate is 360 million thousandths, well within 32 bits
+static uint8_t pulses_to_mph(uint32_t mpulses, uint32_t seconds)
 {
-	sample_count = 0;
-	speed = 0;
-	gust = 0;
-	lull = 100;
+	if (seconds == 0)
+	{
+		return 0;
+	}
+	return calib_speed_mph(mpulses / seconds);
 }
 
-// creates JSON string containing time and wind data
-static void build_array_string(uint8_t *buf, struct tm *t)
+// Publishes the latest report. In delta mode only the new slot goes out, on
+// a non-retained topic. The whole hour is published retained once it is
+// complete, so new subscribers can rebuild it.
+static int publish_wind(time_t now, int hour, int slot, int slots, bool end_of_hour)
 {
+	struct mqtt_msg *msg = mqtt_msg_alloc(K_NO_WAIT);
+	int len;
+	int err;
 
-	buf += sprintf(buf, "{\"time\":\"%04d-%02d-%02dT%02d:%02dZ\", ", (t->tm_year + 1900), t->tm_mon + 1, t->tm_mday, t->tm_hour, t->tm_min);
-	buf += sprintf(buf, "\"wind\":[");
+	if (msg == NULL)
+	{
+		LOG_WRN("No message buffer for wind report\n");
+		return -ENOMEM;
+	}
 
-	for (int i = 0; i < REPORTS_PER_HOUR; ++i)
+	if (IS_ENABLED(CONFIG_WIND_DELTA_PUBLISH) && !end_of_hour)
 	{
-		buf += sprintf(buf, "[%d, %d, %d, %d],", wind_sensor[i].speed, wind_sensor[i].direction, wind_sensor[i].gust, wind_sensor[i].lull);
+		len = payload_wind_slot(msg->payload, sizeof(msg->payload), mqtt_station_id(), now, slot, &wind_sensor[slot]);
+		payload_topic(msg->topic, sizeof(msg->topic), mqtt_station_id(), "wind/delta");
+	}
+	else
+	{
+		len = payload_wind(msg->payload, sizeof(msg->payload), mqtt_station_id(), now, wind_sensor, slots);
+		payload_topic(msg->topic, sizeof(msg->topic), mqtt_station_id(), "wind/%02d", hour);
+	}
+	if (len < 0)
+	{
+		LOG_WRN("Failed to encode wind report, %d\n", len);
+		mqtt_msg_free(msg);
+		return len;
 	}
-	--buf; // remove the last comma
-	sprintf(buf, "]}");
-}
 
-// erases the persistant MQTT data, occurs once at boot time
-static void clear_broker_history()
-{
-	uint8_t *topicbuf = get_mqtt_topic_buf();
+	msg->len = len;
+	msg->retain = !IS_ENABLED(CONFIG_WIND_DELTA_PUBLISH) || end_of_hour;
 
-	// clear the broker data first time after power up
-	if (!broker_cleared)
+	err = data_publish(msg);
+	if (err)
 	{
-		LOG_WRN("clearing broker history\n");
-		broker_cleared = true;
-		for (int i = 0; i < 24; ++i)
-		{
-			sprintf(topicbuf, "%s/wind/%02d", CONFIG_MQTT_PRIMARY_TOPIC, i);
-			int err = data_publish(MQTT_QOS_1_AT_LEAST_ONCE,
-								   "", 0, topicbuf, 1);
-			if (err)
-			{
-				LOG_WRN("Failed to send broker clear message, %d\n", err);
-				return;
-			}
-		}
+		LOG_WRN("Failed to send message, %d\n", err);
 	}
+	return err;
 }
 
-// averages two angles, result is between 0 and 359
-static uint16_t circ_avg(uint16_t a, uint16_t b)
+// Publishes the rolling 24 hours retained, so a new subscriber gets the
+// whole day in one message. QoS 0, the next report supersedes a lost one.
+static int publish_day(void)
 {
-	int16_t diff = ((a - b + 180 + 360) % 360) - 180;
-	int16_t angle = (360 + b + (diff / 2)) % 360;
-	//	printk("avg=      %d, %d, %d, %d", a, b, diff, angle);
-	return angle;
-}
+	static uint8_t rows[WIND_DAY_SIZE];
+	struct mqtt_msg *msg = mqtt_msg_alloc(K_NO_WAIT);
+	time_t newest;
+	int len;
 
+	if (msg == NULL)
+	{
+		LOG_WRN("No message buffer for the day summary\n");
+		return -ENOBUFS;
+	}
+
+	newest = wind_day_get(rows);
+	len = payload_wind_day(msg->payload, sizeof(msg->payload), mqtt_station_id(), newest, rows);
+	if (len < 0)
+	{
+		LOG_WRN("Failed to encode day summary, %d\n", len);
+		mqtt_msg_free(msg);
+		return len;
+	}
+
+	msg->len = len;
+	msg->qos = MQTT_QOS_0_AT_MOST_ONCE;
+	msg->retain = 1;
+	payload_topic(msg->topic, sizeof(msg->topic), mqtt_station_id(), "wind/day");
+	return data_publish(msg);
+}
 
 //************************
 // Public functions
@@ -299,16 +355,114 @@ int init_wind_sensor()
 	{
 		return err;
 	}
-	err = gpio_pin_interrupt_configure_dt(&windspeed, GPIO_INT_EDGE_TO_ACTIVE);
+	err = pulse_counter_init(&windspeed);
+	if (err < 0)
+	{
+		return err;
+	}
+
+	acquisition_init(acquisition_ready);
+	// nothing samples or reports yet, the first cadence is applied here
+	apply_config();
+	report_sched_init(publish_report, config.report_minutes);
+
+	return 0;
+}
+
+// runs the requested cadence, slowed down in the low power tiers
+static void apply_config(void)
+{
+	struct wind_config cfg;
+	enum power_tier power_tier;
 
-	gpio_init_callback(&windspeed_cb_data, windspeed_handler, BIT(windspeed.pin));
+	k_mutex_lock(&config_lock, K_FOREVER);
+	cfg = requested;
+	power_tier = requested_tier;
+	k_mutex_unlock(&config_lock);
 
-	gpio_add_callback(windspeed.port, &windspeed_cb_data);
+	if (power_tier == POWER_TIER_SAVING)
+	{
+		cfg.sample_period_s = MAX(cfg.sample_period_s, 3);
+		cfg.report_minutes = MAX(cfg.report_minutes, 20);
+	}
+	else if (power_tier == POWER_TIER_CRITICAL)
+	{
+		cfg.sample_period_s = MAX(cfg.sample_period_s, 10);
+		cfg.report_minutes = 60;
+	}
+	cfg.sample_duration_s = MAX(cfg.sample_duration_s, cfg.sample_period_s);
 
-	restart_samples();
+	if (cfg.report_minutes != config.report_minutes)
+	{
+		clear_hour = true;
+	}
+	config = cfg;
+	report_sched_set_interval(config.report_minutes);
+
+	// the wakeup budget sets the shortest tick, a longer tick makes longer
+	// speed bins and fewer direction samples
+	tick_seconds = MAX(config.sample_period_s, DIV_ROUND_UP(3600, CONFIG_WIND_WAKEUP_BUDGET_PER_HOUR));
+	wind_bins_configure(tick_seconds, MAX(config.sample_duration_s / tick_seconds, 1));
+	acquisition_set_tick(tick_seconds);
+	// whole pulses are good enough when the battery is low
+	acquisition_set_timing(power_tier == POWER_TIER_NORMAL);
+
+	LOG_INF("tick %d s, gust window %d s, report every %d min\n",
+			tick_seconds, config.sample_duration_s, config.report_minutes);
+}
 
+// a new cadence takes effect between two aggregations or reports, never
+// in the middle of one
+static void config_work_cb(struct k_work *work)
+{
+	ARG_UNUSED(work);
+	apply_config();
+}
 
-	k_timer_start(&sensor_sample_timer, K_SECONDS(5), K_SECONDS(SECONDS_PER_SAMPLE));
+int wind_sensor_set_config(const struct wind_config *cfg)
+{
+	if (cfg->sample_period_s == 0 || cfg->sample_period_s > MAX_SAMPLE_PERIOD_S ||
+		cfg->sample_duration_s < cfg->sample_period_s ||
+		cfg->sample_duration_s > cfg->sample_period_s * WIND_BIN_RING_SIZE ||
+		cfg->report_minutes == 0 || (60 % cfg->report_minutes) != 0 ||
+		(60 / cfg->report_minutes) > WIND_MAX_REPORTS_PER_HOUR)
+	{
+		return -EINVAL;
+	}
 
+	k_mutex_lock(&config_lock, K_FOREVER);
+	requested = *cfg;
+	k_mutex_unlock(&config_lock);
+	k_work_submit(&config_work);
 	return 0;
 }
+
+void wind_sensor_get_config(struct wind_config *cfg)
+{
+	k_mutex_lock(&config_lock, K_FOREVER);
+	*cfg = requested;
+	k_mutex_unlock(&config_lock);
+}
+
+void wind_sensor_set_power_tier(int tier)
+{
+	k_mutex_lock(&config_lock, K_FOREVER);
+	requested_tier = tier;
+	k_mutex_unlock(&config_lock);
+	k_work_submit(&config_work);
+}
+
+void wind_sensor_report_now(void)
+{
+	k_work_submit(&report_now_work);
+}
+
+int get_sample_time()
+{
+	return tick_seconds;
+}
+
+uint32_t wind_sensor_wakeups_per_hour(void)
+{
+	return wakeups_per_hour;
+}
@@ -1,6 +1,61 @@
 #ifndef _WIND_SENSOR_H_
 #define _WIND_SENSOR_H_
 
+#include <stdint.h>
+
+#define WIND_MAX_REPORTS_PER_HOUR 12 // shortest report interval is 5 minutes
+
+// wind summary of one report period, speeds in mph, direction in degrees
+struct w_sensor
+{
+	uint8_t speed;
+	uint8_t gust;
+	uint8_t lull;
+	uint16_t direction;
+};
+
+// sampling and reporting cadence, changeable at run time
+struct wind_config
+{
+	uint8_t sample_period_s;   // length of a speed bin and direction sample period
+	uint8_t sample_duration_s; // gust averaging window
+	uint8_t report_minutes;	   // report interval, must divide an hour
+};
+
 int init_wind_sensor();
 
+/**
+ * @brief Validate a new sampling and reporting cadence, it is applied
+ * from the system work queue.
+ *
+ * @return int - 0 on success, -EINVAL if a value is out of range.
+ */
+int wind_sensor_set_config(const struct wind_config *cfg);
+
+/**
+ * @brief Get the cadence last set, before any power tier slow down.
+ */
+void wind_sensor_get_config(struct wind_config *cfg);
+
+/**
+ * @brief Slow sampling and reporting down for a power tier, see battery.h.
+ * Applied from the system work queue.
+ */
+void wind_sensor_set_power_tier(int tier);
+
+/**
+ * @brief Publish the current hour and the health data right away.
+ */
+void wind_sensor_report_now(void);
+
+/**
+ * @brief Current sample period in seconds.
+ */
+int get_sample_time();
+
+/**
+ * @brief Acquisition wakeups per hour, measured over the last report period.
+ */
+uint32_t wind_sensor_wakeups_per_hour(void);
+
 #endif /* _WIND_SENSOR_H_ */
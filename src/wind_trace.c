@@ -0,0 +1,116 @@
+#include <zephyr/kernel.h>
+
+#include "wind_trace.h"
+
+// a pulse in millionths, millionths over a rate in Hz are microseconds
+#define PHASE_ONE 1000000
+
+// the rate ramps from one step to the next, held for a tenth of a second
+// at a time so the edges need no square root
+#define SUBSTEPS 10
+#define SUBSTEP_US (USEC_PER_SEC / SUBSTEPS)
+
+static const struct wind_trace_step recorded[] = {
+#include "wind_trace.inc"
+};
+static uint32_t recorded_pos;
+
+static uint16_t mean_hz;
+static uint32_t lcg_state;
+static uint32_t gust_left; // seconds left in the current gust
+
+static uint32_t from_mhz; // rate at the start of the current second
+static uint32_t to_mhz;	  // and at its end
+static uint16_t direction_mv;
+static uint32_t phase;	 // progress of the pulse in progress, millionths
+static uint32_t time_us; // end of the current second
+
+static uint32_t recorded_step(void)
+{
+	const struct wind_trace_step *row = &recorded[recorded_pos];
+
+	recorded_pos = (recorded_pos + 1) % ARRAY_SIZE(recorded);
+	direction_mv = row->direction_mv;
+	return row->pulses * 1000;
+}
+
+// Numerical Recipes LCG, sys_rand32_get would make runs unrepeatable
+static uint32_t lcg_next(void)
+{
+	lcg_state = lcg_state * 1664525 + 1013904223;
+	return lcg_state >> 8;
+}
+
+static uint32_t synthetic_step(void)
+{
+	uint32_t mhz = mean_hz * 500 + lcg_next() % (mean_hz * 1000 + 1);
+	int32_t mv = direction_mv ? direction_mv : 1200;
+
+	if (gust_left)
+	{
+		--gust_left;
+		mhz += mean_hz * 1000;
+	}
+	else if (lcg_next() % 60 == 0)
+	{
+		gust_left = 2 + lcg_next() % 6;
+	}
+
+	// the vane wanders a few degrees per second, the sensor spans 0 to 1630 mV
+	mv += (int32_t)(lcg_next() % 41) - 20;
+	direction_mv = CLAMP(mv, 0, 1630);
+	return mhz;
+}
+
+void wind_trace_init(uint16_t mean, uint32_t seed)
+{
+	mean_hz = mean;
+	lcg_state = seed;
+	gust_left = 0;
+	recorded_pos = 0;
+	from_mhz = 0;
+	to_mhz = 0;
+	direction_mv = 0;
+	phase = 0;
+	time_us = 0;
+}
+
+uint32_t wind_trace_second(uint32_t *edge_us)
+{
+	uint32_t pulses = 0;
+
+	from_mhz = to_mhz;
+	to_mhz = mean_hz ? synthetic_step() : recorded_step();
+
+	for (int i = 0; i < SUBSTEPS; ++i)
+	{
+		int32_t ramp = ((int32_t)to_mhz - (int32_t)from_mhz) * (2 * i + 1) / (2 * SUBSTEPS);
+		uint32_t mhz = from_mhz + ramp;
+		uint64_t progress = phase + (uint64_t)mhz * SUBSTEP_US / 1000;
+		uint32_t n = progress / PHASE_ONE;
+
+		if (n)
+		{
+			*edge_us = time_us + (((uint64_t)n * PHASE_ONE - phase) * 1000) / mhz;
+		}
+		pulses += n;
+		phase = progress % PHASE_ONE;
+		time_us += SUBSTEP_US;
+	}
+	return pulses;
+}
+
+uint32_t wind_trace_rate(void)
+{
+	return (from_mhz + to_mhz) / 2;
+}
+
+uint32_t wind_trace_time_us(void)
+{
+	return time_us;
+}
+
+uint16_t wind_trace_direction_mv(void)
+{
+	return direction_mv;
+}
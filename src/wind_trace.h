@@ -0,0 +1,52 @@
+#ifndef _WIND_TRACE_H_
+#define _WIND_TRACE_H_
+
+#include <stdint.h>
+
+// Wind trace replayed by the SIM pulse counter backend. One step per second
+// of trace time, the same trace gives the same reports on every run. The
+// anemometer rate ramps from one step to the next and the pulse edges fall
+// where that rate puts them, so a window rarely holds whole pulses.
+//
+// Row of the recorded trace, a synthetic trace makes its rates with
+// millihertz resolution.
+struct wind_trace_step
+{
+	uint16_t pulses;	   // anemometer pulses per second at the end of the step
+	uint16_t direction_mv; // direction vane voltage
+};
+
+/**
+ * @brief Restart the trace at its first step.
+ *
+ * @param mean_hz - mean pulse rate of a synthetic trace, 0 replays the
+ * recorded trace in src/wind_trace.inc.
+ * @param seed - seed of the synthetic trace.
+ */
+void wind_trace_init(uint16_t mean_hz, uint32_t seed);
+
+/**
+ * @brief Advance the trace by one second.
+ *
+ * @param[out] edge_us - trace time of the latest edge in the second, left
+ * as it is if there was none.
+ * @return uint32_t - pulse edges in the second.
+ */
+uint32_t wind_trace_second(uint32_t *edge_us);
+
+/**
+ * @brief Mean pulse rate over the latest second in mHz, the true speed.
+ */
+uint32_t wind_trace_rate(void);
+
+/**
+ * @brief Trace time in microseconds, wraps at 32 bits.
+ */
+uint32_t wind_trace_time_us(void);
+
+/**
+ * @brief Direction vane voltage at the current trace position.
+ */
+uint16_t wind_trace_direction_mv(void);
+
+#endif /* _WIND_TRACE_H_ */
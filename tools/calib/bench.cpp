@@ -0,0 +1,170 @@
+// Calibration engine benchmark.
+//
+//   calib_bench [conversions]
+//
+// Checks every default table over its whole input range against the float
+// formulas the firmware used before the tables, then times the integer
+// conversions and the float formulas in cycles per conversion. A 16 point
+// table shows the cost of the longest search. Host cycles only rank the
+// variants, a Cortex-M33 without FPU context pays more for the float path.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+extern "C"
+{
+#include "calib.h"
+}
+
+namespace
+{
+
+constexpr int INPUTS = 4096; // fits in L1, so the conversion is timed, not memory
+
+// the conversions before the calibration tables, in thousandths
+double ref_speed(double mhz) { return mhz * 1.7; }
+double ref_direction(double mv) { return (mv * 360 / 1630 + 90) * 1000; }
+double ref_temperature(double mv) { return (mv - 2100) * 50 / (1558 - 2100) * 1000; }
+double ref_battery(double mv) { return mv * (4.7 + 10.0) / 10.0 * 1000; }
+
+uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+const char *tick_unit()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return "cycles";
+#else
+	return "ns";
+#endif
+}
+
+template <typename R>
+void check(const char *name, enum calib_id id, uint32_t lo, uint32_t hi, R reference)
+{
+	double max_err = 0;
+	uint32_t worst = lo;
+
+	for (uint32_t in = lo; in <= hi; ++in)
+	{
+		double err = std::fabs(double(calib_convert(id, in)) - reference(double(in)));
+
+		if (err > max_err)
+		{
+			max_err = err;
+			worst = in;
+		}
+	}
+	printf("  %-12s inputs %6u..%-6u max error %.2f at %u\n", name, lo, hi, max_err, worst);
+}
+
+template <typename F>
+double time_per_call(const std::vector<uint32_t> &inputs, long conversions, F convert)
+{
+	volatile int64_t sink = 0;
+	int64_t sum = 0;
+	uint64_t start = ticks();
+
+	for (long n = 0; n < conversions; n += INPUTS)
+	{
+		for (uint32_t in : inputs)
+		{
+			sum += convert(in);
+		}
+	}
+	uint64_t elapsed = ticks() - start;
+	sink = sum;
+	(void)sink;
+	return double(elapsed) / conversions;
+}
+
+std::vector<uint32_t> random_inputs(uint32_t lo, uint32_t hi)
+{
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<uint32_t> dist(lo, hi);
+	std::vector<uint32_t> v(INPUTS);
+
+	std::generate(v.begin(), v.end(), [&]() { return dist(rng); });
+	return v;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	long conversions = argc > 1 ? atol(argv[1]) : 1 << 26;
+
+	if (conversions < INPUTS)
+	{
+		fprintf(stderr, "usage: calib_bench [conversions]\n");
+		return 2;
+	}
+	calib_init();
+
+	printf("accuracy against the float formulas, in thousandths of the unit:\n");
+	check("speed", CALIB_SPEED, 0, 150000, ref_speed);
+	check("direction", CALIB_DIRECTION, 0, 1800, ref_direction);
+	check("temperature", CALIB_TEMPERATURE, 1200, 2400, ref_temperature);
+	check("battery", CALIB_BATTERY, 0, 3000, ref_battery);
+
+	struct
+	{
+		const char *name;
+		uint32_t lo;
+		uint32_t hi;
+		int (*fixed)(uint32_t);
+		int (*reference)(uint32_t);
+	} cases[] = {
+		{"speed", 0, 150000, [](uint32_t in) -> int { return calib_speed_mph(in); },
+		 [](uint32_t in) -> int { return int(float(in) * 0.0017f); }},
+		{"direction", 0, 1630, [](uint32_t in) -> int { return calib_direction(in); },
+		 [](uint32_t in) -> int { return int(std::fmod(float(in) * (360.0f / 1630.0f) + 90.5f, 360.0f)); }},
+		{"temperature", 1200, 2400, [](uint32_t in) -> int { return calib_temperature_c(in); },
+		 [](uint32_t in) -> int { return int(std::lround((float(in) - 2100.0f) * (50.0f / -542.0f))); }},
+		{"battery", 0, 3000, [](uint32_t in) -> int { return calib_battery_mv(in); },
+		 [](uint32_t in) -> int { return int(float(in) * 1.47f + 0.5f); }},
+	};
+
+	printf("%ld conversions each, %s per conversion:\n", conversions, tick_unit());
+	printf("  %-12s %10s %10s\n", "", "fixed", "float");
+	for (const auto &c : cases)
+	{
+		std::vector<uint32_t> inputs = random_inputs(c.lo, c.hi);
+
+		printf("  %-12s %10.2f %10.2f\n", c.name, time_per_call(inputs, conversions, c.fixed),
+			   time_per_call(inputs, conversions, c.reference));
+	}
+
+	// the longest search, a thermistor curve with every point used
+	struct calib_point curve[CALIB_MAX_POINTS];
+	for (int i = 0; i < CALIB_MAX_POINTS; ++i)
+	{
+		int32_t mv = 1200 + i * 80;
+		curve[i] = {mv, int32_t(1000 * 40 * std::tanh((1650 - mv) / 500.0))};
+	}
+	if (calib_set(CALIB_TEMPERATURE, curve, CALIB_MAX_POINTS) != 0)
+	{
+		fprintf(stderr, "16 point table rejected\n");
+		return 1;
+	}
+	std::vector<uint32_t> inputs = random_inputs(1200, 2400);
+	printf("  %-12s %10.2f\n", "16 points", time_per_call(inputs, conversions, [](uint32_t in) -> int {
+			   return calib_temperature_c(in);
+		   }));
+	return 0;
+}
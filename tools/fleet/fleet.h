@@ -0,0 +1,99 @@
+#ifndef _FLEET_FLEET_H_
+#define _FLEET_FLEET_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Shared by the load test and its station processes, see fleet_load.cpp.
+
+constexpr uint32_t FLEET_START = 1577836800; // 2020-01-01, simulated time of the first slot
+constexpr uint32_t FLEET_SLOT_S = 600;
+constexpr uint64_t FLEET_IMEI_BASE = 990000000000000; // station i answers AT+CGSN with base + i
+
+inline int64_t now_us()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(
+			   std::chrono::steady_clock::now().time_since_epoch())
+		.count();
+}
+
+// a delta report is matched to its publish by station and slot time
+inline bool delta_key(const std::string &station, uint32_t time, uint64_t &key)
+{
+	if (station.compare(0, 4, "nrf-") != 0)
+	{
+		return false;
+	}
+	uint64_t imei = strtoull(station.c_str() + 4, nullptr, 10);
+	if (imei < FLEET_IMEI_BASE || imei - FLEET_IMEI_BASE > UINT32_MAX)
+	{
+		return false;
+	}
+	key = ((imei - FLEET_IMEI_BASE) << 32) | time;
+	return true;
+}
+
+// in memory shared with the stations, they report once connected and start
+// publishing when start_us is set
+struct fleet_sync
+{
+	std::atomic<int> connected;
+	std::atomic<int64_t> start_us;
+};
+
+struct station_plan
+{
+	int index;
+	int fleet;
+	int64_t interval_us; // a report cycle
+	int64_t run_us;		 // reports are made for this long after start
+	int64_t drain_us;	 // then the station waits this long at most for its PUBACKs
+	bool burst;			 // every station reports at the same instant
+	fleet_sync *sync;
+	int out_fd; // the station_result goes here at exit
+};
+
+// a delta report as the station handed it to data_publish()
+struct delta_sent
+{
+	uint64_t key;
+	int64_t sent_us;
+};
+
+// written by a station when it exits, followed by puback_count latencies
+// in microseconds and delta_count delta_sent
+struct station_result
+{
+	uint64_t published; // QoS 1 reports sent, not counting retransmits
+	uint64_t acked;
+	uint64_t retransmits;
+	uint64_t connects;
+	uint64_t bytes; // topic and payload bytes of every publish
+	uint64_t deltas_sent;
+	uint64_t dropped; // no buffer, or not sent and not stored as there is no flash
+	uint64_t puback_count;
+	uint64_t delta_count;
+};
+
+/**
+ * @brief Run station plan.index in this process, publishing through
+ * mqtt_connection.c. Writes the station_result and exits.
+ */
+[[noreturn]] void station_main(const station_plan &plan);
+
+// what the station's transport saw, kept by mqtt_shim.cpp
+struct mqtt_shim_stats
+{
+	uint64_t published;
+	uint64_t bytes;
+	uint64_t connects;
+	std::vector<int64_t> puback_us; // first send to PUBACK
+};
+
+const mqtt_shim_stats &mqtt_shim_stats_get();
+
+#endif /* _FLEET_FLEET_H_ */
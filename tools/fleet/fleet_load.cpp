@@ -0,0 +1,484 @@
+// Fleet load test, many simulated stations publishing to one broker.
+//
+//   wind_fleet [-h localhost] [-p 1883] [-n 50,100,200,500] [-t 10] [-i 1000] [--burst] [-d dir]
+//
+// Every station is a process of its own running the firmware's
+// mqtt_connection.c over the Zephyr MQTT API of mqtt_shim.cpp, with its
+// message pool, in-flight window (FLEET_INFLIGHT_WINDOW at configure time),
+// PUBACK timeouts, retransmits and reconnects, see station.cpp. Each
+// publishes like the firmware: a QoS 1 delta report per slot, the retained
+// QoS 0 day summary after it and a retained QoS 1 health report every sixth
+// slot, with payloads and topics from src/payload.c. One subscriber takes
+// every delta and health report, like the ingest daemon, and with -d feeds
+// them to the ingest store.
+//
+// Fleet sizes are stepped through in turn. A slot lasts -i milliseconds of
+// real time, so a 10 minute cadence is compressed. --burst makes every
+// station report at the same instant, as the end of hour reports do.
+// Large fleets need a higher open file and process limit, ulimit -n -u.
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "fleet.h"
+#include "ingest.h"
+#include "mqtt_lite.h"
+#include "station.h"
+
+namespace
+{
+
+constexpr int64_t DRAIN_US = 5000000;
+constexpr int64_t CONNECT_TIMEOUT_US = 30000000;
+
+struct options
+{
+	std::string host = "localhost";
+	int port = 1883;
+	std::vector<int> fleets = {50, 100, 200, 500};
+	int step_s = 10;
+	int interval_ms = 1000;
+	bool burst = false;
+	std::string store;
+};
+
+struct step_stats
+{
+	uint64_t published; // QoS 1 reports sent
+	uint64_t acked;
+	uint64_t retransmits;
+	uint64_t reconnects;
+	uint64_t bytes; // topic and payload bytes of every publish
+	uint64_t dropped;
+	uint64_t deltas_sent;
+	uint64_t deltas_received;
+	uint64_t duplicates;
+	std::vector<int64_t> puback_us;
+	std::vector<int64_t> e2e_us;
+};
+
+// delta and health reports of every station, as the ingest daemon subscribes
+class subscriber
+{
+public:
+	subscriber(const options &opt, step_stats &stats) : opt_(opt), stats_(stats)
+	{
+		if (!opt.store.empty())
+		{
+			ingest_ = std::make_unique<ingest>(opt.store);
+		}
+	}
+
+	bool connect()
+	{
+		if (!conn_.connect(opt_.host, opt_.port, "fleet-ingest", true))
+		{
+			return false;
+		}
+		conn_.subscribe(CONFIG_MQTT_PRIMARY_TOPIC "/+/wind/delta", 1, 1);
+		conn_.subscribe(CONFIG_MQTT_PRIMARY_TOPIC "/+/health", 1, 2);
+		return conn_.flush();
+	}
+
+	mqtt_lite &conn() { return conn_; }
+
+	// reads what arrived, first arrival of every delta by its key
+	bool read(int64_t now)
+	{
+		std::vector<mqtt_lite::packet> packets;
+		bool ok = conn_.read(packets);
+
+		for (const auto &p : packets)
+		{
+			on_packet(p, now);
+		}
+		return ok && conn_.flush();
+	}
+
+	const std::unordered_map<uint64_t, int64_t> &received() const { return received_; }
+
+	void sync()
+	{
+		if (ingest_)
+		{
+			ingest_->sync();
+		}
+	}
+
+	const ingest *store() const { return ingest_.get(); }
+
+private:
+	void on_packet(const mqtt_lite::packet &p, int64_t now)
+	{
+		parsed_report report;
+
+		if (p.type != mqtt_lite::PUBLISH)
+		{
+			return;
+		}
+		if (p.flags & 0x06)
+		{
+			conn_.puback(p.id);
+		}
+		if (ingest_)
+		{
+			ingest_->handle(p.topic, p.payload.data(), p.payload.size(), uint32_t(time(nullptr)));
+		}
+		if (p.flags & 0x01 || !parse_report(p.topic, p.payload.data(), p.payload.size(), 0, report) ||
+			report.type != parsed_report::WIND || report.wind.empty())
+		{
+			return; // retained health from an earlier step, or not a delta
+		}
+		uint64_t key;
+		if (!delta_key(report.station, report.wind[0].time, key))
+		{
+			return; // a real station on the same broker
+		}
+		if (!received_.emplace(key, now).second)
+		{
+			++stats_.duplicates;
+		}
+	}
+
+	const options &opt_;
+	step_stats &stats_;
+	mqtt_lite conn_;
+	std::unique_ptr<ingest> ingest_;
+	std::unordered_map<uint64_t, int64_t> received_;
+};
+
+double percentile_ms(std::vector<int64_t> &us, double p)
+{
+	if (us.empty())
+	{
+		return 0;
+	}
+	size_t i = std::min(us.size() - 1, size_t(p * us.size()));
+	std::nth_element(us.begin(), us.begin() + i, us.end());
+	return us[i] / 1000.0;
+}
+
+// the output of one station process, read as it comes
+struct station_proc
+{
+	pid_t pid;
+	int fd;
+	std::vector<char> out;
+};
+
+// adds what a station wrote at exit, false if it did not finish
+bool collect(const std::vector<char> &out, step_stats &stats, std::vector<delta_sent> &sent)
+{
+	station_result r;
+
+	if (out.size() < sizeof(r))
+	{
+		return false;
+	}
+	memcpy(&r, out.data(), sizeof(r));
+	size_t latencies = r.puback_count * sizeof(int64_t);
+	if (out.size() != sizeof(r) + latencies + r.delta_count * sizeof(sent[0]))
+	{
+		return false;
+	}
+	const char *p = out.data() + sizeof(r);
+	size_t at = stats.puback_us.size();
+	stats.puback_us.resize(at + r.puback_count);
+	memcpy(stats.puback_us.data() + at, p, latencies);
+	at = sent.size();
+	sent.resize(at + r.delta_count);
+	memcpy(sent.data() + at, p + latencies, r.delta_count * sizeof(sent[0]));
+
+	stats.published += r.published;
+	stats.acked += r.acked;
+	stats.retransmits += r.retransmits;
+	stats.reconnects += r.connects > 0 ? r.connects - 1 : 0;
+	stats.bytes += r.bytes;
+	stats.dropped += r.dropped;
+	stats.deltas_sent += r.deltas_sent;
+	return true;
+}
+
+void stop_stations(std::vector<station_proc> &procs)
+{
+	for (auto &s : procs)
+	{
+		kill(s.pid, SIGKILL);
+		waitpid(s.pid, nullptr, 0);
+		if (s.fd >= 0)
+		{
+			close(s.fd);
+		}
+	}
+}
+
+bool run_step(const options &opt, int fleet)
+{
+	step_stats stats{};
+	std::vector<station_proc> procs;
+	std::vector<struct pollfd> fds;
+	subscriber sub(opt, stats);
+
+	if (!sub.connect())
+	{
+		fprintf(stderr, "Failed to connect to %s:%d\n", opt.host.c_str(), opt.port);
+		return false;
+	}
+
+	void *shared = mmap(nullptr, sizeof(fleet_sync), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (shared == MAP_FAILED)
+	{
+		perror("mmap");
+		return false;
+	}
+	fleet_sync *sync = new (shared) fleet_sync{{0}, {0}};
+	station_plan plan = {0, fleet, int64_t(opt.interval_ms) * 1000, int64_t(opt.step_s) * 1000000, DRAIN_US,
+						 opt.burst, sync, -1};
+
+	fflush(stdout);
+	fflush(stderr);
+	for (int i = 0; i < fleet; ++i)
+	{
+		int pipe_fd[2];
+		pid_t pid;
+
+		if (pipe(pipe_fd) != 0 || (pid = fork()) < 0)
+		{
+			perror("Failed to start a station, check ulimit -u");
+			stop_stations(procs);
+			return false;
+		}
+		if (pid == 0)
+		{
+			close(pipe_fd[0]);
+			close(sub.conn().fd());
+			for (const auto &s : procs)
+			{
+				close(s.fd);
+			}
+			plan.index = i;
+			plan.out_fd = pipe_fd[1];
+			station_main(plan);
+		}
+		close(pipe_fd[1]);
+		procs.push_back({pid, pipe_fd[0], {}});
+	}
+
+	// the clock starts once every station is connected
+	int64_t deadline = now_us() + CONNECT_TIMEOUT_US;
+	while (sync->connected < fleet)
+	{
+		struct pollfd pfd = {sub.conn().fd(), POLLIN, 0};
+
+		if (now_us() > deadline)
+		{
+			fprintf(stderr, "%d of %d stations connected, check ulimit -n\n", sync->connected.load(), fleet);
+			stop_stations(procs);
+			return false;
+		}
+		if (poll(&pfd, 1, 10) > 0 && !sub.read(now_us()))
+		{
+			fprintf(stderr, "Subscriber lost the broker\n");
+			stop_stations(procs);
+			return false;
+		}
+	}
+	int64_t start = now_us();
+	int64_t stop = start + plan.run_us;
+	sync->start_us = start;
+
+	// stations exit once drained, the subscriber waits for their deltas
+	std::vector<delta_sent> sent;
+	int running = fleet;
+	bool complete = true;
+	for (;;)
+	{
+		int64_t now = now_us();
+
+		if (running == 0)
+		{
+			bool all = std::all_of(sent.begin(), sent.end(), [&](const delta_sent &d) { return sub.received().count(d.key) != 0; });
+			if (all || now >= stop + DRAIN_US)
+			{
+				break;
+			}
+		}
+		else if (now >= stop + 2 * DRAIN_US)
+		{
+			fprintf(stderr, "%d stations did not finish\n", running);
+			complete = false;
+			break;
+		}
+
+		fds.assign(1, {sub.conn().fd(), short(POLLIN | (sub.conn().want_write() ? POLLOUT : 0)), 0});
+		for (const auto &s : procs)
+		{
+			fds.push_back({s.fd, short(s.fd >= 0 ? POLLIN : 0), 0});
+		}
+		poll(fds.data(), fds.size(), 100);
+		now = now_us();
+		if ((fds[0].revents & (POLLIN | POLLOUT | POLLERR | POLLHUP)) && !sub.read(now))
+		{
+			fprintf(stderr, "Subscriber lost the broker\n");
+			stop_stations(procs);
+			return false;
+		}
+		for (size_t i = 0; i < procs.size(); ++i)
+		{
+			station_proc &s = procs[i];
+			char buf[65536];
+
+			if (s.fd < 0 || !(fds[i + 1].revents & (POLLIN | POLLERR | POLLHUP)))
+			{
+				continue;
+			}
+			ssize_t n = read(s.fd, buf, sizeof(buf));
+			if (n > 0)
+			{
+				s.out.insert(s.out.end(), buf, buf + n);
+				continue;
+			}
+			if (n < 0 && errno == EINTR)
+			{
+				continue;
+			}
+			close(s.fd);
+			s.fd = -1;
+			--running;
+			waitpid(s.pid, nullptr, 0);
+			if (!collect(s.out, stats, sent))
+			{
+				fprintf(stderr, "Station %zu failed\n", i);
+				complete = false;
+			}
+		}
+	}
+	if (running > 0)
+	{
+		stop_stations(procs);
+	}
+	munmap(shared, sizeof(fleet_sync));
+	sub.sync();
+
+	for (const auto &d : sent)
+	{
+		auto it = sub.received().find(d.key);
+
+		if (it != sub.received().end())
+		{
+			stats.e2e_us.push_back(it->second - d.sent_us);
+			++stats.deltas_received;
+		}
+	}
+
+	double seconds = opt.step_s;
+	printf("%5d stations %7.0f msg/s %7.1f kB/s  acked %llu/%llu retx %llu reconn %llu dropped %llu  "
+		   "puback p50 %6.2f p99 %7.2f p999 %7.2f ms  e2e p50 %6.2f p99 %7.2f p999 %7.2f ms  "
+		   "delivered %llu/%llu dup %llu\n",
+		   fleet, stats.published / seconds, stats.bytes / seconds / 1024, (unsigned long long)stats.acked,
+		   (unsigned long long)stats.published, (unsigned long long)stats.retransmits,
+		   (unsigned long long)stats.reconnects, (unsigned long long)stats.dropped, percentile_ms(stats.puback_us, 0.5),
+		   percentile_ms(stats.puback_us, 0.99), percentile_ms(stats.puback_us, 0.999), percentile_ms(stats.e2e_us, 0.5),
+		   percentile_ms(stats.e2e_us, 0.99), percentile_ms(stats.e2e_us, 0.999),
+		   (unsigned long long)stats.deltas_received, (unsigned long long)stats.deltas_sent,
+		   (unsigned long long)stats.duplicates);
+	if (sub.store())
+	{
+		const ingest::stats &c = sub.store()->counters();
+		printf("      ingest: %llu messages, %llu samples, %llu health, %llu malformed\n",
+			   (unsigned long long)c.messages, (unsigned long long)c.samples, (unsigned long long)c.health,
+			   (unsigned long long)c.malformed);
+	}
+	fflush(stdout);
+	return complete;
+}
+
+std::vector<int> parse_list(const char *s)
+{
+	std::vector<int> out;
+
+	while (*s)
+	{
+		char *end;
+		long v = strtol(s, &end, 10);
+
+		if (end == s || v <= 0)
+		{
+			return {};
+		}
+		out.push_back(int(v));
+		s = *end == ',' ? end + 1 : end;
+	}
+	return out;
+}
+
+void usage()
+{
+	fprintf(stderr, "usage: wind_fleet [-h host] [-p port] [-n sizes,...] [-t step s] [-i slot ms] [--burst] [-d dir]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	options opt;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string a = argv[i];
+		bool has_value = i + 1 < argc;
+
+		if (a == "-h" && has_value)
+			opt.host = argv[++i];
+		else if (a == "-p" && has_value)
+			opt.port = atoi(argv[++i]);
+		else if (a == "-n" && has_value)
+			opt.fleets = parse_list(argv[++i]);
+		else if (a == "-t" && has_value)
+			opt.step_s = atoi(argv[++i]);
+		else if (a == "-i" && has_value)
+			opt.interval_ms = atoi(argv[++i]);
+		else if (a == "-d" && has_value)
+			opt.store = argv[++i];
+		else if (a == "--burst")
+			opt.burst = true;
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+	if (opt.fleets.empty() || opt.step_s < 1 || opt.interval_ms < 1)
+	{
+		usage();
+		return 2;
+	}
+
+	printf("%s:%d, %d s per step, a slot every %d ms, window %d%s\n", opt.host.c_str(), opt.port, opt.step_s,
+		   opt.interval_ms, CONFIG_MQTT_INFLIGHT_WINDOW, opt.burst ? ", burst" : "");
+	fleet_broker_host = opt.host.c_str();
+	fleet_broker_port = opt.port;
+	for (int fleet : opt.fleets)
+	{
+		if (!run_step(opt, fleet))
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,274 @@
+#include "mqtt_lite.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+namespace
+{
+
+constexpr int CONNACK_TIMEOUT_MS = 5000;
+
+} // namespace
+
+bool mqtt_lite::connect(const std::string &host, int port, const std::string &client_id, bool clean_session,
+						uint16_t keepalive_s, bool *session_present)
+{
+	struct addrinfo hints = {};
+	struct addrinfo *result;
+	std::string service = std::to_string(port);
+
+	close();
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host.c_str(), service.c_str(), &hints, &result) != 0)
+	{
+		return false;
+	}
+	for (struct addrinfo *a = result; a != nullptr && fd_ < 0; a = a->ai_next)
+	{
+		fd_ = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+		if (fd_ >= 0 && ::connect(fd_, a->ai_addr, a->ai_addrlen) != 0)
+		{
+			::close(fd_);
+			fd_ = -1;
+		}
+	}
+	freeaddrinfo(result);
+	if (fd_ < 0)
+	{
+		return false;
+	}
+	int one = 1;
+	setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+
+	put_header(CONNECT << 4, 10 + 2 + client_id.size());
+	put_string("MQTT");
+	tx_.push_back(4); // 3.1.1
+	tx_.push_back(clean_session ? 0x02 : 0x00);
+	put_u16(keepalive_s);
+	put_string(client_id);
+
+	std::vector<packet> in;
+	struct pollfd pfd = {fd_, 0, 0};
+	while (in.empty())
+	{
+		pfd.events = POLLIN | (want_write() ? POLLOUT : 0);
+		if (poll(&pfd, 1, CONNACK_TIMEOUT_MS) <= 0 || !flush() || !read(in))
+		{
+			close();
+			return false;
+		}
+	}
+	if (in[0].type != CONNACK || in[0].payload.size() != 2 || in[0].payload[1] != 0)
+	{
+		close();
+		return false;
+	}
+	if (session_present)
+	{
+		*session_present = in[0].payload[0] & 0x01;
+	}
+	return true;
+}
+
+void mqtt_lite::publish(const std::string &topic, const uint8_t *payload, size_t len, uint8_t qos, bool retain,
+						uint16_t id, bool dup)
+{
+	put_header((PUBLISH << 4) | (dup ? 0x08 : 0) | (qos << 1) | (retain ? 1 : 0),
+			   2 + topic.size() + (qos > 0 ? 2 : 0) + len);
+	put_string(topic);
+	if (qos > 0)
+	{
+		put_u16(id);
+	}
+	tx_.insert(tx_.end(), payload, payload + len);
+}
+
+void mqtt_lite::subscribe(const std::string &filter, uint8_t qos, uint16_t id)
+{
+	put_header((SUBSCRIBE << 4) | 0x02, 2 + 2 + filter.size() + 1);
+	put_u16(id);
+	put_string(filter);
+	tx_.push_back(qos);
+}
+
+void mqtt_lite::puback(uint16_t id)
+{
+	put_header(PUBACK << 4, 2);
+	put_u16(id);
+}
+
+void mqtt_lite::ping()
+{
+	put_header(PINGREQ << 4, 0);
+}
+
+// queued packets go first, as far as the socket takes them
+void mqtt_lite::disconnect()
+{
+	put_header(DISCONNECT << 4, 0);
+	flush();
+	close();
+}
+
+bool mqtt_lite::flush()
+{
+	while (tx_pos_ < tx_.size())
+	{
+		ssize_t n = send(fd_, tx_.data() + tx_pos_, tx_.size() - tx_pos_, MSG_NOSIGNAL);
+
+		if (n < 0)
+		{
+			return errno == EAGAIN || errno == EWOULDBLOCK;
+		}
+		tx_pos_ += n;
+	}
+	tx_.clear();
+	tx_pos_ = 0;
+	return true;
+}
+
+bool mqtt_lite::read(std::vector<packet> &out)
+{
+	uint8_t buf[16384];
+
+	for (;;)
+	{
+		ssize_t n = recv(fd_, buf, sizeof(buf), 0);
+
+		if (n == 0)
+		{
+			return false;
+		}
+		if (n < 0)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+			{
+				return false;
+			}
+			break;
+		}
+		rx_.insert(rx_.end(), buf, buf + n);
+	}
+	return parse(out);
+}
+
+void mqtt_lite::close()
+{
+	if (fd_ >= 0)
+	{
+		::close(fd_);
+		fd_ = -1;
+	}
+	tx_.clear();
+	tx_pos_ = 0;
+	rx_.clear();
+}
+
+void mqtt_lite::put_header(uint8_t first, size_t remaining)
+{
+	tx_.push_back(first);
+	do
+	{
+		uint8_t b = remaining % 128;
+
+		remaining /= 128;
+		tx_.push_back(remaining > 0 ? b | 0x80 : b);
+	} while (remaining > 0);
+}
+
+void mqtt_lite::put_u16(uint16_t v)
+{
+	tx_.push_back(v >> 8);
+	tx_.push_back(v & 0xff);
+}
+
+void mqtt_lite::put_string(const std::string &s)
+{
+	put_u16(s.size());
+	tx_.insert(tx_.end(), s.begin(), s.end());
+}
+
+bool mqtt_lite::parse(std::vector<packet> &out)
+{
+	size_t pos = 0;
+
+	while (pos + 2 <= rx_.size())
+	{
+		size_t remaining = 0;
+		size_t head = 1;
+		int shift = 0;
+
+		do
+		{
+			if (pos + head >= rx_.size())
+			{
+				goto incomplete;
+			}
+			if (head > 4)
+			{
+				return false;
+			}
+			remaining |= size_t(rx_[pos + head] & 0x7f) << shift;
+			shift += 7;
+		} while (rx_[pos + head++] & 0x80);
+		if (pos + head + remaining > rx_.size())
+		{
+			break;
+		}
+
+		const uint8_t *p = rx_.data() + pos + head;
+		packet pkt = {uint8_t(rx_[pos] >> 4), uint8_t(rx_[pos] & 0x0f), 0, {}, {}};
+
+		switch (pkt.type)
+		{
+		case PUBLISH:
+		{
+			size_t topic_len = remaining >= 2 ? (p[0] << 8) | p[1] : 0;
+			size_t at = 2 + topic_len;
+
+			if (remaining < at)
+			{
+				return false;
+			}
+			pkt.topic.assign(reinterpret_cast<const char *>(p + 2), topic_len);
+			if (pkt.flags & 0x06)
+			{
+				if (remaining < at + 2)
+				{
+					return false;
+				}
+				pkt.id = (p[at] << 8) | p[at + 1];
+				at += 2;
+			}
+			pkt.payload.assign(p + at, p + remaining);
+			break;
+		}
+		case PUBACK:
+		case SUBACK:
+			if (remaining < 2)
+			{
+				return false;
+			}
+			pkt.id = (p[0] << 8) | p[1];
+			break;
+		default:
+			pkt.payload.assign(p, p + remaining);
+			break;
+		}
+		out.push_back(std::move(pkt));
+		pos += head + remaining;
+	}
+incomplete:
+	rx_.erase(rx_.begin(), rx_.begin() + pos);
+	return true;
+}
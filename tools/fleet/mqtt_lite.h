@@ -0,0 +1,93 @@
+#ifndef _MQTT_LITE_H_
+#define _MQTT_LITE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Minimal MQTT 3.1.1 client for the fleet load test, just enough of the
+// protocol for what a station does: CONNECT, PUBLISH at QoS 0 and 1,
+// PUBACK, SUBSCRIBE, PINGREQ and DISCONNECT. Non-blocking once connected.
+// The stations drive it through the Zephyr MQTT API of mqtt_shim.cpp, the
+// subscriber directly.
+
+class mqtt_lite
+{
+public:
+	enum packet_type : uint8_t
+	{
+		CONNECT = 1,
+		CONNACK = 2,
+		PUBLISH = 3,
+		PUBACK = 4,
+		SUBSCRIBE = 8,
+		SUBACK = 9,
+		PINGREQ = 12,
+		PINGRESP = 13,
+		DISCONNECT = 14,
+	};
+
+	struct packet
+	{
+		uint8_t type;
+		uint8_t flags;
+		uint16_t id; // PUBACK, SUBACK and QoS 1 PUBLISH
+		std::string topic;
+		std::vector<uint8_t> payload;
+	};
+
+	mqtt_lite() = default;
+	mqtt_lite(const mqtt_lite &) = delete;
+	mqtt_lite &operator=(const mqtt_lite &) = delete;
+	~mqtt_lite() { close(); }
+
+	/**
+	 * @brief Connect and wait for the CONNACK, the socket is non-blocking after.
+	 *
+	 * @param keepalive_s - the keep alive of the CONNECT, 0 is off.
+	 * @param session_present - set from the CONNACK if not NULL.
+	 * @return bool - false if the broker can not be reached or refuses.
+	 */
+	bool connect(const std::string &host, int port, const std::string &client_id, bool clean_session,
+				 uint16_t keepalive_s = 0, bool *session_present = nullptr);
+
+	void publish(const std::string &topic, const uint8_t *payload, size_t len, uint8_t qos, bool retain,
+				 uint16_t id, bool dup);
+	void subscribe(const std::string &filter, uint8_t qos, uint16_t id);
+	void puback(uint16_t id);
+	void ping();
+	void disconnect();
+
+	/**
+	 * @brief Send what the socket takes of the queued packets.
+	 *
+	 * @return bool - false if the connection is lost.
+	 */
+	bool flush();
+
+	/**
+	 * @brief Read what arrived and append the complete packets to out.
+	 *
+	 * @return bool - false if the connection is lost.
+	 */
+	bool read(std::vector<packet> &out);
+
+	void close();
+
+	int fd() const { return fd_; }
+	bool want_write() const { return tx_.size() > tx_pos_; }
+
+private:
+	void put_header(uint8_t first, size_t remaining);
+	void put_u16(uint16_t v);
+	void put_string(const std::string &s);
+	bool parse(std::vector<packet> &out);
+
+	int fd_ = -1;
+	std::vector<uint8_t> tx_;
+	size_t tx_pos_ = 0;
+	std::vector<uint8_t> rx_;
+};
+
+#endif /* _MQTT_LITE_H_ */
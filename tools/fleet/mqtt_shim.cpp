@@ -0,0 +1,277 @@
+// The Zephyr MQTT client API of tools/shim/zephyr/net/mqtt.h over mqtt_lite,
+// so a station process runs mqtt_connection.c unchanged. One client per
+// process. The calls block like Zephyr's on a blocking socket, except that
+// the CONNACK is delivered from mqtt_connect() itself. Also keeps what the
+// transport saw for the load test.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <unordered_map>
+
+#include "fleet.h"
+#include "mqtt_lite.h"
+
+extern "C"
+{
+#include <zephyr/kernel.h>
+#include <zephyr/net/mqtt.h>
+}
+
+namespace
+{
+
+constexpr int SEND_TIMEOUT_MS = 10000;
+
+mqtt_lite conn;
+std::deque<mqtt_lite::packet> received; // read, not yet dispatched
+mqtt_lite::packet current;				 // the PUBLISH the event handler reads
+size_t current_pos;
+int64_t last_tx_us;
+std::unordered_map<uint16_t, int64_t> first_sent; // QoS 1 message ID to first send
+mqtt_shim_stats stats;
+
+void notify(struct mqtt_client *client, enum mqtt_evt_type type, int result)
+{
+	struct mqtt_evt evt = {};
+
+	evt.type = type;
+	evt.result = result;
+	client->evt_cb(client, &evt);
+}
+
+// sends everything queued, waiting for the socket as Zephyr's send() would
+int send_all()
+{
+	struct pollfd pfd = {conn.fd(), POLLOUT, 0};
+
+	while (conn.want_write())
+	{
+		if (!conn.flush())
+		{
+			return -ENOTCONN;
+		}
+		if (conn.want_write() && poll(&pfd, 1, SEND_TIMEOUT_MS) <= 0)
+		{
+			return -EAGAIN;
+		}
+	}
+	last_tx_us = now_us();
+	return 0;
+}
+
+std::string utf8(const struct mqtt_utf8 &s)
+{
+	return std::string(reinterpret_cast<const char *>(s.utf8), s.size);
+}
+
+} // namespace
+
+const mqtt_shim_stats &mqtt_shim_stats_get()
+{
+	return stats;
+}
+
+extern "C"
+{
+
+void mqtt_client_init(struct mqtt_client *client)
+{
+	memset(client, 0, sizeof(*client));
+	client->protocol_version = MQTT_VERSION_3_1_1;
+	client->clean_session = IS_ENABLED(CONFIG_MQTT_CLEAN_SESSION);
+	client->keepalive = CONFIG_MQTT_KEEPALIVE;
+}
+
+int mqtt_connect(struct mqtt_client *client)
+{
+	const struct sockaddr_in *broker = static_cast<const struct sockaddr_in *>(client->broker);
+	char host[INET_ADDRSTRLEN];
+	bool session_present = false;
+
+	inet_ntop(AF_INET, &broker->sin_addr, host, sizeof(host));
+	if (!conn.connect(host, ntohs(broker->sin_port), utf8(client->client_id), client->clean_session,
+					  client->keepalive, &session_present))
+	{
+		return -ECONNREFUSED;
+	}
+	++stats.connects;
+	client->transport.tcp.sock = conn.fd();
+	last_tx_us = now_us();
+	received.clear();
+
+	struct mqtt_evt evt = {};
+	evt.type = MQTT_EVT_CONNACK;
+	evt.param.connack.session_present_flag = session_present;
+	client->evt_cb(client, &evt);
+	return 0;
+}
+
+int mqtt_disconnect(struct mqtt_client *client)
+{
+	if (conn.fd() < 0)
+	{
+		return -ENOTCONN;
+	}
+	conn.disconnect();
+	notify(client, MQTT_EVT_DISCONNECT, 0);
+	return 0;
+}
+
+int mqtt_publish(struct mqtt_client *client, const struct mqtt_publish_param *param)
+{
+	const struct mqtt_publish_message &m = param->message;
+
+	(void)client;
+	if (conn.fd() < 0)
+	{
+		return -ENOTCONN;
+	}
+	if (m.topic.qos != MQTT_QOS_0_AT_MOST_ONCE && first_sent.emplace(param->message_id, now_us()).second)
+	{
+		++stats.published;
+	}
+	stats.bytes += m.topic.topic.size + m.payload.len;
+	conn.publish(utf8(m.topic.topic), m.payload.data, m.payload.len, m.topic.qos, param->retain_flag,
+				 param->message_id, param->dup_flag);
+	return send_all();
+}
+
+int mqtt_publish_qos1_ack(struct mqtt_client *client, const struct mqtt_puback_param *param)
+{
+	(void)client;
+	if (conn.fd() < 0)
+	{
+		return -ENOTCONN;
+	}
+	conn.puback(param->message_id);
+	return send_all();
+}
+
+int mqtt_subscribe(struct mqtt_client *client, const struct mqtt_subscription_list *param)
+{
+	(void)client;
+	if (conn.fd() < 0)
+	{
+		return -ENOTCONN;
+	}
+	for (uint16_t i = 0; i < param->list_count; ++i)
+	{
+		conn.subscribe(utf8(param->list[i].topic), param->list[i].qos, param->message_id);
+	}
+	return send_all();
+}
+
+int mqtt_input(struct mqtt_client *client)
+{
+	std::vector<mqtt_lite::packet> in;
+
+	if (conn.fd() < 0)
+	{
+		return -ENOTCONN;
+	}
+	if (!conn.read(in))
+	{
+		conn.close();
+		notify(client, MQTT_EVT_DISCONNECT, -ENOTCONN);
+		return -ENOTCONN;
+	}
+	received.insert(received.end(), std::make_move_iterator(in.begin()), std::make_move_iterator(in.end()));
+	// the handler may disconnect, what is left is dropped with the connection
+	while (!received.empty() && conn.fd() >= 0)
+	{
+		mqtt_lite::packet p = std::move(received.front());
+		struct mqtt_evt evt = {};
+
+		received.pop_front();
+		switch (p.type)
+		{
+		case mqtt_lite::PUBLISH:
+			current = std::move(p);
+			current_pos = 0;
+			evt.type = MQTT_EVT_PUBLISH;
+			evt.param.publish.message.topic.topic.utf8 = reinterpret_cast<const uint8_t *>(current.topic.data());
+			evt.param.publish.message.topic.topic.size = current.topic.size();
+			evt.param.publish.message.topic.qos = (current.flags >> 1) & 0x03;
+			evt.param.publish.message.payload.len = current.payload.size();
+			evt.param.publish.message_id = current.id;
+			evt.param.publish.dup_flag = (current.flags & 0x08) != 0;
+			evt.param.publish.retain_flag = current.flags & 0x01;
+			break;
+		case mqtt_lite::PUBACK:
+		{
+			auto it = first_sent.find(p.id);
+
+			if (it != first_sent.end())
+			{
+				stats.puback_us.push_back(now_us() - it->second);
+				first_sent.erase(it);
+			}
+			evt.type = MQTT_EVT_PUBACK;
+			evt.param.puback.message_id = p.id;
+			break;
+		}
+		case mqtt_lite::SUBACK:
+			evt.type = MQTT_EVT_SUBACK;
+			evt.param.suback.message_id = p.id;
+			break;
+		case mqtt_lite::PINGRESP:
+			evt.type = MQTT_EVT_PINGRESP;
+			break;
+		default:
+			continue;
+		}
+		client->evt_cb(client, &evt);
+	}
+	return 0;
+}
+
+int mqtt_live(struct mqtt_client *client)
+{
+	if (conn.fd() < 0)
+	{
+		return -ENOTCONN;
+	}
+	if (client->keepalive == 0 || now_us() - last_tx_us < int64_t(client->keepalive) * 1000000)
+	{
+		return -EAGAIN;
+	}
+	conn.ping();
+	return send_all();
+}
+
+int mqtt_keepalive_time_left(const struct mqtt_client *client)
+{
+	if (client->keepalive == 0)
+	{
+		return INT32_MAX;
+	}
+	int64_t left = last_tx_us + int64_t(client->keepalive) * 1000000 - now_us();
+	return int(std::max<int64_t>(0, left / 1000));
+}
+
+int mqtt_read_publish_payload_blocking(struct mqtt_client *client, void *buffer, size_t length)
+{
+	size_t n = std::min(length, current.payload.size() - current_pos);
+
+	(void)client;
+	memcpy(buffer, current.payload.data() + current_pos, n);
+	current_pos += n;
+	return int(n);
+}
+
+int mqtt_readall_publish_payload(struct mqtt_client *client, uint8_t *buffer, size_t length)
+{
+	if (length > current.payload.size() - current_pos)
+	{
+		return -EIO;
+	}
+	return mqtt_read_publish_payload_blocking(client, buffer, length) == int(length) ? 0 : -EIO;
+}
+
+} // extern "C"
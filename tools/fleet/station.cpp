@@ -0,0 +1,335 @@
+// A station of the fleet load test, in a process of its own. The firmware's
+// mqtt_connection.c owns the connection: its message pool and queue, the
+// in-flight window, PUBACK timeouts, retransmits and reconnects. Around it
+// the station makes reports like wind_sensor.c and health.c do, from the
+// waits of the MQTT thread, see station_poll(). There is no flash, a report
+// that would go to the report store is dropped.
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "fleet.h"
+#include "station.h"
+
+extern "C"
+{
+#include "activity.h"
+#include "commands.h"
+#include "mqtt_connection.h"
+#include "mqtt_tls.h"
+#include "payload.h"
+#include "report_store.h"
+}
+
+namespace
+{
+
+constexpr int HEALTH_EVERY = 6;
+constexpr int64_t WAIT_US = 10000; // for the start and the PUBACKs after the run
+
+const station_plan *plan;
+std::mt19937 rng;
+bool announced; // counted in fleet_sync::connected
+int64_t next_report_us;
+int64_t stop_us;
+uint32_t slot;
+int speed;
+int direction;
+uint8_t rows[WIND_DAY_SIZE];
+uint64_t deltas_sent;
+uint64_t dropped;
+std::vector<delta_sent> delta_times;
+
+void write_all(int fd, const void *data, size_t len)
+{
+	const char *p = static_cast<const char *>(data);
+
+	while (len > 0)
+	{
+		ssize_t n = write(fd, p, len);
+
+		if (n < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (n <= 0)
+		{
+			return;
+		}
+		p += n;
+		len -= n;
+	}
+}
+
+[[noreturn]] void finish()
+{
+	const mqtt_shim_stats &t = mqtt_shim_stats_get();
+	struct mqtt_delivery_stats delivery;
+	station_result r = {};
+
+	mqtt_delivery_stats_get(&delivery);
+	r.published = t.published;
+	r.acked = delivery.acked;
+	r.retransmits = delivery.retransmits;
+	r.connects = t.connects;
+	r.bytes = t.bytes;
+	r.deltas_sent = deltas_sent;
+	r.dropped = dropped;
+	r.puback_count = t.puback_us.size();
+	r.delta_count = delta_times.size();
+	write_all(plan->out_fd, &r, sizeof(r));
+	write_all(plan->out_fd, t.puback_us.data(), t.puback_us.size() * sizeof(int64_t));
+	write_all(plan->out_fd, delta_times.data(), delta_times.size() * sizeof(delta_times[0]));
+	close(plan->out_fd);
+	_exit(0);
+}
+
+template <typename F>
+void publish(uint8_t qos, bool retain, const char *sub, F encode)
+{
+	struct mqtt_msg *msg = mqtt_msg_alloc(K_NO_WAIT);
+
+	if (msg == NULL)
+	{
+		++dropped;
+		return;
+	}
+	int len = encode(msg->payload, sizeof(msg->payload));
+	if (len < 0 || payload_topic(msg->topic, sizeof(msg->topic), mqtt_station_id(), "%s", sub) < 0)
+	{
+		fprintf(stderr, "%s: failed to encode %s, %d\n", mqtt_station_id(), sub, len);
+		mqtt_msg_free(msg);
+		return;
+	}
+	msg->len = len;
+	msg->qos = qos;
+	msg->retain = retain;
+	if (data_publish(msg) != 0)
+	{
+		++dropped;
+	}
+}
+
+// one report cycle of the firmware: delta, day summary, every sixth slot health
+void report()
+{
+	const char *id = mqtt_station_id();
+	struct w_sensor wind;
+	uint32_t time = FLEET_START + slot * FLEET_SLOT_S;
+	int index = (time % 3600) / FLEET_SLOT_S;
+
+	speed = std::clamp(speed + int(rng() % 5) - 2, 1, 40);
+	direction = (direction + int(rng() % 21) - 10 + 360) % 360;
+	wind = {uint8_t(speed), uint8_t(speed + 4), uint8_t(speed / 2), uint16_t(direction)};
+
+	uint64_t key;
+	if (delta_key(id, time, key))
+	{
+		delta_times.push_back({key, now_us()});
+		++deltas_sent;
+	}
+	publish(MQTT_QOS_1_AT_LEAST_ONCE, false, "wind/delta",
+			[&](uint8_t *buf, size_t size) { return payload_wind_slot(buf, size, id, time, index, &wind); });
+
+	uint8_t *row = rows + (slot % (sizeof(rows) / WIND_DAY_ROW_SIZE)) * WIND_DAY_ROW_SIZE;
+	row[0] = wind.speed;
+	row[1] = (wind.direction + 1) / 2;
+	row[2] = wind.gust;
+	row[3] = wind.lull;
+	publish(MQTT_QOS_0_AT_MOST_ONCE, true, "wind/day",
+			[&](uint8_t *buf, size_t size) { return payload_wind_day(buf, size, id, time, rows); });
+
+	if (slot % HEALTH_EVERY == HEALTH_EVERY - 1)
+	{
+		struct battery_status bat = {3900, 14, 65, 0, 900};
+		struct activity_delta act = {};
+
+		publish(MQTT_QOS_1_AT_LEAST_ONCE, true, "health",
+				[&](uint8_t *buf, size_t size) { return payload_health(buf, size, id, &bat, &act); });
+	}
+	++slot;
+}
+
+// makes the reports that are due, exits once the run is over and the
+// window drained
+void run_due()
+{
+	int64_t now = now_us();
+
+	if (!announced && mqtt_shim_stats_get().connects > 0)
+	{
+		announced = true;
+		++plan->sync->connected;
+	}
+	int64_t start = plan->sync->start_us;
+	if (start == 0)
+	{
+		return;
+	}
+	if (stop_us == 0)
+	{
+		stop_us = start + plan->run_us;
+		next_report_us = start + (plan->burst ? 0 : plan->interval_us * plan->index / plan->fleet);
+	}
+	while (now < stop_us && now >= next_report_us)
+	{
+		report();
+		next_report_us += plan->interval_us;
+	}
+	if (now >= stop_us && (mqtt_msg_free_count() == CONFIG_MQTT_MSG_POOL_SIZE || now >= stop_us + plan->drain_us))
+	{
+		finish();
+	}
+}
+
+// uptime the station has something to do next
+int64_t next_due_us()
+{
+	int64_t now = now_us();
+
+	if (stop_us == 0 || now >= stop_us)
+	{
+		return now + WAIT_US;
+	}
+	return std::min(next_report_us, stop_us);
+}
+
+} // namespace
+
+const char *fleet_broker_host;
+int fleet_broker_port;
+
+void station_main(const station_plan &p)
+{
+	plan = &p;
+	rng.seed(p.index + 1);
+	speed = 4 + rng() % 10;
+	direction = rng() % 360;
+
+	int err;
+	while ((err = client_init()) != 0)
+	{
+		fprintf(stderr, "Station %d: client_init failed, %d\n", p.index, err);
+		sleep(1);
+	}
+	mqtt_idleloop();
+	_exit(1);
+}
+
+extern "C"
+{
+
+int station_poll(struct pollfd *fds, nfds_t nfds, int timeout)
+{
+	int64_t end = timeout < 0 ? INT64_MAX : now_us() + int64_t(timeout) * 1000;
+
+	for (;;)
+	{
+		run_due();
+
+		int64_t now = now_us();
+		int64_t wait = std::max<int64_t>(0, std::min(end, next_due_us()) - now);
+		int n = poll(fds, nfds, int((wait + 999) / 1000));
+
+		if (n != 0 || now_us() >= end)
+		{
+			return n;
+		}
+	}
+}
+
+void station_wait(int64_t until_ms)
+{
+	uint64_t before = slot;
+
+	run_due();
+	if (slot != before)
+	{
+		return;
+	}
+	int64_t wait = std::min(until_ms * 1000, next_due_us()) - now_us();
+	if (wait > 0)
+	{
+		usleep(useconds_t(wait));
+	}
+}
+
+int nrf_modem_at_cmd(void *buf, size_t len, const char *fmt, ...)
+{
+	if (strcmp(fmt, "AT+CGSN") != 0)
+	{
+		return -EINVAL;
+	}
+	snprintf(static_cast<char *>(buf), len, "%015llu\r\nOK\r\n",
+			 static_cast<unsigned long long>(FLEET_IMEI_BASE + plan->index));
+	return 0;
+}
+
+// nothing else of the station runs here
+
+void activity_add(enum activity_id id, uint32_t n)
+{
+	(void)id;
+	(void)n;
+}
+
+int command_handle(const uint8_t *buf, size_t len)
+{
+	(void)buf;
+	(void)len;
+	return 0;
+}
+
+void mqtt_tls_connect_start(void)
+{
+}
+
+void mqtt_tls_connect_done(bool ok)
+{
+	(void)ok;
+}
+
+int report_store_put(const uint8_t *topic, const uint8_t *payload, size_t len, uint8_t qos, uint8_t retain)
+{
+	(void)topic;
+	(void)payload;
+	(void)len;
+	(void)qos;
+	(void)retain;
+	++dropped;
+	return -ENOSPC;
+}
+
+void report_store_drain_start(void)
+{
+}
+
+void report_store_drain_stop(void)
+{
+}
+
+void report_store_drain_kick(void)
+{
+}
+
+void report_store_ack(uint32_t seq)
+{
+	(void)seq;
+}
+
+void report_store_rewind(void)
+{
+}
+
+uint32_t report_store_count(void)
+{
+	return 0;
+}
+
+} // extern "C"
@@ -0,0 +1,41 @@
+#ifndef _FLEET_STATION_H_
+#define _FLEET_STATION_H_
+
+#include <poll.h>
+#include <stdint.h>
+
+// What a station process of the fleet load test puts around the firmware's
+// mqtt_connection.c: the broker given on the command line, and a poll()
+// that produces the reports falling due while the MQTT thread waits. Forced
+// into mqtt_connection.c with FLEET_FIRMWARE, its poll() becomes
+// station_poll().
+
+#ifdef FLEET_FIRMWARE
+#define poll station_poll
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// CONFIG_MQTT_BROKER_HOSTNAME and CONFIG_MQTT_BROKER_PORT
+extern const char *fleet_broker_host;
+extern int fleet_broker_port;
+
+/**
+ * @brief poll() for the MQTT thread, makes the reports that fall due until
+ * the descriptor is ready or the timeout passes.
+ */
+int station_poll(struct pollfd *fds, nfds_t nfds, int timeout);
+
+/**
+ * @brief Sleep until uptime until_ms at the latest, returns early once a
+ * report was made. The blocking kernel calls wait with it.
+ */
+void station_wait(int64_t until_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FLEET_STATION_H_ */
@@ -0,0 +1,84 @@
+#include <string.h>
+#include <time.h>
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "station.h"
+
+// The kernel objects of mqtt_connection.c for a station process. Unlike
+// tools/shim/kernel.c uptime is the real monotonic clock, the MQTT thread
+// is the only thread and its blocking waits make the reports.
+
+int shim_log_level = LOG_LEVEL_WRN;
+
+int64_t k_uptime_get(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * MSEC_PER_SEC + ts.tv_nsec / 1000000;
+}
+
+int k_msgq_put(struct k_msgq *q, const void *data, k_timeout_t timeout)
+{
+	// nothing takes a message while the only thread waits
+	ARG_UNUSED(timeout);
+	if (q->used == q->max_msgs)
+	{
+		return -ENOMSG;
+	}
+	memcpy(q->buffer + ((q->head + q->used) % q->max_msgs) * q->msg_size, data, q->msg_size);
+	++q->used;
+	return 0;
+}
+
+int k_msgq_get(struct k_msgq *q, void *data, k_timeout_t timeout)
+{
+	int64_t end = timeout.ms < 0 ? INT64_MAX : k_uptime_get() + timeout.ms;
+
+	while (q->used == 0)
+	{
+		if (k_uptime_get() >= end)
+		{
+			return timeout.ms == 0 ? -ENOMSG : -EAGAIN;
+		}
+		station_wait(end);
+	}
+	memcpy(data, q->buffer + q->head * q->msg_size, q->msg_size);
+	q->head = (q->head + 1) % q->max_msgs;
+	--q->used;
+	return 0;
+}
+
+int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem, k_timeout_t timeout)
+{
+	// nothing frees a block while the only thread waits
+	ARG_UNUSED(timeout);
+	if (slab->free_list == NULL && slab->num_used == 0)
+	{
+		for (uint32_t i = 0; i < slab->num_blocks; ++i)
+		{
+			void **block = (void **)(slab->buffer + i * slab->block_size);
+
+			*block = slab->free_list;
+			slab->free_list = block;
+		}
+	}
+	if (slab->free_list == NULL)
+	{
+		*mem = NULL;
+		return -ENOMEM;
+	}
+	*mem = slab->free_list;
+	slab->free_list = *(void **)slab->free_list;
+	++slab->num_used;
+	return 0;
+}
+
+void k_mem_slab_free(struct k_mem_slab *slab, void **mem)
+{
+	*(void **)*mem = slab->free_list;
+	slab->free_list = *mem;
+	--slab->num_used;
+}
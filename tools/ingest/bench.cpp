@@ -0,0 +1,237 @@
+// Ingest and query benchmark over synthetic years of station reports.
+//
+//   wind_ingest_bench [years] [dir]
+//
+// Feeds one 10 minute delta report per slot and an hourly health report
+// through the same decode and append path as the daemon, in CBOR and in
+// JSON, then times raw and rollup range queries on the reopened store.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ingest.h"
+
+namespace
+{
+
+using bench_clock = std::chrono::steady_clock;
+
+constexpr uint32_t START = 1577836800; // 2020-01-01
+constexpr uint32_t SLOT_S = 600;
+constexpr int QUERIES = 1000;
+constexpr const char *PRIMARY = "zimbuktu";
+
+void cbor_head(std::vector<uint8_t> &b, uint8_t major, uint32_t v)
+{
+	if (v < 24)
+	{
+		b.push_back((major << 5) | v);
+	}
+	else if (v <= 0xff)
+	{
+		b.push_back((major << 5) | 24);
+		b.push_back(v);
+	}
+	else if (v <= 0xffff)
+	{
+		b.push_back((major << 5) | 25);
+		b.push_back(v >> 8);
+		b.push_back(v);
+	}
+	else
+	{
+		b.push_back((major << 5) | 26);
+		for (int s = 24; s >= 0; s -= 8)
+		{
+			b.push_back(v >> s);
+		}
+	}
+}
+
+void cbor_text(std::vector<uint8_t> &b, const std::string &text)
+{
+	cbor_head(b, 3, text.size());
+	b.insert(b.end(), text.begin(), text.end());
+}
+
+// same layout as payload_wind_slot() in src/payload.c
+void encode_slot(std::vector<uint8_t> &b, bool json, const std::string &station, uint32_t t, int slot, int s, int d,
+				 int g, int l)
+{
+	b.clear();
+	if (json)
+	{
+		char text[160];
+		time_t tt = t;
+		struct tm tm;
+
+		gmtime_r(&tt, &tm);
+		int n = snprintf(text, sizeof(text),
+						 "{\"station\":\"%s\", \"time\":\"%04d-%02d-%02dT%02d:%02dZ\", \"slot\":%d, \"wind\":[%d, %d, %d, %d]}",
+						 station.c_str(), tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, slot, s, d, g, l);
+		b.assign(text, text + n);
+		return;
+	}
+	cbor_head(b, 4, 5);
+	cbor_head(b, 0, 2);
+	cbor_text(b, station);
+	cbor_head(b, 0, t);
+	cbor_head(b, 0, slot);
+	cbor_head(b, 4, 4);
+	cbor_head(b, 0, s);
+	cbor_head(b, 0, d);
+	cbor_head(b, 0, g);
+	cbor_head(b, 0, l);
+}
+
+void encode_health(std::vector<uint8_t> &b, bool json, const std::string &station)
+{
+	b.clear();
+	if (json)
+	{
+		std::string text = "{\"station\":\"" + station +
+						   "\", \"bat\":{\"mv\":3900,\"temp\":14,\"soc\":65,\"tier\":0,\"hours\":900},"
+						   "\"act\":[1,2,3,4,5,6,7,8,9,10,11,12,13]}";
+		b.assign(text.begin(), text.end());
+		return;
+	}
+	cbor_head(b, 4, 4);
+	cbor_head(b, 0, 2);
+	cbor_text(b, station);
+	cbor_head(b, 4, 5);
+	for (uint32_t v : {3900u, 14u, 65u, 0u, 900u})
+	{
+		cbor_head(b, 0, v);
+	}
+	cbor_head(b, 4, 13);
+	for (uint32_t v = 1; v <= 13; ++v)
+	{
+		cbor_head(b, 0, v);
+	}
+}
+
+double seconds_since(bench_clock::time_point t)
+{
+	return std::chrono::duration<double>(bench_clock::now() - t).count();
+}
+
+void ingest_years(const std::string &dir, const char *station, bool json, uint32_t slots)
+{
+	ingest in(dir);
+	std::vector<uint8_t> payload;
+	std::mt19937 rng(1);
+	std::string delta = std::string(PRIMARY) + "/" + station + "/wind/delta";
+	std::string health = std::string(PRIMARY) + "/" + station + "/health";
+	int speed = 8;
+	int dir_deg = 200;
+
+	auto start = bench_clock::now();
+	for (uint32_t i = 0; i < slots; ++i)
+	{
+		uint32_t t = START + i * SLOT_S;
+
+		speed = std::clamp(speed + int(rng() % 5) - 2, 0, 40);
+		dir_deg = (dir_deg + int(rng() % 21) - 10 + 360) % 360;
+		encode_slot(payload, json, station, t, (t % 3600) / SLOT_S, speed, dir_deg, speed + 4, speed / 2);
+		in.handle(delta, payload.data(), payload.size(), t);
+		if (t % 3600 == 3600 - SLOT_S)
+		{
+			encode_health(payload, json, station);
+			in.handle(health, payload.data(), payload.size(), t);
+		}
+	}
+	in.sync();
+	double s = seconds_since(start);
+	const ingest::stats &c = in.counters();
+
+	printf("%-5s ingest: %llu messages in %.2f s, %.0f msg/s, %.2f us/msg, %llu samples\n", json ? "json" : "cbor",
+		   (unsigned long long)c.messages, s, c.messages / s, s * 1e6 / c.messages,
+		   (unsigned long long)c.samples);
+}
+
+template <typename F>
+void time_queries(const char *name, int count, F query)
+{
+	std::vector<double> us;
+	size_t rows = 0;
+
+	for (int i = 0; i < count; ++i)
+	{
+		auto t = bench_clock::now();
+		rows += query();
+		us.push_back(seconds_since(t) * 1e6);
+	}
+	std::sort(us.begin(), us.end());
+	printf("  %-24s p50 %8.1f us  p99 %8.1f us  %zu rows/query\n", name, us[count / 2], us[count * 99 / 100],
+		   rows / count);
+}
+
+void query_store(const std::string &dir, const char *station, uint32_t slots)
+{
+	auto open_start = bench_clock::now();
+	ingest in(dir);
+	station_store *store = in.station(std::string(PRIMARY) + "/" + station);
+	double open_ms = seconds_since(open_start) * 1e3;
+
+	if (store == nullptr)
+	{
+		printf("failed to open %s\n", dir.c_str());
+		return;
+	}
+	printf("query: %zu samples, reopened in %.2f ms\n", store->sample_count(), open_ms);
+
+	uint32_t span = slots * SLOT_S;
+	std::mt19937 rng(2);
+	std::vector<wind_sample> samples;
+	std::vector<wind_rollup> rollups;
+
+	time_queries("raw, 1 day", QUERIES, [&]() {
+		uint32_t from = START + rng() % (span - 86400);
+		store->samples(from, from + 86400, samples);
+		return samples.size();
+	});
+	time_queries("hourly, 30 days", QUERIES, [&]() {
+		uint32_t from = START + rng() % (span - 30 * 86400);
+		store->rollups(rollup_level::HOURLY, from, from + 30 * 86400, rollups);
+		return rollups.size();
+	});
+	time_queries("daily, whole history", QUERIES, [&]() {
+		store->rollups(rollup_level::DAILY, START, START + span, rollups);
+		return rollups.size();
+	});
+	time_queries("raw, whole history", 10, [&]() {
+		store->samples(START, START + span, samples);
+		return samples.size();
+	});
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	int years = argc > 1 ? atoi(argv[1]) : 5;
+	std::string dir = argc > 2 ? argv[2] : "/tmp/wind_ingest_bench";
+	uint32_t slots = uint32_t(years) * 365 * 24 * 3600 / SLOT_S;
+
+	if (years < 1)
+	{
+		fprintf(stderr, "usage: wind_ingest_bench [years] [dir]\n");
+		return 2;
+	}
+	std::string rm = "rm -rf '" + dir + "'";
+	if (system(rm.c_str()) != 0)
+	{
+		return 1;
+	}
+
+	printf("%d years, %u slots of %u s\n", years, slots, SLOT_S);
+	ingest_years(dir, "cbor", false, slots);
+	ingest_years(dir, "json", true, slots);
+	query_store(dir, "cbor", slots);
+	return 0;
+}
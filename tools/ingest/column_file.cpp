@@ -0,0 +1,112 @@
+#include "column_file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+namespace
+{
+constexpr uint32_t COLUMN_MAGIC = 0x4c4f4357; // "WCOL"
+constexpr size_t MIN_MAP_BYTES = 64 * 1024;
+} // namespace
+
+column_file_base::~column_file_base()
+{
+	if (map_)
+	{
+		munmap(map_, mapped_);
+	}
+}
+
+bool column_file_base::open(const std::string &path, uint32_t value_size)
+{
+	struct stat st;
+
+	path_ = path;
+	int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0)
+	{
+		return false;
+	}
+	bool ok = fstat(fd, &st) == 0;
+	close(fd);
+	if (!ok)
+	{
+		return false;
+	}
+
+	bool fresh = static_cast<size_t>(st.st_size) < sizeof(header);
+
+	if (!map(std::max<size_t>(st.st_size, MIN_MAP_BYTES)))
+	{
+		return false;
+	}
+	if (fresh)
+	{
+		hdr_->magic = COLUMN_MAGIC;
+		hdr_->value_size = value_size;
+		hdr_->count = 0;
+	}
+	if (hdr_->magic != COLUMN_MAGIC || hdr_->value_size != value_size ||
+		sizeof(header) + hdr_->count * value_size > mapped_)
+	{
+		return false;
+	}
+	return true;
+}
+
+// the file is only open while it is resized and mapped, the mapping stays
+// valid after close, so a host with thousands of columns keeps no descriptors
+bool column_file_base::map(size_t bytes)
+{
+	int fd = ::open(path_.c_str(), O_RDWR);
+
+	if (fd < 0)
+	{
+		return false;
+	}
+	if (ftruncate(fd, bytes) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void *p = map_ ? mremap(map_, mapped_, bytes, MREMAP_MAYMOVE)
+				   : mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED)
+	{
+		return false;
+	}
+	map_ = static_cast<uint8_t *>(p);
+	mapped_ = bytes;
+	hdr_ = reinterpret_cast<header *>(map_);
+	return true;
+}
+
+uint8_t *column_file_base::append_slot()
+{
+	size_t end = sizeof(header) + (hdr_->count + 1) * hdr_->value_size;
+
+	if (end > mapped_ && !map(std::max(end, mapped_ * 2)))
+	{
+		return nullptr;
+	}
+	return values() + hdr_->count * hdr_->value_size;
+}
+
+void column_file_base::truncate(size_t count)
+{
+	hdr_->count = std::min<uint64_t>(hdr_->count, count);
+}
+
+void column_file_base::sync()
+{
+	if (map_)
+	{
+		msync(map_, mapped_, MS_ASYNC);
+	}
+}
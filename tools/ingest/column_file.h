@@ -0,0 +1,109 @@
+#ifndef _COLUMN_FILE_H_
+#define _COLUMN_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+// Append-only column of fixed size values in a memory-mapped file. The file
+// starts with a header holding the value count, values follow back to back.
+// The file grows in doubling steps, appends are a store into the mapping.
+class column_file_base
+{
+public:
+	column_file_base() = default;
+	column_file_base(const column_file_base &) = delete;
+	column_file_base &operator=(const column_file_base &) = delete;
+	~column_file_base();
+
+	/**
+	 * @brief Map the column at path, created if missing.
+	 *
+	 * @return bool - false if the file can not be opened or holds values of another size.
+	 */
+	bool open(const std::string &path, uint32_t value_size);
+
+	size_t size() const { return hdr_ ? hdr_->count : 0; }
+
+	/**
+	 * @brief Drop values past count, used to recover a torn append.
+	 */
+	void truncate(size_t count);
+
+	/**
+	 * @brief Flush the mapping to disk.
+	 */
+	void sync();
+
+protected:
+	struct header
+	{
+		uint32_t magic;
+		uint32_t value_size;
+		uint64_t count;
+		uint8_t reserved[48]; // keeps values 64 byte aligned
+	};
+
+	uint8_t *values() const { return map_ + sizeof(header); }
+	uint8_t *append_slot();
+	void commit() { ++hdr_->count; }
+
+private:
+	bool map(size_t bytes);
+
+	std::string path_;
+	uint8_t *map_ = nullptr;
+	size_t mapped_ = 0;
+	header *hdr_ = nullptr;
+};
+
+template <typename T>
+class column_file : public column_file_base
+{
+public:
+	bool open(const std::string &path) { return column_file_base::open(path, sizeof(T)); }
+
+	/**
+	 * @brief Append a value, false if the file could not grow.
+	 */
+	bool append(const T &value)
+	{
+		uint8_t *slot = append_slot();
+
+		if (slot == nullptr)
+		{
+			return false;
+		}
+		*reinterpret_cast<T *>(slot) = value;
+		commit();
+		return true;
+	}
+
+	/**
+	 * @brief Insert a value before index i, the later values move up. Unlike
+	 * an append a crash in between can leave a value twice.
+	 */
+	bool insert(size_t i, const T &value)
+	{
+		if (append_slot() == nullptr)
+		{
+			return false;
+		}
+		T *d = data();
+
+		std::memmove(d + i + 1, d + i, (size() - i) * sizeof(T));
+		d[i] = value;
+		commit();
+		return true;
+	}
+
+	const T *data() const { return reinterpret_cast<const T *>(values()); }
+	T *data() { return reinterpret_cast<T *>(values()); }
+	const T &operator[](size_t i) const { return data()[i]; }
+	T &operator[](size_t i) { return data()[i]; }
+	const T &back() const { return data()[size() - 1]; }
+	T &back() { return data()[size() - 1]; }
+};
+
+#endif /* _COLUMN_FILE_H_ */
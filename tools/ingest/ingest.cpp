@@ -0,0 +1,84 @@
+#include "ingest.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+
+station_store *ingest::station(const std::string &name)
+{
+	auto it = stations_.find(name);
+
+	if (it != stations_.end())
+	{
+		return it->second.get();
+	}
+
+	// topic levels become one directory name
+	std::string dir = name;
+	std::replace(dir.begin(), dir.end(), '/', '_');
+
+	mkdir(root_.c_str(), 0755);
+	auto store = std::make_unique<station_store>();
+	if (!store->open(root_ + "/" + dir))
+	{
+		return nullptr;
+	}
+	return stations_.emplace(name, std::move(store)).first->second.get();
+}
+
+bool ingest::handle(const std::string &topic, const uint8_t *payload, size_t len, uint32_t now)
+{
+	std::string name = topic_station(topic);
+	parsed_report report;
+
+	++stats_.messages;
+	if (name.empty())
+	{
+		return false;
+	}
+	if (!parse_report(topic, payload, len, now, report))
+	{
+		// empty retained messages only clear a topic
+		stats_.malformed += len > 0;
+		return false;
+	}
+	// a report published under another station's topic is not trusted
+	if (name.compare(name.rfind('/') + 1, std::string::npos, report.station) != 0)
+	{
+		++stats_.malformed;
+		return false;
+	}
+
+	station_store *store = station(name);
+	if (store == nullptr)
+	{
+		return false;
+	}
+
+	if (report.type == parsed_report::HEALTH)
+	{
+		store->add(report.health);
+		++stats_.health;
+		return true;
+	}
+	for (const auto &s : report.wind)
+	{
+		if (store->add(s))
+		{
+			++stats_.samples;
+		}
+		else
+		{
+			++stats_.skipped;
+		}
+	}
+	return true;
+}
+
+void ingest::sync()
+{
+	for (auto &s : stations_)
+	{
+		s.second->sync();
+	}
+}
@@ -0,0 +1,51 @@
+#ifndef _INGEST_H_
+#define _INGEST_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "station_store.h"
+
+// Routes station reports to the store of their station, one directory per
+// station under the root.
+class ingest
+{
+public:
+	struct stats
+	{
+		uint64_t messages;
+		uint64_t samples;	// wind samples appended
+		uint64_t health;	// health reports appended
+		uint64_t skipped;	// samples already stored
+		uint64_t malformed; // payloads that did not decode
+	};
+
+	explicit ingest(const std::string &root) : root_(root) {}
+
+	/**
+	 * @brief Decode one MQTT message and append it to its station.
+	 *
+	 * @param now - unix time of arrival.
+	 * @return bool - false if the topic or payload is not a station report.
+	 */
+	bool handle(const std::string &topic, const uint8_t *payload, size_t len, uint32_t now);
+
+	/**
+	 * @brief Store of a station, opened on first use, nullptr if it can not be opened.
+	 */
+	station_store *station(const std::string &name);
+
+	const stats &counters() const { return stats_; }
+
+	void sync();
+
+private:
+	std::string root_;
+	std::map<std::string, std::unique_ptr<station_store>> stations_;
+	stats stats_{};
+};
+
+#endif /* _INGEST_H_ */
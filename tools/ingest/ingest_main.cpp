@@ -0,0 +1,219 @@
+// Ingest daemon, appends the reports of every station on a local broker to
+// its columnar store.
+//
+//   wind_ingest -d /var/lib/wind [-h localhost] [-p 1883] [-t topic]...
+//   mosquitto_sub -t '+/+/wind/#' -t '+/+/health' -F '%t %x' | wind_ingest -d /var/lib/wind --stdin
+//
+// The second form needs no libmosquitto, payloads come as hex.
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ingest.h"
+
+#if defined(HAVE_MOSQUITTO)
+#include <mosquitto.h>
+#endif
+
+namespace
+{
+
+constexpr int SYNC_INTERVAL_S = 10;
+
+volatile sig_atomic_t stop;
+
+void on_signal(int)
+{
+	stop = 1;
+}
+
+uint32_t now()
+{
+	return static_cast<uint32_t>(time(nullptr));
+}
+
+void log_stats(const ingest &in)
+{
+	const ingest::stats &s = in.counters();
+
+	fprintf(stderr, "messages %llu, samples %llu, health %llu, skipped %llu, malformed %llu\n",
+			(unsigned long long)s.messages, (unsigned long long)s.samples, (unsigned long long)s.health,
+			(unsigned long long)s.skipped, (unsigned long long)s.malformed);
+}
+
+bool decode_hex(const std::string &hex, std::vector<uint8_t> &out)
+{
+	out.clear();
+	if (hex.size() % 2)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < hex.size(); i += 2)
+	{
+		char byte[3] = {hex[i], hex[i + 1], 0};
+		char *end;
+
+		out.push_back(static_cast<uint8_t>(strtoul(byte, &end, 16)));
+		if (*end)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// "topic hexpayload" per line, as printed by mosquitto_sub -F '%t %x'
+int run_stdin(ingest &in)
+{
+	std::string line;
+	std::vector<uint8_t> payload;
+	time_t last_sync = time(nullptr);
+
+	while (!stop && std::getline(std::cin, line))
+	{
+		size_t space = line.find(' ');
+		std::string topic = line.substr(0, space);
+		std::string hex = space == std::string::npos ? std::string() : line.substr(space + 1);
+
+		if (decode_hex(hex, payload))
+		{
+			in.handle(topic, payload.data(), payload.size(), now());
+		}
+		if (time(nullptr) - last_sync >= SYNC_INTERVAL_S)
+		{
+			in.sync();
+			last_sync = time(nullptr);
+		}
+	}
+	in.sync();
+	log_stats(in);
+	return 0;
+}
+
+#if defined(HAVE_MOSQUITTO)
+void on_message(struct mosquitto *, void *obj, const struct mosquitto_message *msg)
+{
+	static_cast<ingest *>(obj)->handle(msg->topic, static_cast<const uint8_t *>(msg->payload), msg->payloadlen,
+									   now());
+}
+
+int run_broker(ingest &in, const std::string &host, int port, const std::vector<std::string> &topics)
+{
+	mosquitto_lib_init();
+	struct mosquitto *m = mosquitto_new("wind-ingest", true, &in);
+
+	if (m == nullptr)
+	{
+		return 1;
+	}
+	mosquitto_message_callback_set(m, on_message);
+	if (mosquitto_connect(m, host.c_str(), port, 60) != MOSQ_ERR_SUCCESS)
+	{
+		fprintf(stderr, "Failed to connect to %s:%d\n", host.c_str(), port);
+		return 1;
+	}
+	for (const auto &t : topics)
+	{
+		mosquitto_subscribe(m, nullptr, t.c_str(), 1);
+	}
+
+	time_t last_sync = time(nullptr);
+	while (!stop)
+	{
+		int rc = mosquitto_loop(m, 1000, 1);
+
+		if (rc != MOSQ_ERR_SUCCESS)
+		{
+			mosquitto_reconnect(m);
+		}
+		if (time(nullptr) - last_sync >= SYNC_INTERVAL_S)
+		{
+			in.sync();
+			log_stats(in);
+			last_sync = time(nullptr);
+		}
+	}
+	in.sync();
+	mosquitto_destroy(m);
+	mosquitto_lib_cleanup();
+	return 0;
+}
+#endif
+
+void usage()
+{
+	fprintf(stderr, "usage: wind_ingest -d dir [-h host] [-p port] [-t topic]... [--stdin]\n");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	std::string dir;
+	std::string host = "localhost";
+	[[maybe_unused]] int port = 1883; // only with libmosquitto
+	std::vector<std::string> topics;
+	bool from_stdin = false;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		std::string arg = argv[i];
+
+		if (arg == "--stdin")
+		{
+			from_stdin = true;
+		}
+		else if (i + 1 < argc && arg == "-d")
+		{
+			dir = argv[++i];
+		}
+		else if (i + 1 < argc && arg == "-h")
+		{
+			host = argv[++i];
+		}
+		else if (i + 1 < argc && arg == "-p")
+		{
+			port = atoi(argv[++i]);
+		}
+		else if (i + 1 < argc && arg == "-t")
+		{
+			topics.push_back(argv[++i]);
+		}
+		else
+		{
+			usage();
+			return 2;
+		}
+	}
+	if (dir.empty())
+	{
+		usage();
+		return 2;
+	}
+	if (topics.empty())
+	{
+		topics = {"+/+/wind/#", "+/+/health"};
+	}
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+
+	ingest in(dir);
+
+	if (from_stdin)
+	{
+		return run_stdin(in);
+	}
+#if defined(HAVE_MOSQUITTO)
+	return run_broker(in, host, port, topics);
+#else
+	fprintf(stderr, "Built without libmosquitto, use --stdin\n");
+	return 2;
+#endif
+}
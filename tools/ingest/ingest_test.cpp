@@ -0,0 +1,400 @@
+// Ingest test on a scratch directory.
+//
+//   wind_ingest_test
+//
+// Each case feeds station reports, JSON or CBOR in the layouts of
+// src/payload.c, through ingest::handle() like the daemon does, out of
+// order and repeated, then reads the stored columns back.
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include "ingest.h"
+
+namespace
+{
+
+constexpr uint32_t HOUR = 1772344800; // 2026-03-01 06:00 UTC
+constexpr uint32_t SLOT_S = 600;
+constexpr const char *STATION = "nrf-351358811234567";
+constexpr const char *PREFIX = "zimbuktu/nrf-351358811234567";
+
+int failures;
+std::string root;
+
+#define EXPECT(cond)                                                                                                   \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		if (!(cond))                                                                                                   \
+		{                                                                                                              \
+			fprintf(stderr, "  %s:%d: %s\n", __FILE__, __LINE__, #cond);                                              \
+			++failures;                                                                                                \
+			return;                                                                                                    \
+		}                                                                                                              \
+	} while (0)
+
+struct slot
+{
+	uint32_t time;
+	int speed;
+	int direction;
+	int gust;
+	int lull;
+};
+
+void cbor_head(std::vector<uint8_t> &b, uint8_t major, uint32_t v)
+{
+	if (v < 24)
+	{
+		b.push_back((major << 5) | v);
+	}
+	else if (v <= 0xff)
+	{
+		b.push_back((major << 5) | 24);
+		b.push_back(v);
+	}
+	else if (v <= 0xffff)
+	{
+		b.push_back((major << 5) | 25);
+		b.push_back(v >> 8);
+		b.push_back(v);
+	}
+	else
+	{
+		b.push_back((major << 5) | 26);
+		for (int s = 24; s >= 0; s -= 8)
+		{
+			b.push_back(v >> s);
+		}
+	}
+}
+
+void cbor_text(std::vector<uint8_t> &b, const std::string &text)
+{
+	cbor_head(b, 3, text.size());
+	b.insert(b.end(), text.begin(), text.end());
+}
+
+void cbor_slot(std::vector<uint8_t> &b, const slot &s)
+{
+	cbor_head(b, 4, 4);
+	cbor_head(b, 0, s.speed);
+	cbor_head(b, 0, s.direction);
+	cbor_head(b, 0, s.gust);
+	cbor_head(b, 0, s.lull);
+}
+
+std::string json_time(uint32_t t)
+{
+	char text[32];
+	time_t tt = t;
+	struct tm tm;
+
+	gmtime_r(&tt, &tm);
+	snprintf(text, sizeof(text), "%04d-%02d-%02dT%02d:%02dZ", tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday,
+			 tm.tm_hour, tm.tm_min);
+	return text;
+}
+
+std::string json_slot(const slot &s)
+{
+	return "[" + std::to_string(s.speed) + ", " + std::to_string(s.direction) + ", " + std::to_string(s.gust) +
+		   ", " + std::to_string(s.lull) + "]";
+}
+
+// payload_wind_slot()
+std::vector<uint8_t> delta(bool json, const slot &s)
+{
+	std::vector<uint8_t> b;
+	int index = (s.time % 3600) / SLOT_S;
+
+	if (json)
+	{
+		std::string text = std::string("{\"station\":\"") + STATION + "\", \"time\":\"" + json_time(s.time) +
+						   "\", \"slot\":" + std::to_string(index) + ", \"wind\":" + json_slot(s) + "}";
+		return std::vector<uint8_t>(text.begin(), text.end());
+	}
+	cbor_head(b, 4, 5);
+	cbor_head(b, 0, 2);
+	cbor_text(b, STATION);
+	cbor_head(b, 0, s.time);
+	cbor_head(b, 0, index);
+	cbor_slot(b, s);
+	return b;
+}
+
+// payload_wind(), the slots of one hour
+std::vector<uint8_t> hour(bool json, uint32_t time, const std::vector<slot> &slots)
+{
+	std::vector<uint8_t> b;
+
+	if (json)
+	{
+		std::string text = std::string("{\"station\":\"") + STATION + "\", \"time\":\"" + json_time(time) +
+						   "\", \"wind\":[";
+		for (size_t i = 0; i < slots.size(); ++i)
+		{
+			text += (i ? ", " : "") + json_slot(slots[i]);
+		}
+		text += "]}";
+		return std::vector<uint8_t>(text.begin(), text.end());
+	}
+	cbor_head(b, 4, 4);
+	cbor_head(b, 0, 2);
+	cbor_text(b, STATION);
+	cbor_head(b, 0, time);
+	cbor_head(b, 4, slots.size());
+	for (const auto &s : slots)
+	{
+		cbor_slot(b, s);
+	}
+	return b;
+}
+
+// payload_health()
+std::vector<uint8_t> health(bool json, int mv, int temp_f, int soc, int tier, int hours)
+{
+	std::vector<uint8_t> b;
+
+	if (json)
+	{
+		std::string text = std::string("{\"station\":\"") + STATION + "\", \"bat\":{\"mv\":" + std::to_string(mv) +
+						   ",\"temp\":" + std::to_string(temp_f) + ",\"soc\":" + std::to_string(soc) +
+						   ",\"tier\":" + std::to_string(tier) + ",\"hours\":" + std::to_string(hours) +
+						   "},\"act\":[1,2,3,4,5,6,7,8,9,10,11,12,13]}";
+		return std::vector<uint8_t>(text.begin(), text.end());
+	}
+	cbor_head(b, 4, 4);
+	cbor_head(b, 0, 2);
+	cbor_text(b, STATION);
+	cbor_head(b, 4, 5);
+	cbor_head(b, 0, mv);
+	cbor_head(b, temp_f < 0 ? 1 : 0, temp_f < 0 ? -1 - temp_f : temp_f);
+	cbor_head(b, 0, soc);
+	cbor_head(b, 0, tier);
+	cbor_head(b, 0, hours);
+	cbor_head(b, 4, 13);
+	for (uint32_t v = 1; v <= 13; ++v)
+	{
+		cbor_head(b, 0, v);
+	}
+	return b;
+}
+
+bool handle(ingest &in, const std::string &sub, const std::vector<uint8_t> &payload, uint32_t now = HOUR)
+{
+	return in.handle(std::string(PREFIX) + sub, payload.data(), payload.size(), now);
+}
+
+// a fresh directory per case
+std::string fresh_dir(const char *name)
+{
+	std::string dir = root + "/" + name;
+
+	system(("rm -rf '" + dir + "'").c_str());
+	return dir;
+}
+
+bool same(const wind_sample &w, const slot &s)
+{
+	return w.time == s.time && w.speed == s.speed && w.direction == s.direction && w.gust == s.gust &&
+		   w.lull == s.lull;
+}
+
+// the slots of one hour, delivered out of order and partly twice, come
+// back in time order with their rollup
+void out_of_order(bool json)
+{
+	const slot slots[] = {
+		{HOUR + 0 * SLOT_S, 10, 90, 14, 6},	  {HOUR + 1 * SLOT_S, 12, 100, 18, 7},
+		{HOUR + 2 * SLOT_S, 8, 80, 11, 4},	  {HOUR + 3 * SLOT_S, 20, 120, 27, 12},
+		{HOUR + 4 * SLOT_S, 15, 110, 22, 9},  {HOUR + 5 * SLOT_S, 11, 95, 16, 3},
+	};
+	const int order[] = {0, 3, 1, 5, 3, 2, 4, 0};
+	ingest in(fresh_dir(json ? "json" : "cbor"));
+	std::vector<wind_sample> got;
+	std::vector<wind_rollup> hourly;
+
+	for (int i : order)
+	{
+		EXPECT(handle(in, "/wind/delta", delta(json, slots[i])));
+	}
+	EXPECT(in.counters().samples == 6);
+	EXPECT(in.counters().skipped == 2);
+
+	station_store *store = in.station(PREFIX);
+	EXPECT(store != nullptr);
+	store->samples(HOUR, HOUR + 3600, got);
+	EXPECT(got.size() == 6);
+	for (size_t i = 0; i < got.size(); ++i)
+	{
+		EXPECT(same(got[i], slots[i]));
+	}
+
+	store->rollups(rollup_level::HOURLY, HOUR, HOUR + 3600, hourly);
+	EXPECT(hourly.size() == 1);
+	EXPECT(hourly[0].time == HOUR);
+	EXPECT(hourly[0].count == 6);
+	EXPECT(hourly[0].speed == (10 + 12 + 8 + 20 + 15 + 11) / 6);
+	EXPECT(hourly[0].gust == 27);
+	EXPECT(hourly[0].lull == 3);
+	EXPECT(hourly[0].direction > 90 && hourly[0].direction < 120);
+}
+
+void test_out_of_order_cbor()
+{
+	out_of_order(false);
+}
+
+void test_out_of_order_json()
+{
+	out_of_order(true);
+}
+
+// an hour report sent again after later deltas fills its gaps in place,
+// in the store and in the rollups, also after the store is reopened
+void late_hour(bool json)
+{
+	std::string dir = fresh_dir(json ? "late_json" : "late_cbor");
+	std::vector<slot> earlier;
+	std::vector<wind_sample> got;
+	std::vector<wind_rollup> hourly;
+	std::vector<wind_rollup> daily;
+
+	for (int i = 0; i < 6; ++i)
+	{
+		earlier.push_back({HOUR - 3600 + i * uint32_t(SLOT_S), 5 + i, 200 + i, 9 + i, 2 + i});
+	}
+	{
+		ingest in(dir);
+
+		EXPECT(handle(in, "/wind/delta", delta(json, {HOUR, 7, 180, 12, 3})));
+		EXPECT(handle(in, "/wind/delta", delta(json, {HOUR + SLOT_S, 9, 190, 13, 4})));
+		// one slot of the hour before already came as a delta
+		EXPECT(handle(in, "/wind/delta", delta(json, earlier[2])));
+		in.sync();
+	}
+
+	ingest in(dir);
+	EXPECT(handle(in, "/wind/09", hour(json, HOUR - 3600, earlier)));
+	EXPECT(in.counters().samples == 5);
+	EXPECT(in.counters().skipped == 1);
+
+	station_store *store = in.station(PREFIX);
+	EXPECT(store != nullptr);
+	EXPECT(store->sample_count() == 8);
+	store->samples(HOUR - 3600, HOUR + 3600, got);
+	EXPECT(got.size() == 8);
+	for (size_t i = 0; i < earlier.size(); ++i)
+	{
+		EXPECT(same(got[i], earlier[i]));
+	}
+	EXPECT(same(got[6], {HOUR, 7, 180, 12, 3}));
+	EXPECT(same(got[7], {HOUR + SLOT_S, 9, 190, 13, 4}));
+
+	store->rollups(rollup_level::HOURLY, HOUR - 3600, HOUR + 3600, hourly);
+	EXPECT(hourly.size() == 2);
+	EXPECT(hourly[0].time == HOUR - 3600 && hourly[0].count == 6);
+	EXPECT(hourly[0].gust == 14 && hourly[0].lull == 2);
+	EXPECT(hourly[1].time == HOUR && hourly[1].count == 2);
+	store->rollups(rollup_level::DAILY, HOUR - 86400, HOUR + 86400, daily);
+	EXPECT(daily.size() == 1);
+	EXPECT(daily[0].count == 8);
+}
+
+void test_late_hour_cbor()
+{
+	late_hour(false);
+}
+
+void test_late_hour_json()
+{
+	late_hour(true);
+}
+
+// health fields decode the same from both formats, each report is a row
+void test_health()
+{
+	ingest in(fresh_dir("health"));
+	parsed_report cbor;
+	parsed_report json;
+	std::vector<uint8_t> c = health(false, 3712, -4, 63, 1, 812);
+	std::vector<uint8_t> j = health(true, 3712, -4, 63, 1, 812);
+
+	EXPECT(parse_report(std::string(PREFIX) + "/health", c.data(), c.size(), HOUR, cbor));
+	EXPECT(parse_report(std::string(PREFIX) + "/health", j.data(), j.size(), HOUR, json));
+	for (const parsed_report *r : {&cbor, &json})
+	{
+		EXPECT(r->type == parsed_report::HEALTH);
+		EXPECT(r->station == STATION);
+		EXPECT(r->health.time == HOUR);
+		EXPECT(r->health.mv == 3712);
+		EXPECT(r->health.temp_f == -4);
+		EXPECT(r->health.soc == 63);
+		EXPECT(r->health.tier == 1);
+		EXPECT(r->health.hours_left == 812);
+	}
+	EXPECT(handle(in, "/health", c));
+	EXPECT(handle(in, "/health", j, HOUR + 3600));
+	EXPECT(in.counters().health == 2);
+	EXPECT(in.station(PREFIX)->health_count() == 2);
+}
+
+// broken payloads and reports under another station's topic are not stored
+void test_rejected()
+{
+	ingest in(fresh_dir("rejected"));
+	std::vector<uint8_t> ok = delta(false, {HOUR, 7, 180, 12, 3});
+	std::vector<uint8_t> truncated(ok.begin(), ok.end() - 2);
+	std::string text = "{\"station\":\"nrf-1\", \"time\":\"2026-03-01T06:00Z\", \"slot\":0, \"wind\":[1, 2, 3, 4]}";
+	std::vector<uint8_t> other(text.begin(), text.end());
+
+	EXPECT(!handle(in, "/wind/delta", truncated));
+	EXPECT(!handle(in, "/wind/delta", other));
+	EXPECT(!handle(in, "/wind/delta", {}));
+	EXPECT(in.counters().malformed == 2);
+	EXPECT(in.counters().samples == 0);
+}
+
+} // namespace
+
+int main()
+{
+	char tmpl[] = "/tmp/wind_ingest_test.XXXXXX";
+
+	if (mkdtemp(tmpl) == nullptr)
+	{
+		perror("mkdtemp");
+		return 2;
+	}
+	root = tmpl;
+
+	const struct
+	{
+		const char *name;
+		void (*run)();
+	} cases[] = {
+		{"stores CBOR deltas in time order", test_out_of_order_cbor},
+		{"stores JSON deltas in time order", test_out_of_order_json},
+		{"inserts a late CBOR hour report", test_late_hour_cbor},
+		{"inserts a late JSON hour report", test_late_hour_json},
+		{"decodes and stores health reports", test_health},
+		{"rejects broken and foreign reports", test_rejected},
+	};
+
+	for (const auto &c : cases)
+	{
+		int before = failures;
+
+		printf("%s\n", c.name);
+		c.run();
+		printf("  %s\n", failures == before ? "ok" : "FAILED");
+	}
+	system(("rm -rf '" + root + "'").c_str());
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,527 @@
+#include "payload_parser.h"
+
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+
+constexpr int64_t PAYLOAD_VERSION = 2;
+constexpr uint32_t DAY_ROW_SECONDS = 600; // wind_day.h grid
+constexpr size_t DAY_ROWS = 24 * 6;
+
+// decoded JSON or CBOR item, only what the reports use
+struct item
+{
+	enum kind
+	{
+		INT,
+		TEXT,
+		BYTES,
+		ARRAY,
+		MAP,
+	} type = INT;
+	int64_t num = 0;
+	std::string str; // text or bytes
+	std::vector<item> items;
+	std::vector<std::pair<std::string, item>> fields;
+
+	const item *get(const char *key) const
+	{
+		for (const auto &f : fields)
+		{
+			if (f.first == key)
+			{
+				return &f.second;
+			}
+		}
+		return nullptr;
+	}
+};
+
+class json_reader
+{
+public:
+	json_reader(const uint8_t *p, size_t len) : pos_(reinterpret_cast<const char *>(p)), end_(pos_ + len) {}
+
+	bool read(item &out)
+	{
+		skip_ws();
+		if (pos_ >= end_)
+		{
+			return false;
+		}
+		switch (*pos_)
+		{
+		case '{':
+			return read_object(out);
+		case '[':
+			return read_array(out);
+		case '"':
+			out.type = item::TEXT;
+			return read_string(out.str);
+		default:
+			return read_number(out);
+		}
+	}
+
+private:
+	void skip_ws()
+	{
+		while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t'))
+		{
+			++pos_;
+		}
+	}
+
+	bool expect(char c)
+	{
+		skip_ws();
+		if (pos_ < end_ && *pos_ == c)
+		{
+			++pos_;
+			return true;
+		}
+		return false;
+	}
+
+	bool read_string(std::string &out)
+	{
+		if (!expect('"'))
+		{
+			return false;
+		}
+		while (pos_ < end_ && *pos_ != '"')
+		{
+			if (*pos_ == '\\' && pos_ + 1 < end_)
+			{
+				++pos_;
+			}
+			out.push_back(*pos_++);
+		}
+		return expect('"');
+	}
+
+	bool read_number(item &out)
+	{
+		bool neg = false;
+
+		out.type = item::INT;
+		if (pos_ < end_ && *pos_ == '-')
+		{
+			neg = true;
+			++pos_;
+		}
+		if (pos_ >= end_ || *pos_ < '0' || *pos_ > '9')
+		{
+			return false;
+		}
+		while (pos_ < end_ && *pos_ >= '0' && *pos_ <= '9')
+		{
+			out.num = out.num * 10 + (*pos_++ - '0');
+		}
+		if (neg)
+		{
+			out.num = -out.num;
+		}
+		return true;
+	}
+
+	bool read_array(item &out)
+	{
+		out.type = item::ARRAY;
+		expect('[');
+		if (expect(']'))
+		{
+			return true;
+		}
+		do
+		{
+			out.items.emplace_back();
+			if (!read(out.items.back()))
+			{
+				return false;
+			}
+		} while (expect(','));
+		return expect(']');
+	}
+
+	bool read_object(item &out)
+	{
+		out.type = item::MAP;
+		expect('{');
+		if (expect('}'))
+		{
+			return true;
+		}
+		do
+		{
+			out.fields.emplace_back();
+			if (!read_string(out.fields.back().first) || !expect(':') || !read(out.fields.back().second))
+			{
+				return false;
+			}
+		} while (expect(','));
+		return expect('}');
+	}
+
+	const char *pos_;
+	const char *end_;
+};
+
+class cbor_reader
+{
+public:
+	cbor_reader(const uint8_t *p, size_t len) : pos_(p), end_(p + len) {}
+
+	bool read(item &out, int depth = 0)
+	{
+		uint8_t major;
+		uint64_t value;
+
+		if (depth > 8 || !read_head(major, value))
+		{
+			return false;
+		}
+		switch (major)
+		{
+		case 0:
+			out.type = item::INT;
+			out.num = static_cast<int64_t>(value);
+			return true;
+		case 1:
+			out.type = item::INT;
+			out.num = -1 - static_cast<int64_t>(value);
+			return true;
+		case 2:
+		case 3:
+			if (value > static_cast<uint64_t>(end_ - pos_))
+			{
+				return false;
+			}
+			out.type = major == 2 ? item::BYTES : item::TEXT;
+			out.str.assign(reinterpret_cast<const char *>(pos_), value);
+			pos_ += value;
+			return true;
+		case 4:
+			if (value > static_cast<uint64_t>(end_ - pos_))
+			{
+				return false;
+			}
+			out.type = item::ARRAY;
+			out.items.resize(value);
+			for (auto &i : out.items)
+			{
+				if (!read(i, depth + 1))
+				{
+					return false;
+				}
+			}
+			return true;
+		default:
+			return false;
+		}
+	}
+
+private:
+	bool read_head(uint8_t &major, uint64_t &value)
+	{
+		if (pos_ >= end_)
+		{
+			return false;
+		}
+		major = *pos_ >> 5;
+		uint8_t info = *pos_++ & 0x1f;
+
+		if (info < 24)
+		{
+			value = info;
+			return true;
+		}
+		if (info > 27)
+		{
+			return false;
+		}
+		size_t n = size_t(1) << (info - 24);
+		if (static_cast<size_t>(end_ - pos_) < n)
+		{
+			return false;
+		}
+		value = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			value = (value << 8) | *pos_++;
+		}
+		return true;
+	}
+
+	const uint8_t *pos_;
+	const uint8_t *end_;
+};
+
+bool ends_with(const std::string &s, const char *suffix)
+{
+	size_t n = strlen(suffix);
+	return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// "YYYY-MM-DDTHH:MMZ" as written by the firmware
+bool parse_time(const item *it, uint32_t &out)
+{
+	struct tm t = {};
+
+	if (it == nullptr || it->type != item::TEXT ||
+		sscanf(it->str.c_str(), "%4d-%2d-%2dT%2d:%2d", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour,
+			   &t.tm_min) != 5)
+	{
+		return false;
+	}
+	t.tm_year -= 1900;
+	t.tm_mon -= 1;
+	out = static_cast<uint32_t>(timegm(&t));
+	return true;
+}
+
+bool int_at(const item &it, size_t i, int64_t &out)
+{
+	if (it.type != item::ARRAY || i >= it.items.size() || it.items[i].type != item::INT)
+	{
+		return false;
+	}
+	out = it.items[i].num;
+	return true;
+}
+
+// [speed, direction, gust, lull], all zero for a slot without data
+bool add_slot(const item *slot, uint32_t time, std::vector<wind_sample> &out)
+{
+	int64_t v[4];
+
+	if (slot == nullptr)
+	{
+		return false;
+	}
+	for (size_t i = 0; i < 4; ++i)
+	{
+		if (!int_at(*slot, i, v[i]))
+		{
+			return false;
+		}
+	}
+	if (v[0] != 0 || v[1] != 0)
+	{
+		out.push_back({time, uint8_t(v[0]), uint8_t(v[2]), uint8_t(v[3]), uint16_t(v[1])});
+	}
+	return true;
+}
+
+// slots of an hour report are spread evenly over the hour of its time
+bool add_hour(const item *slots, uint32_t time, std::vector<wind_sample> &out)
+{
+	if (slots == nullptr || slots->type != item::ARRAY || slots->items.empty())
+	{
+		return false;
+	}
+	uint32_t start = time - time % 3600;
+	uint32_t step = 3600 / slots->items.size();
+
+	for (size_t i = 0; i < slots->items.size(); ++i)
+	{
+		if (!add_slot(&slots->items[i], start + i * step, out))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool decode_base64(const std::string &in, std::string &out)
+{
+	uint32_t acc = 0;
+	int bits = 0;
+
+	for (char c : in)
+	{
+		int v;
+		if (c >= 'A' && c <= 'Z')
+			v = c - 'A';
+		else if (c >= 'a' && c <= 'z')
+			v = c - 'a' + 26;
+		else if (c >= '0' && c <= '9')
+			v = c - '0' + 52;
+		else if (c == '+')
+			v = 62;
+		else if (c == '/')
+			v = 63;
+		else if (c == '=')
+			break;
+		else
+			return false;
+		acc = (acc << 6) | v;
+		bits += 6;
+		if (bits >= 8)
+		{
+			bits -= 8;
+			out.push_back(char((acc >> bits) & 0xff));
+		}
+	}
+	return true;
+}
+
+// rows of 4 bytes on a 10 minute grid, for the 24 hours ending with the
+// hour of time, direction in 2 degree steps and 0 for no data
+bool add_day(const std::string &rows, uint32_t time, std::vector<wind_sample> &out)
+{
+	if (rows.size() != DAY_ROWS * 4)
+	{
+		return false;
+	}
+	uint32_t start = time - time % 3600 - 23 * 3600;
+
+	for (size_t i = 0; i < DAY_ROWS; ++i)
+	{
+		const uint8_t *r = reinterpret_cast<const uint8_t *>(rows.data()) + i * 4;
+
+		if (r[1] != 0)
+		{
+			out.push_back({uint32_t(start + i * DAY_ROW_SECONDS), r[0], r[2], r[3], uint16_t(r[1] * 2)});
+		}
+	}
+	return true;
+}
+
+bool parse_json(const std::string &topic, const item &root, uint32_t now, parsed_report &out)
+{
+	uint32_t time;
+
+	const item *station = root.get("station");
+
+	if (root.type != item::MAP || station == nullptr || station->type != item::TEXT)
+	{
+		return false;
+	}
+	out.station = station->str;
+	if (ends_with(topic, "/health"))
+	{
+		const item *bat = root.get("bat");
+		const item *f[5];
+		const char *keys[5] = {"mv", "temp", "soc", "tier", "hours"};
+
+		if (bat == nullptr)
+		{
+			return false;
+		}
+		for (int i = 0; i < 5; ++i)
+		{
+			f[i] = bat->get(keys[i]);
+			if (f[i] == nullptr || f[i]->type != item::INT)
+			{
+				return false;
+			}
+		}
+		out.type = parsed_report::HEALTH;
+		out.health = {now, uint16_t(f[0]->num), int16_t(f[1]->num), uint8_t(f[2]->num),
+					  uint8_t(f[3]->num), uint16_t(f[4]->num)};
+		return true;
+	}
+
+	if (!parse_time(root.get("time"), time))
+	{
+		return false;
+	}
+	out.type = parsed_report::WIND;
+	if (ends_with(topic, "/wind/day"))
+	{
+		const item *day = root.get("day");
+		std::string rows;
+
+		return day && day->type == item::TEXT && decode_base64(day->str, rows) && add_day(rows, time, out.wind);
+	}
+	if (root.get("slot"))
+	{
+		return add_slot(root.get("wind"), time, out.wind);
+	}
+	return add_hour(root.get("wind"), time, out.wind);
+}
+
+bool parse_cbor(const std::string &topic, const item &root, uint32_t now, parsed_report &out)
+{
+	int64_t version;
+	int64_t time;
+
+	if (!int_at(root, 0, version) || version != PAYLOAD_VERSION || root.items.size() < 3 ||
+		root.items[1].type != item::TEXT)
+	{
+		return false;
+	}
+	out.station = root.items[1].str;
+	if (ends_with(topic, "/health"))
+	{
+		int64_t v[5];
+
+		for (size_t i = 0; i < 5; ++i)
+		{
+			if (!int_at(root.items[2], i, v[i]))
+			{
+				return false;
+			}
+		}
+		out.type = parsed_report::HEALTH;
+		out.health = {now, uint16_t(v[0]), int16_t(v[1]), uint8_t(v[2]), uint8_t(v[3]), uint16_t(v[4])};
+		return true;
+	}
+
+	if (!int_at(root, 2, time))
+	{
+		return false;
+	}
+	out.type = parsed_report::WIND;
+	switch (root.items.size())
+	{
+	case 5: // slot: [version, station, time, index, [s, d, g, l]]
+		return add_slot(&root.items[4], uint32_t(time), out.wind);
+	case 4:
+		if (root.items[3].type == item::BYTES)
+		{
+			return add_day(root.items[3].str, uint32_t(time), out.wind);
+		}
+		return add_hour(&root.items[3], uint32_t(time), out.wind);
+	default:
+		return false;
+	}
+}
+
+} // namespace
+
+std::string topic_station(const std::string &topic)
+{
+	size_t pos = topic.rfind("/wind/");
+
+	if (pos == std::string::npos && ends_with(topic, "/health"))
+	{
+		pos = topic.size() - strlen("/health");
+	}
+	if (pos == std::string::npos || pos == 0)
+	{
+		return std::string();
+	}
+	return topic.substr(0, pos);
+}
+
+bool parse_report(const std::string &topic, const uint8_t *payload, size_t len, uint32_t now,
+				  parsed_report &out)
+{
+	item root;
+
+	out = parsed_report();
+	if (len == 0)
+	{
+		return false; // a cleared retained topic
+	}
+	if (payload[0] == '{')
+	{
+		return json_reader(payload, len).read(root) && parse_json(topic, root, now, out);
+	}
+	return cbor_reader(payload, len).read(root) && parse_cbor(topic, root, now, out);
+}
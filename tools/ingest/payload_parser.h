@@ -0,0 +1,62 @@
+#ifndef _PAYLOAD_PARSER_H_
+#define _PAYLOAD_PARSER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Decoder for the station reports, JSON or CBOR as encoded by src/payload.c.
+// Every form of wind report is flattened to timed samples, so the store does
+// not care whether a slot came from a delta, an hour or the day summary.
+
+struct wind_sample
+{
+	uint32_t time; // unix time of the report slot start
+	uint8_t speed; // mph
+	uint8_t gust;
+	uint8_t lull;
+	uint16_t direction; // degrees
+};
+
+struct health_sample
+{
+	uint32_t time; // arrival, the health report carries no time
+	uint16_t mv;
+	int16_t temp_f;
+	uint8_t soc;
+	uint8_t tier;
+	uint16_t hours_left;
+};
+
+struct parsed_report
+{
+	enum kind
+	{
+		NONE,
+		WIND,
+		HEALTH,
+	} type = NONE;
+	std::string station; // as named in the payload
+	std::vector<wind_sample> wind;
+	health_sample health{};
+};
+
+/**
+ * @brief Station of a topic, the levels before "/wind" or "/health",
+ * <primary>/<station> for the firmware topics.
+ *
+ * @return std::string - empty if the topic is not a station report.
+ */
+std::string topic_station(const std::string &topic);
+
+/**
+ * @brief Decode a report.
+ *
+ * @param now - unix time used for reports that carry no time.
+ * @return bool - false if the payload is malformed or of an unknown version.
+ */
+bool parse_report(const std::string &topic, const uint8_t *payload, size_t len, uint32_t now,
+				  parsed_report &out);
+
+#endif /* _PAYLOAD_PARSER_H_ */
@@ -0,0 +1,196 @@
+#include "station_store.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr uint32_t SECONDS_PER_HOUR = 3600;
+constexpr uint32_t SECONDS_PER_DAY = 24 * SECONDS_PER_HOUR;
+constexpr float DEG_PER_RAD = 180.0f / 3.14159265f;
+
+template <typename... C>
+size_t min_size(const C &...c)
+{
+	return std::min({c.size()...});
+}
+
+template <typename... C>
+void truncate_all(size_t n, C &...c)
+{
+	(c.truncate(n), ...);
+}
+
+template <typename... C>
+void sync_all(C &...c)
+{
+	(c.sync(), ...);
+}
+
+// append, or insert before index i, value by value
+template <typename T, typename V>
+void put(column_file<T> &c, size_t i, V value)
+{
+	if (i == c.size())
+	{
+		c.append(T(value));
+	}
+	else
+	{
+		c.insert(i, T(value));
+	}
+}
+
+// first index with time >= t
+size_t lower(const column_file<uint32_t> &time, uint32_t t)
+{
+	return std::lower_bound(time.data(), time.data() + time.size(), t) - time.data();
+}
+} // namespace
+
+bool station_store::rollup_columns::open(const std::string &dir, const char *name, uint32_t p)
+{
+	std::string base = dir + "/" + name + ".";
+
+	period = p;
+	if (!time.open(base + "time") || !count.open(base + "count") || !speed_sum.open(base + "speed_sum") ||
+		!gust.open(base + "gust") || !lull.open(base + "lull") || !dir_x.open(base + "dir_x") ||
+		!dir_y.open(base + "dir_y"))
+	{
+		return false;
+	}
+	// a torn append leaves some columns one longer
+	truncate(min_size(time, count, speed_sum, gust, lull, dir_x, dir_y));
+	return true;
+}
+
+void station_store::rollup_columns::truncate(size_t n)
+{
+	truncate_all(n, time, count, speed_sum, gust, lull, dir_x, dir_y);
+}
+
+void station_store::rollup_columns::sync()
+{
+	sync_all(time, count, speed_sum, gust, lull, dir_x, dir_y);
+}
+
+void station_store::rollup_columns::add(const wind_sample &s)
+{
+	uint32_t bucket = s.time - s.time % period;
+	float weight = std::max<float>(s.speed, 1.0f); // calm still has a direction
+	float x = weight * std::cos(s.direction / DEG_PER_RAD);
+	float y = weight * std::sin(s.direction / DEG_PER_RAD);
+
+	// the newest bucket, unless the sample came late
+	size_t i = (size() > 0 && time.back() <= bucket) ? size() - (time.back() == bucket) : lower(time, bucket);
+
+	if (i < size() && time[i] == bucket)
+	{
+		++count[i];
+		speed_sum[i] += s.speed;
+		gust[i] = std::max(gust[i], s.gust);
+		lull[i] = std::min(lull[i], s.lull);
+		dir_x[i] += x;
+		dir_y[i] += y;
+		return;
+	}
+	// time goes last, an appended bucket only counts once every column has it
+	put(count, i, 1);
+	put(speed_sum, i, s.speed);
+	put(gust, i, s.gust);
+	put(lull, i, s.lull);
+	put(dir_x, i, x);
+	put(dir_y, i, y);
+	put(time, i, bucket);
+}
+
+bool station_store::open(const std::string &dir)
+{
+	mkdir(dir.c_str(), 0755);
+
+	if (!time_.open(dir + "/time") || !speed_.open(dir + "/speed") || !direction_.open(dir + "/direction") ||
+		!gust_.open(dir + "/gust") || !lull_.open(dir + "/lull"))
+	{
+		return false;
+	}
+	truncate_all(min_size(time_, speed_, direction_, gust_, lull_), time_, speed_, direction_, gust_, lull_);
+
+	if (!health_time_.open(dir + "/health.time") || !health_mv_.open(dir + "/health.mv") ||
+		!health_temp_.open(dir + "/health.temp") || !health_soc_.open(dir + "/health.soc") ||
+		!health_tier_.open(dir + "/health.tier") || !health_hours_.open(dir + "/health.hours"))
+	{
+		return false;
+	}
+	truncate_all(min_size(health_time_, health_mv_, health_temp_, health_soc_, health_tier_, health_hours_),
+				 health_time_, health_mv_, health_temp_, health_soc_, health_tier_, health_hours_);
+
+	return hourly_.open(dir, "hourly", SECONDS_PER_HOUR) && daily_.open(dir, "daily", SECONDS_PER_DAY);
+}
+
+bool station_store::add(const wind_sample &s)
+{
+	// appended in the common case, without a search
+	size_t i = (time_.size() == 0 || s.time > time_.back()) ? time_.size() : lower(time_, s.time);
+
+	if (i < time_.size() && time_[i] == s.time)
+	{
+		++skipped_;
+		return false;
+	}
+
+	put(speed_, i, s.speed);
+	put(direction_, i, s.direction);
+	put(gust_, i, s.gust);
+	put(lull_, i, s.lull);
+	put(time_, i, s.time);
+
+	hourly_.add(s);
+	daily_.add(s);
+	return true;
+}
+
+void station_store::add(const health_sample &h)
+{
+	health_mv_.append(h.mv);
+	health_temp_.append(h.temp_f);
+	health_soc_.append(h.soc);
+	health_tier_.append(h.tier);
+	health_hours_.append(h.hours_left);
+	health_time_.append(h.time);
+}
+
+void station_store::samples(uint32_t from, uint32_t to, std::vector<wind_sample> &out) const
+{
+	size_t end = lower(time_, to);
+
+	out.clear();
+	for (size_t i = lower(time_, from); i < end; ++i)
+	{
+		out.push_back({time_[i], speed_[i], gust_[i], lull_[i], direction_[i]});
+	}
+}
+
+void station_store::rollups(rollup_level level, uint32_t from, uint32_t to, std::vector<wind_rollup> &out) const
+{
+	const rollup_columns &r = level == rollup_level::HOURLY ? hourly_ : daily_;
+	size_t end = lower(r.time, to);
+
+	out.clear();
+	for (size_t i = lower(r.time, from); i < end; ++i)
+	{
+		float deg = std::atan2(r.dir_y[i], r.dir_x[i]) * DEG_PER_RAD;
+
+		out.push_back({r.time[i], r.count[i], uint8_t(r.speed_sum[i] / r.count[i]), r.gust[i], r.lull[i],
+					   uint16_t(std::lround(deg + 360.0f) % 360)});
+	}
+}
+
+void station_store::sync()
+{
+	sync_all(time_, speed_, direction_, gust_, lull_);
+	sync_all(health_time_, health_mv_, health_temp_, health_soc_, health_tier_, health_hours_);
+	hourly_.sync();
+	daily_.sync();
+}
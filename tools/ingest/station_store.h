@@ -0,0 +1,112 @@
+#ifndef _STATION_STORE_H_
+#define _STATION_STORE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "column_file.h"
+#include "payload_parser.h"
+
+// Wind history of one station in a directory of append-only columns. Raw
+// report slots are kept as they arrive, hourly and daily rollups are updated
+// on ingest, so a query over years reads a few thousand rows.
+//
+// Samples usually arrive in time order, the station keeps new reports
+// behind its store-and-forward backlog, and are appended. A late one, a
+// report lost in transit and sent again with its hour, is inserted in place
+// and added to its rollups. A sample for a slot time already stored is a
+// redelivery or already came with a delta, and is skipped.
+
+// aggregate of the samples in one rollup bucket
+struct wind_rollup
+{
+	uint32_t time; // bucket start
+	uint16_t count;
+	uint8_t speed; // mean
+	uint8_t gust;  // highest
+	uint8_t lull;  // lowest
+	uint16_t direction; // speed weighted vector mean
+};
+
+enum class rollup_level
+{
+	HOURLY,
+	DAILY,
+};
+
+class station_store
+{
+public:
+	/**
+	 * @brief Open or create the store in dir.
+	 *
+	 * @return bool - false if a column can not be mapped.
+	 */
+	bool open(const std::string &dir);
+
+	/**
+	 * @brief Store a sample in time order and update the rollups.
+	 *
+	 * @return bool - false if it was skipped, a sample for its time is stored.
+	 */
+	bool add(const wind_sample &s);
+
+	void add(const health_sample &h);
+
+	/**
+	 * @brief Raw samples with from <= time < to.
+	 */
+	void samples(uint32_t from, uint32_t to, std::vector<wind_sample> &out) const;
+
+	/**
+	 * @brief Rollup buckets starting in from <= time < to.
+	 */
+	void rollups(rollup_level level, uint32_t from, uint32_t to, std::vector<wind_rollup> &out) const;
+
+	size_t sample_count() const { return time_.size(); }
+	size_t health_count() const { return health_time_.size(); }
+	uint64_t skipped() const { return skipped_; }
+
+	void sync();
+
+private:
+	// running sums of one bucket, the vector mean needs more than the
+	// published row
+	struct rollup_columns
+	{
+		uint32_t period;
+		column_file<uint32_t> time;
+		column_file<uint16_t> count;
+		column_file<uint32_t> speed_sum;
+		column_file<uint8_t> gust;
+		column_file<uint8_t> lull;
+		column_file<float> dir_x; // speed weighted unit vectors
+		column_file<float> dir_y;
+
+		bool open(const std::string &dir, const char *name, uint32_t period);
+		void add(const wind_sample &s);
+		size_t size() const { return time.size(); }
+		void truncate(size_t n);
+		void sync();
+	};
+
+	column_file<uint32_t> time_;
+	column_file<uint8_t> speed_;
+	column_file<uint16_t> direction_;
+	column_file<uint8_t> gust_;
+	column_file<uint8_t> lull_;
+
+	column_file<uint32_t> health_time_;
+	column_file<uint16_t> health_mv_;
+	column_file<int16_t> health_temp_;
+	column_file<uint8_t> health_soc_;
+	column_file<uint8_t> health_tier_;
+	column_file<uint16_t> health_hours_;
+
+	rollup_columns hourly_;
+	rollup_columns daily_;
+	uint64_t skipped_ = 0;
+};
+
+#endif /* _STATION_STORE_H_ */
@@ -0,0 +1,168 @@
+// Report encoder benchmark.
+//
+//   payload_bench [encodes]
+//
+// Encodes each report of the station, a full hour of wind, a single slot,
+// the 24 hour summary and a health report, with the CBOR and the JSON
+// encoders of src/payload.c. Prints bytes per report, the payload the modem
+// sends on every publish, and cycles per encode. Host cycles only rank the
+// encoders, a Cortex-M33 pays more for the printf in the JSON path.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+extern "C"
+{
+#include "payload.h"
+
+int json_payload_wind(uint8_t *buf, size_t size, const char *station, time_t time, const struct w_sensor *slots,
+					  int count);
+int json_payload_wind_slot(uint8_t *buf, size_t size, const char *station, time_t time, int index,
+						   const struct w_sensor *slot);
+int json_payload_wind_day(uint8_t *buf, size_t size, const char *station, time_t time, const uint8_t *rows);
+int json_payload_health(uint8_t *buf, size_t size, const char *station, const struct battery_status *bat,
+						const struct activity_delta *act);
+}
+
+namespace
+{
+
+constexpr int SLOTS = 6;		// a 10 minute report interval
+constexpr size_t BUF_SIZE = 896; // CONFIG_MQTT_MSG_PAYLOAD_SIZE for JSON
+constexpr const char *STATION = "351358811234567"; // an IMEI
+constexpr time_t TIME = 1790000000;
+
+uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+const char *tick_unit()
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return "cycles";
+#else
+	return "ns";
+#endif
+}
+
+struct reports
+{
+	struct w_sensor slots[SLOTS];
+	uint8_t day[WIND_DAY_SIZE];
+	struct battery_status bat;
+	struct activity_delta act;
+};
+
+// a breezy hour and a day of rows, in the ranges the station reports
+reports make_reports()
+{
+	std::mt19937 rng(1);
+	reports r = {};
+
+	for (auto &s : r.slots)
+	{
+		s.speed = 8 + rng() % 10;
+		s.gust = s.speed + rng() % 12;
+		s.lull = s.speed - rng() % 6;
+		s.direction = rng() % 360;
+	}
+	for (auto &b : r.day)
+	{
+		b = rng();
+	}
+	r.bat = {3712, 14, 63, 1, 812};
+	for (auto &c : r.act.count)
+	{
+		c = rng() % 4000;
+	}
+	r.act.connected_s = 95;
+	r.act.idle_s = 310;
+	r.act.sleep_s = 3195;
+	r.act.charge_uah = 2210;
+	r.act.modem_tx_kb = 9;
+	r.act.modem_rx_kb = 3;
+	return r;
+}
+
+template <typename F>
+double time_per_call(long encodes, F encode)
+{
+	volatile int sink = 0;
+	int sum = 0;
+	uint64_t start = ticks();
+
+	for (long n = 0; n < encodes; ++n)
+	{
+		sum += encode();
+	}
+	uint64_t elapsed = ticks() - start;
+	sink = sum;
+	(void)sink;
+	return double(elapsed) / encodes;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	long encodes = argc > 1 ? atol(argv[1]) : 1 << 20;
+	static uint8_t buf[BUF_SIZE];
+	const reports r = make_reports();
+
+	if (encodes < 1)
+	{
+		fprintf(stderr, "usage: payload_bench [encodes]\n");
+		return 2;
+	}
+
+	struct
+	{
+		const char *name;
+		int (*cbor)(uint8_t *, const reports &);
+		int (*json)(uint8_t *, const reports &);
+	} cases[] = {
+		{"wind hour",
+		 [](uint8_t *b, const reports &r) { return payload_wind(b, BUF_SIZE, STATION, TIME, r.slots, SLOTS); },
+		 [](uint8_t *b, const reports &r) { return json_payload_wind(b, BUF_SIZE, STATION, TIME, r.slots, SLOTS); }},
+		{"wind slot",
+		 [](uint8_t *b, const reports &r) { return payload_wind_slot(b, BUF_SIZE, STATION, TIME, 3, &r.slots[3]); },
+		 [](uint8_t *b, const reports &r) {
+			 return json_payload_wind_slot(b, BUF_SIZE, STATION, TIME, 3, &r.slots[3]);
+		 }},
+		{"wind day", [](uint8_t *b, const reports &r) { return payload_wind_day(b, BUF_SIZE, STATION, TIME, r.day); },
+		 [](uint8_t *b, const reports &r) { return json_payload_wind_day(b, BUF_SIZE, STATION, TIME, r.day); }},
+		{"health", [](uint8_t *b, const reports &r) { return payload_health(b, BUF_SIZE, STATION, &r.bat, &r.act); },
+		 [](uint8_t *b, const reports &r) { return json_payload_health(b, BUF_SIZE, STATION, &r.bat, &r.act); }},
+	};
+
+	printf("%ld encodes each, station \"%s\", %d slots an hour\n", encodes, STATION, SLOTS);
+	printf("  %-10s %8s %8s %12s %12s\n", "", "cbor B", "json B", "cbor", "json");
+	printf("  %-10s %8s %8s %12s %12s\n", "", "", "", tick_unit(), tick_unit());
+	for (const auto &c : cases)
+	{
+		int cbor_len = c.cbor(buf, r);
+		int json_len = c.json(buf, r);
+
+		if (cbor_len < 0 || json_len < 0)
+		{
+			fprintf(stderr, "%s does not fit in %zu bytes\n", c.name, BUF_SIZE);
+			return 1;
+		}
+		printf("  %-10s %8d %8d %12.1f %12.1f\n", c.name, cbor_len, json_len,
+			   time_per_call(encodes, [&]() { return c.cbor(buf, r); }),
+			   time_per_call(encodes, [&]() { return c.json(buf, r); }));
+	}
+	return 0;
+}
@@ -0,0 +1,221 @@
+// Speed measurement accuracy on the simulated traces.
+//
+//   rate_accuracy [hours]
+//
+// Replays the recorded trace and synthetic traces of several mean rates
+// through src/wind_trace.c, the edges the SIM backend sees, and measures
+// them the way the acquisition thread does, once counting only and once
+// with period measurement below the default 20 Hz, and above it for up to
+// 10 s. Every gust window is compared with the true rate of the trace over
+// the same seconds, every 10 minute report with the true mean, gust and
+// lull. Errors are in mph through the default speed calibration, before the
+// firmware truncates to whole mph, a truncated error only tells which side
+// of a boundary a reading fell.
+//
+// Exits 1 if period measurement misses a bound below, registered with
+// ctest over the default 24 hours.
+
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+
+extern "C"
+{
+#include "calib.h"
+#include "wind_bins.h"
+#include "wind_rate.h"
+#include "wind_trace.h"
+}
+
+namespace
+{
+
+constexpr uint32_t PERIOD_MAX_HZ = 20; // CONFIG_WIND_PERIOD_MAX_HZ
+constexpr uint32_t PULSE_MAX_HZ = 100; // CONFIG_WIND_PULSE_MAX_HZ
+constexpr uint32_t REPORT_S = 600;
+
+// what the firmware runs, period measurement, must stay within these, mph
+constexpr double MAX_ERROR[] = {0.25, 0.01, 0.2, 0.3}; // window rms, mean, gust, lull mae
+// and on the synthetic traces within this of counting, in every column
+constexpr double SYNTH_TOLERANCE = 0.005;
+// The recorded trace is 32 rows of whole pulses repeated, every report
+// sees the same gust window and counting happens to land on it exactly,
+// at a 6 s window and a 10 s tick period measurement is up to 0.053 mph
+// behind there. One window seen over and over, not a statistic.
+constexpr double RECORDED_TOLERANCE = 0.06;
+
+struct trace
+{
+	const char *name;
+	uint16_t mean_hz; // 0 is the recorded trace
+};
+
+struct result
+{
+	// window rms, mean, gust and lull mae, the columns of the report
+	std::array<double, 4> errors() const
+	{
+		return {std::sqrt(window_sq / windows), mean_err / reports, gust_err / reports, lull_err / reports};
+	}
+
+	double window_sq = 0; // window rate error squared, mph
+	uint32_t windows = 0;
+	double mean_err = 0; // absolute report errors, mph, summed
+	double gust_err = 0;
+	double lull_err = 0;
+	uint32_t reports = 0;
+	uint32_t ticks = 0;
+	uint32_t timed = 0;
+};
+
+double mph(uint32_t mhz)
+{
+	return calib_convert(CALIB_SPEED, mhz) / 1000.0;
+}
+
+double mph_error(uint32_t measured_mhz, uint32_t true_mhz)
+{
+	return std::fabs(mph(measured_mhz) - mph(true_mhz));
+}
+
+result run(const trace &t, uint8_t tick_s, uint8_t window_s, uint32_t seconds, bool period)
+{
+	struct wind_rate wr;
+	struct wind_period report;
+	std::deque<uint32_t> window, truth; // per tick, thousandths of a pulse
+	uint32_t window_bins = window_s / tick_s;
+	uint32_t edge_us = 0;
+	uint32_t report_pulses = 0; // true, in the report so far
+	uint32_t true_gust = 0;
+	uint32_t true_lull = UINT32_MAX;
+	result r;
+
+	wind_trace_init(t.mean_hz, 1);
+	wind_rate_init(&wr, period ? PERIOD_MAX_HZ : 0);
+	wind_bins_configure(tick_s, window_bins);
+	wind_bins_period_take(&report);
+
+	for (uint32_t elapsed = tick_s; elapsed <= seconds; elapsed += tick_s)
+	{
+		struct pulse_reading reading = {};
+		uint32_t true_mpulses = 0;
+
+		reading.timed = wr.timing;
+		for (int s = 0; s < tick_s; ++s)
+		{
+			reading.pulses += wind_trace_second(&edge_us);
+			true_mpulses += wind_trace_rate();
+		}
+		reading.edge_us = edge_us;
+		reading.now_us = wind_trace_time_us();
+
+		uint32_t mpulses = wind_rate_update(&wr, &reading, tick_s * 1000000);
+
+		mpulses = std::min(mpulses, PULSE_MAX_HZ * tick_s * 1000);
+		wind_bins_add(mpulses);
+		++r.ticks;
+		r.timed += reading.timed;
+		report_pulses += true_mpulses;
+
+		window.push_back(mpulses);
+		truth.push_back(true_mpulses);
+		if (window.size() > window_bins)
+		{
+			window.pop_front();
+			truth.pop_front();
+		}
+		if (window.size() == window_bins)
+		{
+			uint32_t measured = 0;
+			uint32_t actual = 0;
+
+			for (size_t i = 0; i < window.size(); ++i)
+			{
+				measured += window[i];
+				actual += truth[i];
+			}
+			measured /= window_bins * tick_s;
+			actual /= window_bins * tick_s;
+
+			double err = mph(measured) - mph(actual);
+			r.window_sq += err * err;
+			++r.windows;
+			true_gust = std::max(true_gust, actual);
+			true_lull = std::min(true_lull, actual);
+		}
+
+		if (elapsed % REPORT_S == 0)
+		{
+			wind_bins_period_take(&report);
+			r.mean_err += mph_error(report.mpulses / report.seconds, report_pulses / REPORT_S);
+			r.gust_err += mph_error(report.gust_mhz, true_gust);
+			r.lull_err += mph_error(report.lull_mhz, true_lull);
+			++r.reports;
+			report_pulses = 0;
+			true_gust = 0;
+			true_lull = UINT32_MAX;
+		}
+	}
+	return r;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	double hours = argc > 1 ? atof(argv[1]) : 24;
+	uint32_t seconds = uint32_t(hours * 3600) / REPORT_S * REPORT_S;
+
+	if (seconds == 0)
+	{
+		fprintf(stderr, "usage: rate_accuracy [hours]\n");
+		return 2;
+	}
+	calib_init();
+
+	const trace traces[] = {
+		{"recorded", 0}, {"synth 1 Hz", 1}, {"synth 2 Hz", 2}, {"synth 3 Hz", 3},
+		{"synth 6 Hz", 6}, {"synth 12 Hz", 12}, {"synth 25 Hz", 25},
+	};
+	// the fast and slow command presets and the 6 s window
+	const struct
+	{
+		uint8_t tick_s;
+		uint8_t window_s;
+	} configs[] = {{1, 3}, {1, 6}, {10, 10}};
+
+	const char *columns[] = {"window rms", "mean mae", "gust mae", "lull mae"};
+	int failures = 0;
+
+	printf("%.1f hours per trace, count / period, mph\n", seconds / 3600.0);
+	for (const auto &c : configs)
+	{
+		printf("\ntick %u s, gust window %u s\n", c.tick_s, c.window_s);
+		printf("  %-12s %15s %15s %15s %15s %6s\n", "trace", columns[0], columns[1], columns[2], columns[3],
+			   "timed");
+		for (const auto &t : traces)
+		{
+			auto count = run(t, c.tick_s, c.window_s, seconds, false);
+			auto period = run(t, c.tick_s, c.window_s, seconds, true);
+			auto ce = count.errors();
+			auto pe = period.errors();
+
+			printf("  %-12s %7.3f/%-7.3f %7.3f/%-7.3f %7.3f/%-7.3f %7.3f/%-7.3f %5.0f%%\n", t.name, ce[0], pe[0],
+				   ce[1], pe[1], ce[2], pe[2], ce[3], pe[3], 100.0 * period.timed / period.ticks);
+			for (size_t i = 0; i < pe.size(); ++i)
+			{
+				double tolerance = t.mean_hz ? SYNTH_TOLERANCE : RECORDED_TOLERANCE;
+
+				if (pe[i] > MAX_ERROR[i] || pe[i] > ce[i] + tolerance)
+				{
+					printf("  FAILED %s %s: period %.3f, count %.3f, bound %.3f\n", t.name, columns[i], pe[i],
+						   ce[i], MAX_ERROR[i]);
+					++failures;
+				}
+			}
+		}
+	}
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,289 @@
+// Replay of the report path against golden files.
+//
+//   replay <scenario>                      print the published stream
+//   replay <scenario> --check <golden>     compare, exit 1 on a difference
+//   replay <scenario> --update <golden>    rewrite the golden file
+//   replay --list
+//
+// Boots the station on a wind trace in virtual time and records every
+// message it publishes: wall clock time, topic, QoS, retain and the payload,
+// CBOR in diagnostic notation. A scenario can change the cadence or the
+// power tier on the way, as a command or the battery would.
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+extern "C"
+{
+#include <date_time.h>
+#include <zephyr/logging/log.h>
+
+#include "battery.h"
+#include "calib.h"
+#include "station_sim.h"
+#include "wind_sensor.h"
+}
+
+namespace
+{
+
+constexpr int64_t HOUR_MS = 3600 * 1000;
+
+struct event
+{
+	int64_t at_ms; // uptime
+	std::function<void()> apply;
+};
+
+struct scenario
+{
+	const char *name;
+	uint16_t mean_hz; // 0 replays the recorded trace
+	uint32_t seed;
+	int64_t boot_unix_ms;
+	int hours;
+	std::vector<event> events;
+};
+
+void set_config(uint8_t period_s, uint8_t duration_s, uint8_t report_minutes)
+{
+	struct wind_config cfg = {period_s, duration_s, report_minutes};
+
+	wind_sensor_set_config(&cfg);
+}
+
+// 2026-03-01 05:53:20 UTC, boots mid slot
+constexpr int64_t BOOT_MS = 1772344400LL * 1000;
+
+const std::vector<scenario> &scenarios()
+{
+	static const std::vector<scenario> all = {
+		// the default cadence on the recorded gusty afternoon
+		{"recorded", 0, 0, BOOT_MS, 6, {}},
+		// the slow preset from the second hour, 10 s bins and gust window
+		{"synth_6hz_slow", 6, 1, BOOT_MS, 4, {{HOUR_MS, [] { set_config(10, 10, 10); }}}},
+		// 5 minute reports, then the saving tier, then back
+		{"synth_12hz_saving",
+		 12,
+		 7,
+		 BOOT_MS,
+		 5,
+		 {{0, [] { set_config(1, 3, 5); }},
+		  {2 * HOUR_MS, [] { wind_sensor_set_power_tier(POWER_TIER_SAVING); }},
+		  {4 * HOUR_MS, [] { wind_sensor_set_power_tier(POWER_TIER_NORMAL); }}}},
+	};
+	return all;
+}
+
+std::vector<std::string> published;
+
+// CBOR diagnostic notation (RFC 8949 section 8) of what payload.c writes
+size_t cbor_diag(const uint8_t *p, size_t len, std::string &out)
+{
+	if (len == 0)
+	{
+		out += "<truncated>";
+		return 0;
+	}
+	uint8_t major = p[0] >> 5;
+	uint8_t info = p[0] & 0x1f;
+	size_t n = 1;
+	uint64_t value = info;
+
+	if (info >= 24 && info <= 27)
+	{
+		size_t bytes = size_t(1) << (info - 24);
+
+		if (len < 1 + bytes)
+		{
+			out += "<truncated>";
+			return len;
+		}
+		value = 0;
+		for (size_t i = 0; i < bytes; ++i)
+		{
+			value = (value << 8) | p[1 + i];
+		}
+		n += bytes;
+	}
+
+	char buf[32];
+
+	switch (major)
+	{
+	case 0:
+		snprintf(buf, sizeof(buf), "%" PRIu64, value);
+		out += buf;
+		break;
+	case 1:
+		snprintf(buf, sizeof(buf), "-%" PRIu64, value + 1);
+		out += buf;
+		break;
+	case 2:
+	case 3:
+		if (len < n + value)
+		{
+			out += "<truncated>";
+			return len;
+		}
+		if (major == 2)
+		{
+			out += "h'";
+			for (uint64_t i = 0; i < value; ++i)
+			{
+				snprintf(buf, sizeof(buf), "%02x", p[n + i]);
+				out += buf;
+			}
+			out += "'";
+		}
+		else
+		{
+			out += '"' + std::string((const char *)p + n, value) + '"';
+		}
+		n += value;
+		break;
+	case 4:
+		out += "[";
+		for (uint64_t i = 0; i < value; ++i)
+		{
+			out += i ? ", " : "";
+			n += cbor_diag(p + n, len - n, out);
+		}
+		out += "]";
+		break;
+	default:
+		out += "<unexpected>";
+		return len;
+	}
+	return n;
+}
+
+void record(const struct mqtt_msg *msg)
+{
+	int64_t unix_ms;
+	char head[160];
+	std::string line;
+
+	date_time_now(&unix_ms);
+	time_t t = unix_ms / 1000;
+	struct tm tm;
+
+	gmtime_r(&t, &tm);
+	snprintf(head, sizeof(head), "%02d:%02d:%02d %s q%u%s ", tm.tm_hour, tm.tm_min, tm.tm_sec, msg->topic, msg->qos,
+			 msg->retain ? " retained" : "");
+	line = head;
+	if (msg->len && msg->payload[0] == '{')
+	{
+		line.append((const char *)msg->payload, msg->len);
+	}
+	else if (cbor_diag(msg->payload, msg->len, line) != msg->len)
+	{
+		line += " <trailing bytes>";
+	}
+	published.push_back(line);
+}
+
+void run(const scenario &s)
+{
+	replay_trace_mean_hz = s.mean_hz;
+	replay_trace_seed = s.seed;
+	shim_date_time_set(s.boot_unix_ms);
+	station_sim_on_publish(record);
+	calib_init();
+
+	if (init_wind_sensor() != 0)
+	{
+		fprintf(stderr, "station failed to start\n");
+		return;
+	}
+	for (const auto &e : s.events)
+	{
+		shim_run(e.at_ms);
+		e.apply();
+	}
+	shim_run(s.hours * HOUR_MS);
+}
+
+int check(const char *path)
+{
+	std::ifstream in(path);
+	std::string line;
+	size_t i = 0;
+
+	if (!in)
+	{
+		fprintf(stderr, "no golden file %s\n", path);
+		return 1;
+	}
+	for (; std::getline(in, line); ++i)
+	{
+		if (i >= published.size() || line != published[i])
+		{
+			fprintf(stderr, "line %zu differs\n  golden: %s\n  replay: %s\n", i + 1, line.c_str(),
+					i < published.size() ? published[i].c_str() : "<end>");
+			return 1;
+		}
+	}
+	if (i != published.size())
+	{
+		fprintf(stderr, "line %zu differs\n  golden: <end>\n  replay: %s\n", i + 1, published[i].c_str());
+		return 1;
+	}
+	printf("%zu messages match %s\n", i, path);
+	return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	const scenario *s = nullptr;
+
+	if (argc == 2 && strcmp(argv[1], "--list") == 0)
+	{
+		for (const auto &sc : scenarios())
+		{
+			printf("%s\n", sc.name);
+		}
+		return 0;
+	}
+	for (const auto &sc : scenarios())
+	{
+		if (argc > 1 && strcmp(argv[1], sc.name) == 0)
+		{
+			s = &sc;
+		}
+	}
+	if (s == nullptr || (argc != 2 && argc != 4))
+	{
+		fprintf(stderr, "usage: replay <scenario> [--check|--update <golden>], replay --list\n");
+		return 2;
+	}
+
+	shim_log_level = getenv("REPLAY_LOG") ? LOG_LEVEL_DBG : LOG_LEVEL_ERR;
+	run(*s);
+
+	if (argc == 4 && strcmp(argv[2], "--check") == 0)
+	{
+		return check(argv[3]);
+	}
+	FILE *out = stdout;
+
+	if (argc == 4 && (out = fopen(argv[3], "w")) == nullptr)
+	{
+		perror(argv[3]);
+		return 1;
+	}
+	for (const auto &line : published)
+	{
+		fprintf(out, "%s\n", line.c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,173 @@
+#include <zephyr/kernel.h>
+#include <zephyr/net/mqtt.h>
+
+#include "acquisition.h"
+#include "health.h"
+#include "leds.h"
+#include "power.h"
+#include "pulse_counter.h"
+#include "station_sim.h"
+#include "wind_rate.h"
+#include "wind_trace.h"
+
+uint16_t replay_trace_mean_hz;
+uint32_t replay_trace_seed;
+
+static station_publish_cb publish_cb;
+
+// the acquisition thread, one sample per tick of the virtual clock
+
+static void tick_work_cb(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(tick_work, tick_work_cb);
+
+static struct acq_sample pending[CONFIG_WIND_ACQ_RING_SIZE];
+static uint32_t head;
+static uint32_t tail;
+static void (*ready_cb)(void);
+static struct wind_rate rate;
+static bool timing;
+static bool timing_allowed = true;
+static uint32_t tick_us = USEC_PER_SEC;
+static uint32_t ticks;
+static uint32_t timed;
+
+static void tick_work_cb(struct k_work *work)
+{
+	struct acq_sample sample = {.ticks = 1};
+	struct pulse_reading reading;
+
+	ARG_UNUSED(work);
+	k_work_reschedule(&tick_work, K_MSEC(tick_us / 1000));
+	++ticks;
+
+	if (pulse_counter_read(&reading) == 0)
+	{
+		sample.mpulses = wind_rate_update(&rate, &reading, tick_us);
+		sample.flags |= ACQ_PULSES_OK | (reading.timed ? ACQ_TIMED : 0);
+		timed += reading.timed;
+	}
+	if (timing != (rate.timing && timing_allowed))
+	{
+		timing = !timing;
+		pulse_counter_set_timing(timing);
+	}
+	// the vane voltage at the sample, as the ADC would read it
+	sample.dir_mv = wind_trace_direction_mv();
+	sample.flags |= ACQ_DIRECTION_OK;
+
+	pending[head++ % CONFIG_WIND_ACQ_RING_SIZE] = sample;
+	if (ready_cb)
+	{
+		ready_cb();
+	}
+}
+
+void acquisition_init(void (*ready)(void))
+{
+	ready_cb = ready;
+	wind_rate_init(&rate, CONFIG_WIND_PERIOD_MAX_HZ);
+	timing = rate.timing && timing_allowed;
+	pulse_counter_set_timing(timing);
+}
+
+void acquisition_set_tick(uint8_t seconds)
+{
+	tick_us = seconds * USEC_PER_SEC;
+	k_work_reschedule(&tick_work, K_SECONDS(seconds));
+}
+
+void acquisition_set_timing(bool allowed)
+{
+	timing_allowed = allowed;
+}
+
+bool acquisition_get(struct acq_sample *sample)
+{
+	if (tail == head)
+	{
+		return false;
+	}
+	*sample = pending[tail++ % CONFIG_WIND_ACQ_RING_SIZE];
+	return true;
+}
+
+void acquisition_stats_get(struct acq_stats *stats)
+{
+	// the virtual clock runs every tick to the end, none is missed
+	*stats = (struct acq_stats){.ticks = ticks, .missed = 0, .timed = timed};
+}
+
+// the MQTT client, every message is delivered at once
+
+static struct mqtt_msg pool[CONFIG_MQTT_MSG_POOL_SIZE];
+static bool taken[CONFIG_MQTT_MSG_POOL_SIZE];
+
+void station_sim_on_publish(station_publish_cb cb)
+{
+	publish_cb = cb;
+}
+
+struct mqtt_msg *mqtt_msg_alloc(k_timeout_t timeout)
+{
+	ARG_UNUSED(timeout);
+	for (int i = 0; i < CONFIG_MQTT_MSG_POOL_SIZE; ++i)
+	{
+		if (!taken[i])
+		{
+			taken[i] = true;
+			pool[i] = (struct mqtt_msg){.qos = MQTT_QOS_1_AT_LEAST_ONCE};
+			return &pool[i];
+		}
+	}
+	return NULL;
+}
+
+void mqtt_msg_free(struct mqtt_msg *msg)
+{
+	taken[msg - pool] = false;
+}
+
+uint32_t mqtt_msg_free_count(void)
+{
+	uint32_t n = 0;
+
+	for (int i = 0; i < CONFIG_MQTT_MSG_POOL_SIZE; ++i)
+	{
+		n += !taken[i];
+	}
+	return n;
+}
+
+int data_publish(struct mqtt_msg *msg)
+{
+	if (publish_cb)
+	{
+		publish_cb(msg);
+	}
+	mqtt_msg_free(msg);
+	return 0;
+}
+
+const char *mqtt_station_id(void)
+{
+	return "nrf-351358811234567";
+}
+
+// the rest of the station
+
+void turn_leds_on_with_color(led_color_t color)
+{
+	ARG_UNUSED(color);
+}
+
+void publish_health_data()
+{
+}
+
+void health_sample(void)
+{
+}
+
+void power_report_done(void)
+{
+}
@@ -0,0 +1,33 @@
+#ifndef _REPLAY_STATION_SIM_H_
+#define _REPLAY_STATION_SIM_H_
+
+#include <stdint.h>
+
+#include "mqtt_connection.h"
+
+// Stands in for the parts of the station around the report path: the
+// acquisition thread, run by the virtual clock with the same steps per
+// tick, the MQTT client, which hands every published message to the
+// replay, and the LEDs, health and power accounting, which do nothing.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// trace of the SIM pulse counter, see wind_trace_init()
+extern uint16_t replay_trace_mean_hz;
+extern uint32_t replay_trace_seed;
+
+typedef void (*station_publish_cb)(const struct mqtt_msg *msg);
+
+/**
+ * @brief Take every message published from now on, the message is freed
+ * after the call.
+ */
+void station_sim_on_publish(station_publish_cb cb);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _REPLAY_STATION_SIM_H_ */
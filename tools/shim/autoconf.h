@@ -0,0 +1,92 @@
+#ifndef _SHIM_AUTOCONF_H_
+#define _SHIM_AUTOCONF_H_
+
+// The Kconfig values the firmware modules built on the host need, forced
+// into them like the generated autoconf.h of a firmware build, with the
+// defaults of prj.conf and Kconfig. A tool overrides one with -D. JSON is
+// picked with -DFLEET_PAYLOAD_JSON=ON in tools/fleet.
+
+#define CONFIG_MQTT_PRIMARY_TOPIC "zimbuktu"
+#define CONFIG_MQTT_CMD_TOPIC "cmd"
+#define CONFIG_MQTT_CLIENT_ID ""
+#define CONFIG_MQTT_KEEPALIVE 1200
+#define CONFIG_MQTT_MESSAGE_BUFFER_SIZE 384
+#define CONFIG_MQTT_PAYLOAD_BUFFER_SIZE 128
+
+#ifndef CONFIG_MQTT_BROKER_HOSTNAME
+#define CONFIG_MQTT_BROKER_HOSTNAME "broker.hivemq.com"
+#endif
+#ifndef CONFIG_MQTT_BROKER_PORT
+#define CONFIG_MQTT_BROKER_PORT 1883
+#endif
+#ifndef CONFIG_MQTT_RECONNECT_DELAY_S
+#define CONFIG_MQTT_RECONNECT_DELAY_S 60
+#endif
+#ifndef CONFIG_MQTT_PUBACK_TIMEOUT_MS
+#define CONFIG_MQTT_PUBACK_TIMEOUT_MS 10000
+#endif
+#ifndef CONFIG_MQTT_RETRANSMIT_MAX
+#define CONFIG_MQTT_RETRANSMIT_MAX 3
+#endif
+#ifndef CONFIG_MQTT_PUBLISH_POLL_MS
+#define CONFIG_MQTT_PUBLISH_POLL_MS 500
+#endif
+
+#if !defined(CONFIG_PAYLOAD_FORMAT_JSON)
+#define CONFIG_PAYLOAD_FORMAT_CBOR 1
+#endif
+
+#ifndef CONFIG_MQTT_MSG_PAYLOAD_SIZE
+#if defined(CONFIG_PAYLOAD_FORMAT_CBOR)
+#define CONFIG_MQTT_MSG_PAYLOAD_SIZE 640
+#else
+#define CONFIG_MQTT_MSG_PAYLOAD_SIZE 896
+#endif
+#endif
+#ifndef CONFIG_MQTT_MSG_POOL_SIZE
+#define CONFIG_MQTT_MSG_POOL_SIZE 8
+#endif
+#ifndef CONFIG_MQTT_INFLIGHT_WINDOW
+#define CONFIG_MQTT_INFLIGHT_WINDOW 4
+#endif
+#ifndef CONFIG_REPORT_STORE_CAPACITY
+#define CONFIG_REPORT_STORE_CAPACITY 192
+#endif
+#ifndef CONFIG_REPORT_STORE_DRAIN_BATCH
+#define CONFIG_REPORT_STORE_DRAIN_BATCH 8
+#endif
+#ifndef CONFIG_REPORT_STORE_DRAIN_INTERVAL_MS
+#define CONFIG_REPORT_STORE_DRAIN_INTERVAL_MS 500
+#endif
+#ifndef CONFIG_WIND_ACQ_RING_SIZE
+#define CONFIG_WIND_ACQ_RING_SIZE 8
+#endif
+#ifndef CONFIG_WIND_DELTA_PUBLISH
+#define CONFIG_WIND_DELTA_PUBLISH 1
+#endif
+#ifndef CONFIG_WIND_PULSE_MAX_HZ
+#define CONFIG_WIND_PULSE_MAX_HZ 100
+#endif
+#ifndef CONFIG_WIND_PERIOD_MAX_HZ
+#define CONFIG_WIND_PERIOD_MAX_HZ 20
+#endif
+#ifndef CONFIG_WIND_WAKEUP_BUDGET_PER_HOUR
+#define CONFIG_WIND_WAKEUP_BUDGET_PER_HOUR 3600
+#endif
+#ifndef CONFIG_WIND_TRACE_MEAN_HZ
+#define CONFIG_WIND_TRACE_MEAN_HZ 6
+#endif
+#ifndef CONFIG_WIND_TRACE_SEED
+#define CONFIG_WIND_TRACE_SEED 1
+#endif
+#ifndef CONFIG_REPORT_DEADBAND_SPEED
+#define CONFIG_REPORT_DEADBAND_SPEED 2
+#endif
+#ifndef CONFIG_REPORT_DEADBAND_GUST
+#define CONFIG_REPORT_DEADBAND_GUST 3
+#endif
+#ifndef CONFIG_REPORT_DEADBAND_DIRECTION
+#define CONFIG_REPORT_DEADBAND_DIRECTION 20
+#endif
+
+#endif /* _SHIM_AUTOCONF_H_ */
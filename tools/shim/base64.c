@@ -0,0 +1,37 @@
+#include <errno.h>
+
+#include <zephyr/sys/base64.h>
+
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int base64_encode(uint8_t *dst, size_t dlen, size_t *olen, const uint8_t *src, size_t slen)
+{
+	size_t need = (slen + 2) / 3 * 4;
+	uint8_t *out = dst;
+
+	if (need + 1 > dlen)
+	{
+		*olen = need + 1;
+		return -ENOMEM;
+	}
+	for (size_t i = 0; i < slen; i += 3)
+	{
+		uint32_t v = (uint32_t)src[i] << 16;
+
+		if (i + 1 < slen)
+		{
+			v |= (uint32_t)src[i + 1] << 8;
+		}
+		if (i + 2 < slen)
+		{
+			v |= src[i + 2];
+		}
+		*out++ = alphabet[(v >> 18) & 0x3f];
+		*out++ = alphabet[(v >> 12) & 0x3f];
+		*out++ = i + 1 < slen ? alphabet[(v >> 6) & 0x3f] : '=';
+		*out++ = i + 2 < slen ? alphabet[v & 0x3f] : '=';
+	}
+	*out = '\0';
+	*olen = need;
+	return 0;
+}
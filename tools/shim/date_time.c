@@ -0,0 +1,32 @@
+#include <date_time.h>
+#include <zephyr/kernel.h>
+
+static int64_t offset_ms;
+static date_time_evt_handler_t handler;
+
+int date_time_now(int64_t *unix_time_ms)
+{
+	*unix_time_ms = k_uptime_get() + offset_ms;
+	return 0;
+}
+
+bool date_time_is_valid(void)
+{
+	return true;
+}
+
+void date_time_register_handler(date_time_evt_handler_t evt_handler)
+{
+	handler = evt_handler;
+}
+
+void shim_date_time_set(int64_t unix_ms_at_boot)
+{
+	struct date_time_evt evt = {.type = DATE_TIME_OBTAINED_MODEM};
+
+	offset_ms = unix_ms_at_boot;
+	if (handler)
+	{
+		handler(&evt);
+	}
+}
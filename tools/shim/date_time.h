@@ -0,0 +1,36 @@
+#ifndef _SHIM_DATE_TIME_H_
+#define _SHIM_DATE_TIME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host stand-in for the nRF Connect SDK date_time library. The time is
+// valid from the start, wall clock is uptime plus the offset a tool sets
+// with shim_date_time_set().
+
+enum date_time_evt_type
+{
+	DATE_TIME_OBTAINED_MODEM,
+	DATE_TIME_OBTAINED_NTP,
+	DATE_TIME_OBTAINED_EXT,
+	DATE_TIME_NOT_OBTAINED,
+};
+
+struct date_time_evt
+{
+	enum date_time_evt_type type;
+};
+
+typedef void (*date_time_evt_handler_t)(const struct date_time_evt *evt);
+
+int date_time_now(int64_t *unix_time_ms);
+bool date_time_is_valid(void);
+void date_time_register_handler(date_time_evt_handler_t evt_handler);
+
+/**
+ * @brief Set the unix time in ms at uptime 0 and tell the registered
+ * handler, as a new time from the network would. Host tools only.
+ */
+void shim_date_time_set(int64_t unix_ms_at_boot);
+
+#endif /* _SHIM_DATE_TIME_H_ */
@@ -0,0 +1,102 @@
+#include <zephyr/drivers/gpio.h>
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+int shim_log_level = LOG_LEVEL_WRN;
+const struct device shim_gpio_device = {"gpio0"};
+
+static int64_t uptime_ms;
+static struct k_work_delayable *scheduled;
+static struct k_work *queue_head; // submitted, run in order
+static struct k_work *queue_tail;
+
+int64_t k_uptime_get(void)
+{
+	return uptime_ms;
+}
+
+int k_work_submit(struct k_work *work)
+{
+	if (work->queued)
+	{
+		return 0;
+	}
+	work->queued = true;
+	work->next = NULL;
+	if (queue_tail)
+	{
+		queue_tail->next = work;
+	}
+	else
+	{
+		queue_head = work;
+	}
+	queue_tail = work;
+	return 1;
+}
+
+// runs the work submitted so far and what it submits in turn
+static void run_queue(void)
+{
+	while (queue_head)
+	{
+		struct k_work *work = queue_head;
+
+		queue_head = work->next;
+		if (queue_head == NULL)
+		{
+			queue_tail = NULL;
+		}
+		work->queued = false;
+		work->handler(work);
+	}
+}
+
+int k_work_cancel_delayable(struct k_work_delayable *dwork)
+{
+	for (struct k_work_delayable **p = &scheduled; *p; p = &(*p)->next)
+	{
+		if (*p == dwork)
+		{
+			*p = dwork->next;
+			break;
+		}
+	}
+	dwork->pending = false;
+	return 0;
+}
+
+int k_work_reschedule(struct k_work_delayable *dwork, k_timeout_t delay)
+{
+	k_work_cancel_delayable(dwork);
+	dwork->due = uptime_ms + (delay.ms > 0 ? delay.ms : 0);
+	dwork->pending = true;
+	dwork->next = scheduled;
+	scheduled = dwork;
+	return 1;
+}
+
+void shim_run(int64_t ms)
+{
+	for (;;)
+	{
+		struct k_work_delayable *first = NULL;
+
+		run_queue();
+		for (struct k_work_delayable *w = scheduled; w; w = w->next)
+		{
+			if (w->due <= ms && (first == NULL || w->due < first->due))
+			{
+				first = w;
+			}
+		}
+		if (first == NULL)
+		{
+			break;
+		}
+		k_work_cancel_delayable(first);
+		uptime_ms = first->due > uptime_ms ? first->due : uptime_ms;
+		first->work.handler(&first->work);
+	}
+	uptime_ms = ms > uptime_ms ? ms : uptime_ms;
+}
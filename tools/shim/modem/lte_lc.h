@@ -0,0 +1,8 @@
+#ifndef _SHIM_MODEM_LTE_LC_H_
+#define _SHIM_MODEM_LTE_LC_H_
+
+// Host stand-in, power.h only passes the events by pointer.
+
+struct lte_lc_evt;
+
+#endif /* _SHIM_MODEM_LTE_LC_H_ */
@@ -0,0 +1,11 @@
+#ifndef _SHIM_NRF_MODEM_AT_H_
+#define _SHIM_NRF_MODEM_AT_H_
+
+#include <stddef.h>
+
+// Host stand-in, the tool building mqtt_connection.c answers the AT
+// commands, AT+CGSN with the IMEI of its station.
+
+int nrf_modem_at_cmd(void *buf, size_t len, const char *fmt, ...);
+
+#endif /* _SHIM_NRF_MODEM_AT_H_ */
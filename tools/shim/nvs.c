@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <zephyr/fs/nvs.h>
+#include <zephyr/storage/flash_map.h>
+
+#define ATE_SIZE 8
+#define WRITE_BLOCK 4
+#define MAX_SECTORS 64
+#define MAX_FS 4
+
+const struct device shim_flash_device = {"flash_sim"};
+
+struct sim_entry
+{
+	uint16_t id;
+	uint16_t len; // 0 deletes the id
+	uint8_t *data;
+};
+
+struct sim_sector
+{
+	struct sim_entry *entries; // oldest first
+	int count;
+	uint32_t used; // data and allocation entries
+};
+
+struct sim_fs
+{
+	bool used;
+	off_t offset;
+	uint16_t sector_size;
+	uint16_t sector_count;
+	int cur; // sector written, the one after it is always erased
+	struct sim_sector sectors[MAX_SECTORS];
+	struct nvs_sim_stats stats;
+};
+
+static struct sim_fs sims[MAX_FS];
+
+static uint32_t entry_cost(size_t len)
+{
+	return ROUND_UP(len, WRITE_BLOCK) + ATE_SIZE;
+}
+
+// room left in a sector, the last two allocation entries close it
+static uint32_t sector_free(const struct sim_fs *s, const struct sim_sector *sec)
+{
+	return s->sector_size - 2 * ATE_SIZE - sec->used;
+}
+
+static void sector_erase(struct sim_fs *s, struct sim_sector *sec)
+{
+	for (int i = 0; i < sec->count; ++i)
+	{
+		free(sec->entries[i].data);
+	}
+	sec->count = 0;
+	sec->used = 0;
+	++s->stats.erases;
+}
+
+static void sector_append(struct sim_fs *s, struct sim_sector *sec, uint16_t id, const void *data, size_t len)
+{
+	struct sim_entry *e = &sec->entries[sec->count++];
+
+	e->id = id;
+	e->len = len;
+	e->data = NULL;
+	if (len)
+	{
+		e->data = malloc(len);
+		memcpy(e->data, data, len);
+	}
+	sec->used += entry_cost(len);
+	s->stats.bytes_written += entry_cost(len);
+}
+
+static struct sim_fs *sim_find(off_t offset)
+{
+	for (int i = 0; i < MAX_FS; ++i)
+	{
+		if (sims[i].used && sims[i].offset == offset)
+		{
+			return &sims[i];
+		}
+	}
+	return NULL;
+}
+
+// newest entry of id, walking back from the newest allocation entry
+static struct sim_entry *sim_lookup(struct sim_fs *s, uint16_t id)
+{
+	for (int n = 0; n < s->sector_count; ++n)
+	{
+		struct sim_sector *sec = &s->sectors[(s->cur - n + s->sector_count) % s->sector_count];
+
+		for (int i = sec->count - 1; i >= 0; --i)
+		{
+			++s->stats.ate_reads;
+			if (sec->entries[i].id == id)
+			{
+				return &sec->entries[i];
+			}
+		}
+	}
+	return NULL;
+}
+
+// moves the live entries of the oldest sector into the current one
+static void sim_gc(struct sim_fs *s)
+{
+	struct sim_sector *gc = &s->sectors[(s->cur + 1) % s->sector_count];
+	struct sim_sector *cur = &s->sectors[s->cur];
+
+	for (int i = 0; i < gc->count; ++i)
+	{
+		struct sim_entry *e = &gc->entries[i];
+
+		if (e->len && sim_lookup(s, e->id) == e)
+		{
+			sector_append(s, cur, e->id, e->data, e->len);
+			++s->stats.gc_copies;
+		}
+	}
+	sector_erase(s, gc);
+}
+
+int nvs_mount(struct nvs_fs *fs)
+{
+	struct sim_fs *s = sim_find(fs->offset);
+
+	if (fs->sector_count < 2 || fs->sector_count > MAX_SECTORS || fs->sector_size < 4 * ATE_SIZE)
+	{
+		return -EINVAL;
+	}
+	if (s && (s->sector_size != fs->sector_size || s->sector_count != fs->sector_count))
+	{
+		// formatted with another geometry, starts over
+		nvs_sim_erase(fs->offset);
+		s = NULL;
+	}
+	for (int i = 0; s == NULL && i < MAX_FS; ++i)
+	{
+		if (!sims[i].used)
+		{
+			s = &sims[i];
+			s->used = true;
+			s->offset = fs->offset;
+			s->sector_size = fs->sector_size;
+			s->sector_count = fs->sector_count;
+			s->cur = 0;
+			for (int n = 0; n < s->sector_count; ++n)
+			{
+				s->sectors[n].entries = calloc(s->sector_size / ATE_SIZE, sizeof(struct sim_entry));
+			}
+		}
+	}
+	if (s == NULL)
+	{
+		return -ENOMEM;
+	}
+	fs->sim = s;
+	return 0;
+}
+
+ssize_t nvs_write(struct nvs_fs *fs, uint16_t id, const void *data, size_t len)
+{
+	struct sim_fs *s = fs->sim;
+	struct sim_entry *prev;
+
+	if (s == NULL)
+	{
+		return -EACCES;
+	}
+	if (len > (size_t)(s->sector_size - 3 * ATE_SIZE))
+	{
+		return -EINVAL;
+	}
+
+	// like NVS, an unchanged value or a delete of nothing is not written
+	prev = sim_lookup(s, id);
+	if ((prev == NULL || prev->len == 0) ? len == 0 : (prev->len == len && memcmp(prev->data, data, len) == 0))
+	{
+		return 0;
+	}
+
+	for (int gc_count = 0; sector_free(s, &s->sectors[s->cur]) < entry_cost(len); ++gc_count)
+	{
+		if (gc_count == s->sector_count - 1)
+		{
+			return -ENOSPC;
+		}
+		s->stats.bytes_written += 2 * ATE_SIZE; // close and gc done
+		s->cur = (s->cur + 1) % s->sector_count;
+		sim_gc(s);
+	}
+	sector_append(s, &s->sectors[s->cur], id, data, len);
+	return len;
+}
+
+ssize_t nvs_read(struct nvs_fs *fs, uint16_t id, void *data, size_t len)
+{
+	struct sim_fs *s = fs->sim;
+	struct sim_entry *e;
+
+	if (s == NULL)
+	{
+		return -EACCES;
+	}
+	e = sim_lookup(s, id);
+	if (e == NULL || e->len == 0)
+	{
+		return -ENOENT;
+	}
+	memcpy(data, e->data, MIN(len, e->len));
+	return e->len;
+}
+
+int nvs_delete(struct nvs_fs *fs, uint16_t id)
+{
+	ssize_t err = nvs_write(fs, id, NULL, 0);
+
+	return (err < 0) ? err : 0;
+}
+
+void nvs_sim_erase(off_t offset)
+{
+	struct sim_fs *s = sim_find(offset);
+
+	if (s == NULL)
+	{
+		return;
+	}
+	for (int n = 0; n < s->sector_count; ++n)
+	{
+		sector_erase(s, &s->sectors[n]);
+		free(s->sectors[n].entries);
+	}
+	memset(s, 0, sizeof(*s));
+}
+
+int nvs_sim_corrupt(off_t offset, uint16_t id, size_t pos)
+{
+	struct sim_fs *s = sim_find(offset);
+	struct sim_entry *e = s ? sim_lookup(s, id) : NULL;
+
+	if (e == NULL || pos >= e->len)
+	{
+		return -ENOENT;
+	}
+	e->data[pos] ^= 0xff;
+	return 0;
+}
+
+void nvs_sim_stats_get(off_t offset, struct nvs_sim_stats *stats)
+{
+	struct sim_fs *s = sim_find(offset);
+
+	*stats = s ? s->stats : (struct nvs_sim_stats){0};
+}
@@ -0,0 +1,28 @@
+#ifndef _SHIM_ZEPHYR_DRIVERS_FLASH_H_
+#define _SHIM_ZEPHYR_DRIVERS_FLASH_H_
+
+#include <sys/types.h>
+#include <zephyr/kernel.h>
+
+// Host stand-in, the simulated flash of tools/shim/nvs.c has 4 kB pages
+// like the nRF91.
+
+#define SHIM_FLASH_PAGE_SIZE 4096
+
+struct flash_pages_info
+{
+	off_t start_offset;
+	size_t size;
+	uint32_t index;
+};
+
+static inline int flash_get_page_info_by_offs(const struct device *dev, off_t offset, struct flash_pages_info *info)
+{
+	(void)dev;
+	info->start_offset = offset / SHIM_FLASH_PAGE_SIZE * SHIM_FLASH_PAGE_SIZE;
+	info->size = SHIM_FLASH_PAGE_SIZE;
+	info->index = offset / SHIM_FLASH_PAGE_SIZE;
+	return 0;
+}
+
+#endif /* _SHIM_ZEPHYR_DRIVERS_FLASH_H_ */
@@ -0,0 +1,51 @@
+#ifndef _SHIM_ZEPHYR_FS_NVS_H_
+#define _SHIM_ZEPHYR_FS_NVS_H_
+
+#include <sys/types.h>
+#include <zephyr/kernel.h>
+
+// Host stand-in for Zephyr NVS over a simulated flash, see nvs.c. It keeps
+// the allocation of the real file system: sectors filled with data from
+// the start and 8 byte allocation entries from the end, two entries closing
+// every sector, one sector kept erased, and garbage collection of the
+// oldest sector into the newest whenever a sector fills. A write that finds
+// no room after trying every sector fails with -ENOSPC as on the target.
+
+struct nvs_fs
+{
+	off_t offset;
+	uint16_t sector_size;
+	uint16_t sector_count;
+	const struct device *flash_device;
+	void *sim; // simulated flash state
+};
+
+int nvs_mount(struct nvs_fs *fs);
+ssize_t nvs_write(struct nvs_fs *fs, uint16_t id, const void *data, size_t len);
+ssize_t nvs_read(struct nvs_fs *fs, uint16_t id, void *data, size_t len);
+int nvs_delete(struct nvs_fs *fs, uint16_t id);
+
+// flash traffic of the file system at offset since it was created
+struct nvs_sim_stats
+{
+	uint64_t bytes_written; // data and allocation entries
+	uint64_t ate_reads;		// allocation entries walked by lookups
+	uint32_t erases;		// sectors
+	uint32_t gc_copies;		// live entries moved by garbage collection
+};
+
+/**
+ * @brief Erase the simulated file system at offset, the next mount starts
+ * empty. Host tools only.
+ */
+void nvs_sim_erase(off_t offset);
+
+/**
+ * @brief Flip a byte at pos of the newest entry of id, as a bad flash
+ * write would, -ENOENT if there is none. Host tools only.
+ */
+int nvs_sim_corrupt(off_t offset, uint16_t id, size_t pos);
+
+void nvs_sim_stats_get(off_t offset, struct nvs_sim_stats *stats);
+
+#endif /* _SHIM_ZEPHYR_FS_NVS_H_ */
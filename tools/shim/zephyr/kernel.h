@@ -0,0 +1,189 @@
+#ifndef _SHIM_ZEPHYR_KERNEL_H_
+#define _SHIM_ZEPHYR_KERNEL_H_
+
+// Host stand-in for the parts of zephyr/kernel.h used by the firmware
+// modules the host tools build: the report encoders, the calibration, the
+// speed measurement, the report store and the MQTT connection. The host
+// tools are single threaded, locks are no-ops. Uptime is a virtual clock,
+// delayed work runs when the tool advances it, see shim_run() in kernel.c.
+// tools/fleet runs mqtt_connection.c on the real clock instead and brings
+// its own uptime, message queue and memory slab.
+
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef MIN
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+#ifndef CLAMP
+#define CLAMP(val, low, high) (((val) <= (low)) ? (low) : MIN(val, high))
+#endif
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define BIT(n) (1UL << (n))
+#define ROUND_UP(x, align) ((((x) + (align) - 1) / (align)) * (align))
+#define DIV_ROUND_UP(n, d) (((n) + (d) - 1) / (d))
+#define ARG_UNUSED(x) (void)(x)
+#define BUILD_ASSERT(cond, msg) _Static_assert(cond, msg)
+#define USEC_PER_SEC 1000000U
+#define MSEC_PER_SEC 1000U
+#define __packed __attribute__((__packed__))
+#define __aligned(x) __attribute__((__aligned__(x)))
+
+// console output goes with the info messages, see logging/log.h
+extern int shim_log_level;
+#define printk(...) (shim_log_level >= 3 ? (void)fprintf(stderr, __VA_ARGS__) : (void)0)
+
+// IS_ENABLED(CONFIG_x) is 1 when CONFIG_x is defined to 1, as in Zephyr
+#define IS_ENABLED(config_macro) Z_IS_ENABLED1(config_macro)
+#define Z_IS_ENABLED1(config_macro) Z_IS_ENABLED2(_XXXX##config_macro)
+#define _XXXX1 _YYYY,
+#define Z_IS_ENABLED2(one_or_two_args) Z_IS_ENABLED3(one_or_two_args 1, 0)
+#define Z_IS_ENABLED3(ignore_this, val, ...) val
+
+typedef struct
+{
+	int64_t ms;
+} k_timeout_t;
+
+#define K_FOREVER ((k_timeout_t){-1})
+#define K_NO_WAIT ((k_timeout_t){0})
+#define K_MSEC(ms) ((k_timeout_t){(ms)})
+#define K_SECONDS(s) ((k_timeout_t){(int64_t)(s) * 1000})
+
+struct device
+{
+	const char *name;
+};
+
+static inline bool device_is_ready(const struct device *dev)
+{
+	return dev != NULL;
+}
+
+int64_t k_uptime_get(void);
+
+struct k_mutex
+{
+	int unused;
+};
+
+#define K_MUTEX_DEFINE(name) struct k_mutex name
+
+static inline int k_mutex_lock(struct k_mutex *m, k_timeout_t timeout)
+{
+	(void)m;
+	(void)timeout;
+	return 0;
+}
+
+static inline int k_mutex_unlock(struct k_mutex *m)
+{
+	(void)m;
+	return 0;
+}
+
+struct k_work;
+typedef void (*k_work_handler_t)(struct k_work *work);
+
+struct k_work
+{
+	k_work_handler_t handler;
+	bool queued;
+	struct k_work *next; // in the queue of submitted work
+};
+
+#define K_WORK_DEFINE(name, fn) struct k_work name = {.handler = (fn)}
+
+int k_work_submit(struct k_work *work);
+
+struct k_work_delayable
+{
+	struct k_work work;
+	int64_t due; // uptime it runs at
+	bool pending;
+	struct k_work_delayable *next; // in the list of scheduled work
+};
+
+#define K_WORK_DELAYABLE_DEFINE(name, fn) struct k_work_delayable name = {.work = {.handler = (fn)}}
+
+int k_work_reschedule(struct k_work_delayable *dwork, k_timeout_t delay);
+int k_work_cancel_delayable(struct k_work_delayable *dwork);
+
+static inline bool k_work_delayable_is_pending(const struct k_work_delayable *dwork)
+{
+	return dwork->pending;
+}
+
+struct k_spinlock
+{
+	int unused;
+};
+typedef int k_spinlock_key_t;
+
+static inline k_spinlock_key_t k_spin_lock(struct k_spinlock *l)
+{
+	(void)l;
+	return 0;
+}
+
+static inline void k_spin_unlock(struct k_spinlock *l, k_spinlock_key_t key)
+{
+	(void)l;
+	(void)key;
+}
+
+struct k_msgq
+{
+	size_t msg_size;
+	uint32_t max_msgs;
+	char *buffer;
+	uint32_t head; // oldest message
+	uint32_t used;
+};
+
+#define K_MSGQ_DEFINE(name, size, max, align)                                  \
+	static char __aligned(align) _k_msgq_buf_##name[(size) * (max)];            \
+	struct k_msgq name = {(size), (max), _k_msgq_buf_##name, 0, 0}
+
+int k_msgq_put(struct k_msgq *q, const void *data, k_timeout_t timeout);
+int k_msgq_get(struct k_msgq *q, void *data, k_timeout_t timeout);
+
+static inline uint32_t k_msgq_num_used_get(struct k_msgq *q)
+{
+	return q->used;
+}
+
+struct k_mem_slab
+{
+	size_t block_size;
+	uint32_t num_blocks;
+	char *buffer;
+	void *free_list; // built on the first alloc
+	uint32_t num_used;
+};
+
+#define K_MEM_SLAB_DEFINE_STATIC(name, size, num, align)                        \
+	static char __aligned(align) _k_slab_buf_##name[ROUND_UP(size, align) * (num)]; \
+	static struct k_mem_slab name = {ROUND_UP(size, align), (num), _k_slab_buf_##name, NULL, 0}
+
+int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem, k_timeout_t timeout);
+void k_mem_slab_free(struct k_mem_slab *slab, void **mem);
+
+static inline uint32_t k_mem_slab_num_free_get(struct k_mem_slab *slab)
+{
+	return slab->num_blocks - slab->num_used;
+}
+
+/**
+ * @brief Advance the virtual uptime to ms, running the submitted work and
+ * the delayed work that falls due on the way in order. Host tools only.
+ */
+void shim_run(int64_t ms);
+
+#endif /* _SHIM_ZEPHYR_KERNEL_H_ */
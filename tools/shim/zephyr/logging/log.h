@@ -0,0 +1,23 @@
+#ifndef _SHIM_ZEPHYR_LOGGING_LOG_H_
+#define _SHIM_ZEPHYR_LOGGING_LOG_H_
+
+#include <stdio.h>
+
+// Host stand-in, messages up to shim_log_level go to stderr, warnings by
+// default. The firmware messages carry their own newline.
+
+#define LOG_LEVEL_ERR 1
+#define LOG_LEVEL_WRN 2
+#define LOG_LEVEL_INF 3
+#define LOG_LEVEL_DBG 4
+
+extern int shim_log_level;
+
+#define LOG_MODULE_REGISTER(name, level) extern int shim_log_level
+#define SHIM_LOG(level, ...) ((level) <= shim_log_level ? (void)fprintf(stderr, __VA_ARGS__) : (void)0)
+#define LOG_ERR(...) SHIM_LOG(LOG_LEVEL_ERR, __VA_ARGS__)
+#define LOG_WRN(...) SHIM_LOG(LOG_LEVEL_WRN, __VA_ARGS__)
+#define LOG_INF(...) SHIM_LOG(LOG_LEVEL_INF, __VA_ARGS__)
+#define LOG_DBG(...) SHIM_LOG(LOG_LEVEL_DBG, __VA_ARGS__)
+
+#endif /* _SHIM_ZEPHYR_LOGGING_LOG_H_ */
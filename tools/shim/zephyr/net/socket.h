@@ -0,0 +1,14 @@
+#ifndef _SHIM_ZEPHYR_NET_SOCKET_H_
+#define _SHIM_ZEPHYR_NET_SOCKET_H_
+
+// Host stand-in, the host has BSD sockets, poll and getaddrinfo.
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+
+#define NET_IPV4_ADDR_LEN INET_ADDRSTRLEN
+
+#endif /* _SHIM_ZEPHYR_NET_SOCKET_H_ */
@@ -0,0 +1,8 @@
+#ifndef _SHIM_ZEPHYR_POSIX_SYS_EVENTFD_H_
+#define _SHIM_ZEPHYR_POSIX_SYS_EVENTFD_H_
+
+// Host stand-in, Linux has the same eventfd API.
+
+#include <sys/eventfd.h>
+
+#endif /* _SHIM_ZEPHYR_POSIX_SYS_EVENTFD_H_ */
@@ -0,0 +1,21 @@
+#ifndef _SHIM_ZEPHYR_STORAGE_FLASH_MAP_H_
+#define _SHIM_ZEPHYR_STORAGE_FLASH_MAP_H_
+
+#include <sys/types.h>
+#include <zephyr/kernel.h>
+
+// Host stand-in, every partition lives on the one simulated flash. A tool
+// gives a partition its size with -DSHIM_PARTITION_SIZE_<label>=<bytes>,
+// the offsets only have to be distinct.
+
+extern const struct device shim_flash_device;
+
+#define SHIM_PARTITION_OFFSET(label) ((off_t)SHIM_PARTITION_OFFSET_##label)
+#define SHIM_PARTITION_SIZE(label) (SHIM_PARTITION_SIZE_##label)
+
+// one level more, so a macro label expands first
+#define FIXED_PARTITION_DEVICE(label) (&shim_flash_device)
+#define FIXED_PARTITION_OFFSET(label) SHIM_PARTITION_OFFSET(label)
+#define FIXED_PARTITION_SIZE(label) SHIM_PARTITION_SIZE(label)
+
+#endif /* _SHIM_ZEPHYR_STORAGE_FLASH_MAP_H_ */
@@ -0,0 +1,11 @@
+#ifndef _SHIM_ZEPHYR_SYS_BASE64_H_
+#define _SHIM_ZEPHYR_SYS_BASE64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Same contract as the Zephyr encoder: olen is the length written, without
+// the terminating NUL, -ENOMEM if dst is too small.
+int base64_encode(uint8_t *dst, size_t dlen, size_t *olen, const uint8_t *src, size_t slen);
+
+#endif /* _SHIM_ZEPHYR_SYS_BASE64_H_ */
@@ -0,0 +1,112 @@
+// Report store drain benchmark on the simulated flash.
+//
+//   store_bench [report bytes]
+//
+// Fills the store with reports of one size, 300 bytes with the topic by
+// default, then drains it through a broker with several round trip times.
+// Prints what the partition keeps, the flash written per stored report, the
+// drain rate in virtual time and the host time and NVS lookups per drained
+// report. The drain is paced by the PUBACKs of the in-flight window, the
+// batch interval only applies when no PUBACK comes.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "broker_sim.h"
+
+extern "C"
+{
+#include <zephyr/fs/nvs.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "mqtt_connection.h"
+#include "report_store.h"
+}
+
+namespace
+{
+
+constexpr off_t PARTITION = FIXED_PARTITION_OFFSET(report_storage);
+constexpr const char *TOPIC = "zimbuktu/351358811234567/wind/delta";
+
+struct fill_result
+{
+	uint32_t kept;
+	double bytes_per_report; // written to flash
+	double erases_per_report;
+};
+
+// stores twice what fits, so the ring runs full and wraps
+fill_result fill(size_t payload_len)
+{
+	std::vector<uint8_t> payload(payload_len, 0x5a);
+	struct nvs_sim_stats before, after;
+	uint32_t n = 2 * CONFIG_REPORT_STORE_CAPACITY;
+
+	nvs_sim_erase(PARTITION);
+	report_store_init();
+	nvs_sim_stats_get(PARTITION, &before);
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		report_store_put((const uint8_t *)TOPIC, payload.data(), payload.size(), MQTT_QOS_1_AT_LEAST_ONCE, 0);
+	}
+	nvs_sim_stats_get(PARTITION, &after);
+	return {report_store_count(), double(after.bytes_written - before.bytes_written) / n,
+			double(after.erases - before.erases) / n};
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	size_t report = argc > 1 ? atoi(argv[1]) : 300;
+	size_t payload_len = report - std::min(report, strlen(TOPIC));
+
+	if (payload_len == 0 || payload_len > MQTT_MESSAGE_BUF_SIZE)
+	{
+		fprintf(stderr, "usage: store_bench [report bytes]\n");
+		return 2;
+	}
+	shim_log_level = LOG_LEVEL_ERR;
+
+	printf("partition %u bytes, capacity %u, %zu byte reports, window %u, batch %u every %u ms\n",
+		   FIXED_PARTITION_SIZE(report_storage), CONFIG_REPORT_STORE_CAPACITY, report,
+		   CONFIG_MQTT_INFLIGHT_WINDOW, CONFIG_REPORT_STORE_DRAIN_BATCH, CONFIG_REPORT_STORE_DRAIN_INTERVAL_MS);
+	printf("  %8s %6s %12s %10s %12s %10s %12s\n", "rtt ms", "kept", "flash B/rep", "erase/rep", "reports/s",
+		   "host us", "lookups/rep");
+
+	for (int64_t rtt : {100, 300, 1000, 3000})
+	{
+		fill_result f = fill(payload_len);
+		struct nvs_sim_stats before, after;
+
+		broker_reset(rtt);
+		nvs_sim_stats_get(PARTITION, &before);
+		int64_t start = k_uptime_get();
+		auto host_start = std::chrono::steady_clock::now();
+
+		report_store_drain_start();
+		shim_run(start + 3600 * 1000);
+
+		auto host_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - host_start);
+		const auto &got = broker_published();
+
+		nvs_sim_stats_get(PARTITION, &after);
+		if (got.size() != f.kept || report_store_count() != 0)
+		{
+			fprintf(stderr, "drained %zu of %u reports\n", got.size(), f.kept);
+			return 1;
+		}
+		double seconds = std::max<int64_t>(got.back().acked_ms - start, 1) / 1000.0;
+
+		printf("  %8lld %6u %12.0f %10.3f %12.1f %10.2f %12.0f\n", (long long)rtt, f.kept, f.bytes_per_report,
+			   f.erases_per_report, got.size() / seconds, host_us.count() / got.size(),
+			   double(after.ate_reads - before.ate_reads) / got.size());
+	}
+	return 0;
+}
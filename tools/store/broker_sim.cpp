@@ -0,0 +1,131 @@
+#include "broker_sim.h"
+
+#include <algorithm>
+#include <deque>
+
+extern "C"
+{
+#include <zephyr/net/mqtt.h>
+
+#include "mqtt_connection.h"
+#include "report_store.h"
+}
+
+namespace
+{
+
+struct mqtt_msg pool[CONFIG_MQTT_MSG_POOL_SIZE];
+bool taken[CONFIG_MQTT_MSG_POOL_SIZE];
+
+struct in_flight
+{
+	struct mqtt_msg *msg;
+	int64_t ack_ms;
+};
+
+int64_t rtt;
+std::deque<in_flight> window; // sent or queued, oldest first
+std::vector<int64_t> ack_times;
+std::vector<published> acked;
+
+void ack_work_cb(struct k_work *work);
+struct k_work_delayable ack_work = {{ack_work_cb, false, nullptr}, 0, false, nullptr};
+
+void ack_work_cb(struct k_work *work)
+{
+	(void)work;
+	while (!window.empty() && window.front().ack_ms <= k_uptime_get())
+	{
+		struct mqtt_msg *msg = window.front().msg;
+
+		acked.push_back({msg->topic, std::vector<uint8_t>(msg->payload, msg->payload + msg->len), k_uptime_get()});
+		window.pop_front();
+		if (msg->stored)
+		{
+			report_store_ack(msg->store_seq);
+		}
+		mqtt_msg_free(msg);
+		report_store_drain_kick();
+	}
+	if (!window.empty())
+	{
+		k_work_reschedule(&ack_work, k_timeout_t{window.front().ack_ms - k_uptime_get()});
+	}
+}
+
+} // namespace
+
+void broker_reset(int64_t rtt_ms)
+{
+	rtt = rtt_ms;
+	broker_disconnect();
+	acked.clear();
+}
+
+uint32_t broker_disconnect()
+{
+	uint32_t lost = window.size();
+
+	for (auto &f : window)
+	{
+		mqtt_msg_free(f.msg);
+	}
+	window.clear();
+	ack_times.clear();
+	k_work_cancel_delayable(&ack_work);
+	return lost;
+}
+
+const std::vector<published> &broker_published()
+{
+	return acked;
+}
+
+uint32_t broker_msgs_held()
+{
+	return std::count(std::begin(taken), std::end(taken), true);
+}
+
+extern "C" struct mqtt_msg *mqtt_msg_alloc(k_timeout_t timeout)
+{
+	(void)timeout;
+	for (int i = 0; i < CONFIG_MQTT_MSG_POOL_SIZE; ++i)
+	{
+		if (!taken[i])
+		{
+			taken[i] = true;
+			pool[i] = {};
+			pool[i].qos = MQTT_QOS_1_AT_LEAST_ONCE;
+			return &pool[i];
+		}
+	}
+	return nullptr;
+}
+
+extern "C" void mqtt_msg_free(struct mqtt_msg *msg)
+{
+	taken[msg - pool] = false;
+}
+
+extern "C" uint32_t mqtt_msg_free_count(void)
+{
+	return CONFIG_MQTT_MSG_POOL_SIZE - broker_msgs_held();
+}
+
+extern "C" int data_publish(struct mqtt_msg *msg)
+{
+	// sent once the message CONFIG_MQTT_INFLIGHT_WINDOW back is acknowledged
+	int64_t sent = k_uptime_get();
+
+	if (ack_times.size() >= CONFIG_MQTT_INFLIGHT_WINDOW)
+	{
+		sent = std::max(sent, ack_times[ack_times.size() - CONFIG_MQTT_INFLIGHT_WINDOW]);
+	}
+	ack_times.push_back(sent + rtt);
+	window.push_back({msg, sent + rtt});
+	if (!k_work_delayable_is_pending(&ack_work))
+	{
+		k_work_reschedule(&ack_work, k_timeout_t{sent + rtt - k_uptime_get()});
+	}
+	return 0;
+}
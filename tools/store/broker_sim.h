@@ -0,0 +1,33 @@
+#ifndef _STORE_BROKER_SIM_H_
+#define _STORE_BROKER_SIM_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Stands in for the MQTT thread of src/mqtt_connection.c: the message pool,
+// and a broker that acknowledges each report rtt_ms after it was sent, with
+// at most CONFIG_MQTT_INFLIGHT_WINDOW unacknowledged. An acknowledgment
+// deletes a stored report, frees the message and kicks the drain, as on the
+// target.
+
+struct published
+{
+	std::string topic;
+	std::vector<uint8_t> payload;
+	int64_t acked_ms;
+};
+
+void broker_reset(int64_t rtt_ms);
+
+// the connection drops, every unacknowledged message is lost, returns how
+// many; the MQTT thread frees them and rewinds the store on the reconnect
+uint32_t broker_disconnect();
+
+// reports acknowledged since the reset, in order
+const std::vector<published> &broker_published();
+
+// messages taken from the pool and not returned
+uint32_t broker_msgs_held();
+
+#endif /* _STORE_BROKER_SIM_H_ */
@@ -0,0 +1,281 @@
+// Report store test on the simulated flash.
+//
+//   store_test [-v]
+//
+// Each case starts from an erased partition, stores reports the way the
+// MQTT thread does when it is offline, drains them through the simulated
+// broker and checks what arrived. Every report carries its sequence number
+// in its first payload bytes.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+
+#include "broker_sim.h"
+
+extern "C"
+{
+#include <zephyr/fs/nvs.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/mqtt.h>
+#include <zephyr/storage/flash_map.h>
+
+#include "mqtt_connection.h"
+#include "report_store.h"
+}
+
+namespace
+{
+
+constexpr off_t PARTITION = FIXED_PARTITION_OFFSET(report_storage);
+constexpr const char *TOPIC = "zimbuktu/351358811234567/wind/delta";
+
+int failures;
+
+#define EXPECT(cond)                                                                                                   \
+	do                                                                                                                 \
+	{                                                                                                                  \
+		if (!(cond))                                                                                                   \
+		{                                                                                                              \
+			fprintf(stderr, "  %s:%d: %s\n", __FILE__, __LINE__, #cond);                                              \
+			++failures;                                                                                                \
+			return;                                                                                                    \
+		}                                                                                                              \
+	} while (0)
+
+void fresh_store()
+{
+	broker_reset(0);
+	nvs_sim_erase(PARTITION);
+	report_store_init();
+}
+
+int put(uint32_t seq, size_t len, const char *topic = TOPIC)
+{
+	std::vector<uint8_t> payload(len, uint8_t(seq));
+
+	memcpy(payload.data(), &seq, std::min(len, sizeof(seq)));
+	return report_store_put((const uint8_t *)topic, payload.data(), len, MQTT_QOS_1_AT_LEAST_ONCE, 0);
+}
+
+uint32_t seq_of(const published &p)
+{
+	uint32_t seq = 0;
+
+	memcpy(&seq, p.payload.data(), std::min(p.payload.size(), sizeof(seq)));
+	return seq;
+}
+
+// drains to the end, an hour of virtual time is plenty
+void drain()
+{
+	report_store_drain_start();
+	shim_run(k_uptime_get() + 3600 * 1000);
+}
+
+// every report arrives in order, the newest ones when the oldest were dropped
+bool in_order(uint32_t first, uint32_t count)
+{
+	const auto &got = broker_published();
+
+	if (got.size() != count)
+	{
+		return false;
+	}
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		if (seq_of(got[i]) != first + i || got[i].topic != TOPIC)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void test_fills_partition()
+{
+	std::mt19937 rng(1);
+	uint32_t n = 2000;
+
+	fresh_store();
+	for (uint32_t seq = 0; seq < n; ++seq)
+	{
+		EXPECT(put(seq, 120 + rng() % 400) == 0);
+	}
+	uint32_t kept = report_store_count();
+
+	EXPECT(kept > 0 && kept < CONFIG_REPORT_STORE_CAPACITY);
+	drain();
+	EXPECT(in_order(n - kept, kept));
+	EXPECT(report_store_count() == 0);
+	EXPECT(broker_msgs_held() == 0);
+	printf("  %u of %u reports of 120..520 bytes kept\n", kept, n);
+}
+
+void test_capacity()
+{
+	uint32_t n = CONFIG_REPORT_STORE_CAPACITY + 10;
+
+	fresh_store();
+	for (uint32_t seq = 0; seq < n; ++seq)
+	{
+		EXPECT(put(seq, 8) == 0);
+	}
+	EXPECT(report_store_count() == CONFIG_REPORT_STORE_CAPACITY);
+	drain();
+	EXPECT(in_order(10, CONFIG_REPORT_STORE_CAPACITY));
+}
+
+void test_reboot()
+{
+	fresh_store();
+	for (uint32_t seq = 0; seq < 20; ++seq)
+	{
+		EXPECT(put(seq, 300) == 0);
+	}
+	report_store_init();
+	EXPECT(report_store_count() == 20);
+	drain();
+	EXPECT(in_order(0, 20));
+	report_store_init();
+	EXPECT(report_store_count() == 0);
+}
+
+// a drained report stays in flash until the broker acknowledged it
+void test_power_loss_mid_drain()
+{
+	fresh_store();
+	broker_reset(1000);
+	for (uint32_t seq = 0; seq < 20; ++seq)
+	{
+		EXPECT(put(seq, 300) == 0);
+	}
+	report_store_drain_start();
+	shim_run(k_uptime_get() + 2500);
+	uint32_t delivered = broker_published().size();
+
+	EXPECT(delivered > 0 && delivered < 20);
+	EXPECT(in_order(0, delivered));
+	EXPECT(broker_disconnect() > 0);
+	report_store_init();
+	EXPECT(report_store_count() == 20 - delivered);
+	broker_reset(0);
+	drain();
+	EXPECT(in_order(delivered, 20 - delivered));
+	EXPECT(report_store_count() == 0);
+}
+
+// the reports lost with the connection are drained again, each arrives once
+void test_reconnect_mid_drain()
+{
+	fresh_store();
+	broker_reset(1000);
+	for (uint32_t seq = 0; seq < 20; ++seq)
+	{
+		EXPECT(put(seq, 300) == 0);
+	}
+	report_store_drain_start();
+	shim_run(k_uptime_get() + 2500);
+	report_store_drain_stop();
+	EXPECT(broker_disconnect() > 0);
+	EXPECT(broker_msgs_held() == 0);
+	report_store_rewind();
+	drain();
+	EXPECT(in_order(0, 20));
+	EXPECT(report_store_count() == 0);
+	EXPECT(broker_msgs_held() == 0);
+}
+
+// without a connection the flash is not read, the drain resumes on connect
+void test_no_drain_offline()
+{
+	fresh_store();
+	broker_reset(1000);
+	for (uint32_t seq = 0; seq < 20; ++seq)
+	{
+		EXPECT(put(seq, 300) == 0);
+	}
+	report_store_drain_start();
+	shim_run(k_uptime_get() + 2500);
+	uint32_t delivered = broker_published().size();
+
+	report_store_drain_stop();
+	EXPECT(broker_disconnect() > 0);
+	report_store_drain_kick();
+	EXPECT(put(20, 300) == 0);
+	shim_run(k_uptime_get() + 3600 * 1000);
+	EXPECT(broker_published().size() == delivered);
+	EXPECT(broker_msgs_held() == 0);
+	report_store_rewind();
+	drain();
+	EXPECT(in_order(0, 21));
+	EXPECT(report_store_count() == 0);
+}
+
+void test_largest_report()
+{
+	char topic[MQTT_TOPIC_BUF_SIZE];
+
+	fresh_store();
+	memset(topic, 't', sizeof(topic) - 1);
+	topic[sizeof(topic) - 1] = '\0';
+	EXPECT(put(0, MQTT_MESSAGE_BUF_SIZE, topic) == 0);
+	EXPECT(put(1, MQTT_MESSAGE_BUF_SIZE + 1) == -EMSGSIZE);
+	drain();
+	EXPECT(broker_published().size() == 1);
+	EXPECT(broker_published()[0].topic == topic);
+	EXPECT(broker_published()[0].payload.size() == MQTT_MESSAGE_BUF_SIZE);
+}
+
+void test_corrupt_records()
+{
+	fresh_store();
+	for (uint32_t seq = 0; seq < 6; ++seq)
+	{
+		EXPECT(put(seq, 100) == 0);
+	}
+	// header bytes: qos, retain, topic_len, payload_len
+	EXPECT(nvs_sim_corrupt(PARTITION, 2, 2) == 0); // topic past its buffer
+	EXPECT(nvs_sim_corrupt(PARTITION, 4, 3) == 0); // lengths not the record
+	EXPECT(nvs_sim_corrupt(PARTITION, 5, 4) == 0);
+	drain();
+	EXPECT(broker_published().size() == 3);
+	EXPECT(seq_of(broker_published()[0]) == 0);
+	EXPECT(seq_of(broker_published()[1]) == 2);
+	EXPECT(seq_of(broker_published()[2]) == 5);
+	EXPECT(report_store_count() == 0);
+	EXPECT(broker_msgs_held() == 0);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+	// the dropped report warnings are expected, -v shows them
+	shim_log_level = (argc > 1 && strcmp(argv[1], "-v") == 0) ? LOG_LEVEL_DBG : LOG_LEVEL_ERR;
+
+	const struct
+	{
+		const char *name;
+		void (*run)();
+	} cases[] = {
+		{"fills the partition without a failed write", test_fills_partition},
+		{"drops the oldest past the capacity", test_capacity},
+		{"keeps the queue over a reboot", test_reboot},
+		{"keeps unacknowledged reports over a power loss", test_power_loss_mid_drain},
+		{"drains unacknowledged reports again after a reconnect", test_reconnect_mid_drain},
+		{"does not drain while disconnected", test_no_drain_offline},
+		{"stores the largest report", test_largest_report},
+		{"skips corrupt records", test_corrupt_records},
+	};
+
+	for (const auto &c : cases)
+	{
+		int before = failures;
+
+		printf("%s\n", c.name);
+		c.run();
+		printf("  %s\n", failures == before ? "ok" : "FAILED");
+	}
+	return failures ? 1 : 0;
+}